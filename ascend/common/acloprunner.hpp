@@ -11,7 +11,11 @@
 #include <array>
 #include <functional>
 #include <initializer_list>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 #include <typeinfo>
 #include <string>
@@ -166,13 +170,116 @@ T getValue(const diopiScalar_t* scalar) {
     }
 }
 
+// Read once per process instead of once per runner instantiation.
+inline bool isDebugAclOpRunner() {
+    static const bool debug = std::getenv("DIOPI_DEBUG_ACLOPRUNNER") != nullptr;
+    return debug;
+}
+
+enum class AclOpRunMode {
+    CompileAndExecute,  // aclopCompileAndExecute on every run
+    CompileOnce,        // aclopCompile once per signature, then aclopExecuteV2 with cached descs
+};
+
+/**
+ * Descriptors and attributes of an op signature that has been compiled with aclopCompile.
+ * aclopExecuteV2 may update the output descs, so launches on one entry are serialized.
+ * A signature aclopCompile rejected is kept as a fallback entry without descs, so that it
+ * goes straight to aclopCompileAndExecute instead of being compiled again on every run.
+ */
+struct AclOpCacheEntry {
+    bool fallback = false;
+    std::vector<aclTensorDesc*> inputDescs;
+    std::vector<aclTensorDesc*> outputDescs;
+    aclopAttr* attr = nullptr;
+    std::mutex mutex;
+
+    AclOpCacheEntry() = default;
+    AclOpCacheEntry(const AclOpCacheEntry&) = delete;
+    AclOpCacheEntry& operator=(const AclOpCacheEntry&) = delete;
+
+    ~AclOpCacheEntry() {
+        std::for_each(inputDescs.begin(), inputDescs.end(), aclDestroyTensorDesc);
+        std::for_each(outputDescs.begin(), outputDescs.end(), aclDestroyTensorDesc);
+        if (attr) {
+            aclopDestroyAttr(attr);
+        }
+    }
+};
+
+/**
+ * Least recently used signatures are dropped once the cache holds `capacity` of them, so that ops
+ * called with ever-changing shapes cannot grow it without limit. Entries are shared, an evicted
+ * entry stays alive until the runs still using it are done.
+ */
+class AclOpCache {
+public:
+    static constexpr size_t kDefaultCapacity = 1024;
+
+    explicit AclOpCache(size_t capacity = kDefaultCapacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    static AclOpCache& instance() {
+        static AclOpCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<AclOpCacheEntry> find(const std::string& key) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.first);
+        return it->second.second;
+    }
+
+    // keeps the first entry when two threads compiled the same signature concurrently
+    std::shared_ptr<AclOpCacheEntry> insert(const std::string& key, std::shared_ptr<AclOpCacheEntry> entry) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.first);
+            return it->second.second;
+        }
+        if (entries_.size() == capacity_) {
+            entries_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(key);
+        entries_.emplace(key, std::make_pair(lru_.begin(), entry));
+        return entry;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return entries_.size();
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    // most recently used first
+    std::list<std::string> lru_;
+    std::unordered_map<std::string, std::pair<std::list<std::string>::iterator, std::shared_ptr<AclOpCacheEntry>>> entries_;
+};
+
 template <int InputSize, int OutputSize, aclDataType (*dtypeCastStrategy)(diopiConstTensorHandle_t) = getAclDataType>
 class AclOpRunner {
+    struct TensorMeta {
+        bool used = false;
+        aclDataType dtype = ACL_DT_UNDEFINED;
+        aclFormat format = ACL_FORMAT_ND;
+        std::vector<int64_t> dims;
+    };
+
     std::string opname_;
-    aclopAttr* attr_;
-    std::array<aclTensorDesc*, InputSize> inputDescs_;
+    AclOpRunMode mode_ = AclOpRunMode::CompileOnce;
+    // attrs are replayed onto an aclopAttr only when one has to be built, their text form is part of the cache key
+    std::vector<std::function<void(aclopAttr*)>> attrSetters_;
+    std::string attrKey_;
+    std::array<TensorMeta, InputSize> inputMetas_;
     std::array<aclDataBuffer*, InputSize> inputBuffers_;
-    std::array<aclTensorDesc*, OutputSize> outputDescs_;
+    std::array<TensorMeta, OutputSize> outputMetas_;
     std::array<aclDataBuffer*, OutputSize> outputBuffers_;
 
     std::string dumpRunnerInfo() {
@@ -181,75 +288,124 @@ class AclOpRunner {
         return sstream.str();
     }
 
+    template <size_t Size>
+    static int usedSize(const std::array<TensorMeta, Size>& metas) {
+        return std::count_if(metas.begin(), metas.end(), [](const TensorMeta& meta) { return meta.used; });
+    }
+
+    template <size_t Size>
+    static int firstUnused(const std::array<TensorMeta, Size>& metas) {
+        auto it = std::find_if(metas.begin(), metas.end(), [](const TensorMeta& meta) { return !meta.used; });
+        return it == metas.end() ? -1 : it - metas.begin();
+    }
+
+    static void setMeta(TensorMeta& meta, diopiConstTensorHandle_t th, const aclFormat& format) {
+        diopiSize_t shape;
+        int64_t numel = 0;
+        diopiGetTensorShape(th, &shape);
+        diopiGetTensorNumel(th, &numel);
+        meta.used = true;
+        meta.dtype = dtypeCastStrategy(th);
+        meta.format = format;
+        meta.dims.assign(shape.data, shape.data + shape.len);
+        if (meta.dims.size() == 0 && numel == 1) {
+            meta.dims.push_back(1);
+        }
+    }
+
+    static aclTensorDesc* createDesc(const TensorMeta& meta) {
+        aclTensorDesc* desc = aclCreateTensorDesc(meta.dtype, meta.dims.size(), meta.dims.data(), meta.format);
+        check_args(desc != nullptr, "aclTensorDesc should not be nullptr.");
+        return desc;
+    }
+
+    static void appendKey(std::string& key, const TensorMeta& meta) {
+        key += std::to_string(meta.dtype) + ',' + std::to_string(meta.format) + ':';
+        for (auto dim : meta.dims) {
+            key += std::to_string(dim) + ',';
+        }
+        key += ';';
+    }
+
+    template <typename T>
+    void appendAttrKey(const std::string& attrName, const T& value) {
+        std::stringstream sstream;
+        sstream << attrName << '=' << value << ';';
+        attrKey_ += sstream.str();
+    }
+
+    aclopAttr* createAttr() {
+        aclopAttr* attr = aclopCreateAttr();
+        for (auto& setter : attrSetters_) {
+            setter(attr);
+        }
+        return attr;
+    }
+
+    std::string cacheKey(aclEngineType engineType, aclCompileType compileType) {
+        std::string key = opname_ + '|' + std::to_string(engineType) + ',' + std::to_string(compileType) + '|';
+        std::for_each(inputMetas_.begin(), inputMetas_.end(), [&key](const TensorMeta& meta) {
+            if (meta.used) appendKey(key, meta);
+        });
+        key += '|';
+        std::for_each(outputMetas_.begin(), outputMetas_.end(), [&key](const TensorMeta& meta) {
+            if (meta.used) appendKey(key, meta);
+        });
+        key += '|' + attrKey_;
+        return key;
+    }
+
+    std::unique_ptr<AclOpCacheEntry> createEntry(int inSize, int outSize) {
+        std::unique_ptr<AclOpCacheEntry> entry(new AclOpCacheEntry);
+        for (int i = 0; i < inSize; i++) {
+            entry->inputDescs.push_back(createDesc(inputMetas_[i]));
+        }
+        for (int i = 0; i < outSize; i++) {
+            entry->outputDescs.push_back(createDesc(outputMetas_[i]));
+        }
+        entry->attr = createAttr();
+        return entry;
+    }
+
 public:
-    explicit AclOpRunner(std::string opname) : opname_(std::move(opname)), attr_(aclopCreateAttr()) {
-        inputDescs_.fill(nullptr);
-        inputBuffers_.fill(nullptr);
-        outputDescs_.fill(nullptr);
+    explicit AclOpRunner(std::string opname) : opname_(std::move(opname)) {
         inputBuffers_.fill(nullptr);
+        outputBuffers_.fill(nullptr);
     }
 
     ~AclOpRunner() {
-        aclopDestroyAttr(attr_);
-        auto destoryAclTensorDesc = [](aclTensorDesc* desc) {
-            if (desc) {
-                aclDestroyTensorDesc(desc);
-            }
-        };
         auto destoryAclDataBuffer = [](aclDataBuffer* buffer) {
             if (buffer) {
                 aclDestroyDataBuffer(buffer);
             }
         };
-        std::for_each(inputDescs_.begin(), inputDescs_.end(), destoryAclTensorDesc);
-        std::for_each(outputDescs_.begin(), outputDescs_.end(), destoryAclTensorDesc);
         std::for_each(inputBuffers_.begin(), inputBuffers_.end(), destoryAclDataBuffer);
         std::for_each(outputBuffers_.begin(), outputBuffers_.end(), destoryAclDataBuffer);
     }
 
+    AclOpRunner& setRunMode(AclOpRunMode mode) {
+        mode_ = mode;
+        return *this;
+    }
+
     AclOpRunner& addInput(const int index, diopiConstTensorHandle_t th, const aclFormat& format) {
         check_args(th != nullptr, "input should not be nullptr");
-        diopiSize_t shape;
-        diopiSize_t stride;
         int64_t numel = 0;
         int64_t itemsize = 0;
         const void* ptr = nullptr;
-        diopiGetTensorShape(th, &shape);
-        diopiGetTensorStride(th, &stride);
         diopiGetTensorNumel(th, &numel);
         diopiGetTensorElemSize(th, &itemsize);
         diopiGetTensorDataConst(th, &ptr);
 
-        std::vector<int64_t> dims(shape.len);
-        for (size_t i = 0; i < dims.size(); ++i) {
-            dims[i] = shape.data[i];
-        }
-        if (dims.size() == 0 && numel == 1) {
-            dims.push_back(1);
-        }
-
-        int finalIndex = index;
-        if (index < 0) {
-            for (size_t i = 0; i < InputSize; i++) {
-                if (inputDescs_[i] == nullptr) {
-                    finalIndex = i;
-                    break;
-                }
-            }
-        }
-
-        static int PARROTS_DEBUG_ACLOPRUNNER = std::getenv("DIOPI_DEBUG_ACLOPRUNNER") == nullptr ? 0 : 1;
-        if (PARROTS_DEBUG_ACLOPRUNNER > 0) {
+        int finalIndex = index < 0 ? firstUnused(inputMetas_) : index;
+        if (isDebugAclOpRunner()) {
             info("%s input[%d]:%s", opname_.c_str(), finalIndex, dumpTensor(th).c_str());
         }
 
         check_args(finalIndex >= 0 && finalIndex < InputSize, "check 0<=finalIndex<InputSize failed");
 
-        auto& desc = inputDescs_[finalIndex];
+        setMeta(inputMetas_[finalIndex], th, format);
         auto& buffer = inputBuffers_[finalIndex];
-
-        desc = aclCreateTensorDesc(dtypeCastStrategy(th), dims.size(), dims.data(), format);
-        check_args(desc != nullptr, "aclTensorDesc should not be nullptr.");
         buffer = aclCreateDataBuffer(const_cast<void*>(ptr), numel * itemsize);
         return *this;
     }
@@ -276,43 +432,20 @@ public:
 
     AclOpRunner& addOutput(const int index, diopiTensorHandle_t th, const aclFormat format) {
         check_args(th != nullptr, "output should not be nullptr");
-        int finalIndex = index;
-        if (index < 0) {
-            for (size_t i = 0; i < OutputSize; i++) {
-                if (outputDescs_[i] == nullptr) {
-                    finalIndex = i;
-                    break;
-                }
-            }
-        }
-        static int PARROTS_DEBUG_ACLOPRUNNER = std::getenv("DIOPI_DEBUG_ACLOPRUNNER") == nullptr ? 0 : 1;
-        if (PARROTS_DEBUG_ACLOPRUNNER > 0) {
+        int finalIndex = index < 0 ? firstUnused(outputMetas_) : index;
+        if (isDebugAclOpRunner()) {
             info("%s output[%d]:%s", opname_.c_str(), finalIndex, dumpTensor(th).c_str());
         }
-        diopiSize_t shape;
-        diopiSize_t stride;
         int64_t numel = 0;
         int64_t itemsize = 0;
         void* ptr = nullptr;
-        diopiGetTensorShape(th, &shape);
-        diopiGetTensorStride(th, &stride);
         diopiGetTensorNumel(th, &numel);
         diopiGetTensorElemSize(th, &itemsize);
         diopiGetTensorData(th, &ptr);
 
-        std::vector<int64_t> dims(shape.len);
-        for (size_t i = 0; i < dims.size(); ++i) {
-            dims[i] = shape.data[i];
-        }
-        if (dims.size() == 0 && numel == 1) {
-            dims.push_back(1);
-        }
-
         check_args(finalIndex >= 0 && finalIndex < OutputSize, "check 0<=finalIndex<OutputSize failed");
-        auto& desc = outputDescs_[finalIndex];
+        setMeta(outputMetas_[finalIndex], th, format);
         auto& buffer = outputBuffers_[finalIndex];
-        desc = aclCreateTensorDesc(dtypeCastStrategy(th), dims.size(), dims.data(), format);
-        check_args(desc != nullptr, "aclTensorDesc should not be nullptr.");
         buffer = aclCreateDataBuffer(ptr, numel * itemsize);
         return *this;
     }
@@ -335,29 +468,41 @@ public:
     template <typename T>
     AclOpRunner& setAttr(const std::string& attrName, const T& value) {
         if constexpr (std::is_same<T, int64_t>::value || std::is_same<T, int>::value) {
-            CALL_ACLRT(aclopSetAttrInt(attr_, attrName.data(), value));
+            attrSetters_.emplace_back([attrName, value](aclopAttr* attr) { CALL_ACLRT(aclopSetAttrInt(attr, attrName.data(), value)); });
+            appendAttrKey(attrName, value);
             return *this;
         }
         if constexpr (std::is_same<T, float>::value) {
-            CALL_ACLRT(aclopSetAttrFloat(attr_, attrName.data(), value));
+            attrSetters_.emplace_back([attrName, value](aclopAttr* attr) { CALL_ACLRT(aclopSetAttrFloat(attr, attrName.data(), value)); });
+            // hexfloat keeps the key exact
+            std::stringstream sstream;
+            sstream << std::hexfloat << value;
+            appendAttrKey(attrName, sstream.str());
             return *this;
         }
         if constexpr (std::is_same<T, uint8_t>::value || std::is_same<T, bool>::value) {
-            CALL_ACLRT(aclopSetAttrBool(attr_, attrName.data(), value));
+            attrSetters_.emplace_back([attrName, value](aclopAttr* attr) { CALL_ACLRT(aclopSetAttrBool(attr, attrName.data(), value)); });
+            appendAttrKey(attrName, static_cast<int>(value));
             return *this;
         }
         if constexpr (std::is_same<T, std::string>::value) {
-            CALL_ACLRT(aclopSetAttrString(attr_, attrName.data(), value.data()));
+            attrSetters_.emplace_back([attrName, value](aclopAttr* attr) { CALL_ACLRT(aclopSetAttrString(attr, attrName.data(), value.data())); });
+            appendAttrKey(attrName, '"' + value + '"');
             return *this;
         }
-        check_args(false, "%s: no specialization for %s type.", dumpRunnerInfo().c_str() , typeid(T).name());
+        check_args(false, "%s: no specialization for %s type.", dumpRunnerInfo().c_str(), typeid(T).name());
         return *this;
     }
 
     template <typename T>
     AclOpRunner& setAttr(const std::string& attrName, const typename std::vector<T>& value) {
         std::vector<int64_t> vec(value.begin(), value.end());
-        CALL_ACLRT(aclopSetAttrListInt(attr_, attrName.data(), vec.size(), vec.data()));
+        std::string text = "[";
+        for (auto v : vec) {
+            text += std::to_string(v) + ',';
+        }
+        appendAttrKey(attrName, text + ']');
+        attrSetters_.emplace_back([attrName, vec](aclopAttr* attr) { CALL_ACLRT(aclopSetAttrListInt(attr, attrName.data(), vec.size(), vec.data())); });
         return *this;
     }
 
@@ -365,38 +510,70 @@ public:
     AclOpRunner& run(diopiContextHandle_t& ctx) {
         diopiStreamHandle_t stream;
         diopiGetStream(ctx, &stream);
-        int inSize = 0;
-        for (size_t i = 0; i < InputSize; i++) {
-            if (inputDescs_[i] != nullptr) {
-                inSize++;
+        int inSize = usedSize(inputMetas_);
+        int outSize = usedSize(outputMetas_);
+
+        aclError errorcode = ACL_SUCCESS;
+        if (mode_ == AclOpRunMode::CompileOnce) {
+            AclOpCache& cache = AclOpCache::instance();
+            const std::string key = cacheKey(EngineType, CompileType);
+            std::shared_ptr<AclOpCacheEntry> entry = cache.find(key);
+            if (entry == nullptr) {
+                std::shared_ptr<AclOpCacheEntry> created = createEntry(inSize, outSize);
+                errorcode = aclopCompile(opname_.data(),
+                                         inSize,
+                                         created->inputDescs.data(),
+                                         outSize,
+                                         created->outputDescs.data(),
+                                         created->attr,
+                                         EngineType,
+                                         CompileType,
+                                         nullptr);
+                if (errorcode != ACL_SUCCESS) {
+                    if (isDebugAclOpRunner()) {
+                        info("%s: aclopCompile failed, falling back to aclopCompileAndExecute", opname_.c_str());
+                    }
+                    created = std::make_shared<AclOpCacheEntry>();
+                    created->fallback = true;
+                }
+                entry = cache.insert(key, std::move(created));
             }
-        }
-        int outSize = 0;
-        for (size_t i = 0; i < OutputSize; i++) {
-            if (outputDescs_[i] != nullptr) {
-                outSize++;
+            if (!entry->fallback) {
+                std::lock_guard<std::mutex> guard(entry->mutex);
+                errorcode = aclopExecuteV2(opname_.data(),
+                                           inSize,
+                                           entry->inputDescs.data(),
+                                           inputBuffers_.data(),
+                                           outSize,
+                                           entry->outputDescs.data(),
+                                           outputBuffers_.data(),
+                                           entry->attr,
+                                           stream);
+            } else {
+                mode_ = AclOpRunMode::CompileAndExecute;
             }
         }
 
-        auto errorcode = aclopCompileAndExecute(opname_.data(),
-                                                inSize,
-                                                inputDescs_.data(),
-                                                inputBuffers_.data(),
-                                                outSize,
-                                                outputDescs_.data(),
-                                                outputBuffers_.data(),
-                                                attr_,
-                                                EngineType,
-                                                CompileType,
-                                                nullptr,
-                                                stream);
+        if (mode_ == AclOpRunMode::CompileAndExecute) {
+            std::unique_ptr<AclOpCacheEntry> descs = createEntry(inSize, outSize);
+            errorcode = aclopCompileAndExecute(opname_.data(),
+                                               inSize,
+                                               descs->inputDescs.data(),
+                                               inputBuffers_.data(),
+                                               outSize,
+                                               descs->outputDescs.data(),
+                                               outputBuffers_.data(),
+                                               descs->attr,
+                                               EngineType,
+                                               CompileType,
+                                               nullptr,
+                                               stream);
+        }
         if (errorcode != ACL_SUCCESS) {
             warning((dumpRunnerInfo() + ":" + aclGetRecentErrMsg()).c_str());
         }
         // check_args(errorcode == ACL_SUCCESS, dumpRunnerInfo().c_str());
-        //   Get environment variables once when run is called for the first time
-        static int PARROTS_DEBUG_ACLOPRUNNER = std::getenv("DIOPI_DEBUG_ACLOPRUNNER") == nullptr ? 0 : 1;
-        if (PARROTS_DEBUG_ACLOPRUNNER > 0) {
+        if (isDebugAclOpRunner()) {
             info(dumpRunnerInfo().c_str());
         }
 
@@ -0,0 +1,202 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "../common/acloprunner.hpp"
+#include "stub/acl_stub.h"
+
+using impl::ascend::AclOpCache;
+using impl::ascend::AclOpCacheEntry;
+using impl::ascend::AclOpRunMode;
+using impl::ascend::AclOpRunner;
+
+struct diopiTensor {
+    std::vector<int64_t> shape;
+    std::vector<int64_t> stride;
+    diopiDtype_t dtype;
+    std::vector<char> data;
+};
+
+extern "C" {
+diopiError_t diopiGetTensorData(diopiTensorHandle_t th, void** ptr) {
+    *ptr = th->data.data();
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetTensorDataConst(diopiConstTensorHandle_t th, const void** ptr) {
+    *ptr = th->data.data();
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetTensorShape(diopiConstTensorHandle_t th, diopiSize_t* size) {
+    *size = diopiSize_t{th->shape.data(), static_cast<int64_t>(th->shape.size())};
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetTensorStride(diopiConstTensorHandle_t th, diopiSize_t* stride) {
+    *stride = diopiSize_t{th->stride.data(), static_cast<int64_t>(th->stride.size())};
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetTensorDtype(diopiConstTensorHandle_t th, diopiDtype_t* dtype) {
+    *dtype = th->dtype;
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetTensorNumel(diopiConstTensorHandle_t th, int64_t* numel) {
+    *numel = 1;
+    for (auto size : th->shape) *numel *= size;
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetTensorElemSize(diopiConstTensorHandle_t, int64_t* itemsize) {
+    *itemsize = 4;
+    return diopiSuccess;
+}
+
+diopiError_t diopiGetStream(diopiContextHandle_t, diopiStreamHandle_t* stream) {
+    *stream = nullptr;
+    return diopiSuccess;
+}
+}
+
+static int failures = 0;
+
+#define EXPECT(cond)                                                        \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::printf("%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                     \
+        }                                                                   \
+    } while (0)
+
+static diopiTensor makeTensor(std::vector<int64_t> shape) {
+    std::vector<int64_t> stride(shape.size());
+    int64_t step = 1;
+    for (size_t i = shape.size(); i > 0; --i) {
+        stride[i - 1] = step;
+        step *= shape[i - 1];
+    }
+    return diopiTensor{shape, stride, diopi_dtype_float32, std::vector<char>(step * 4)};
+}
+
+static void runAdds(const char* opname, diopiTensor* in, diopiTensor* out, int64_t alpha, AclOpRunMode mode = AclOpRunMode::CompileOnce) {
+    diopiContextHandle_t ctx = nullptr;
+    AclOpRunner<2, 1>(opname).setRunMode(mode).addInput(in, in).setAttr("alpha", alpha).addOutput(out).run(ctx);
+}
+
+static void testCompileOnce() {
+    diopiTensor in = makeTensor({2, 3});
+    diopiTensor out = makeTensor({2, 3});
+    AclStubStats before = aclStubStats;
+    runAdds("CompileOnce", &in, &out, 1);
+    runAdds("CompileOnce", &in, &out, 1);
+    EXPECT(aclStubStats.compile == before.compile + 1);
+    EXPECT(aclStubStats.execute == before.execute + 2);
+    EXPECT(aclStubStats.compileAndExecute == before.compileAndExecute);
+    // only the cached signature keeps its descs and attr, data buffers go with the runner
+    EXPECT(aclStubStats.liveDescs == before.liveDescs + 3);
+    EXPECT(aclStubStats.liveAttrs == before.liveAttrs + 1);
+    EXPECT(aclStubStats.liveBuffers == before.liveBuffers);
+}
+
+static void testSignatureChanges() {
+    diopiTensor in = makeTensor({2, 3});
+    diopiTensor out = makeTensor({2, 3});
+    diopiTensor wideIn = makeTensor({2, 4});
+    diopiTensor wideOut = makeTensor({2, 4});
+    AclStubStats before = aclStubStats;
+    runAdds("SignatureChanges", &in, &out, 1);
+    runAdds("SignatureChanges", &wideIn, &wideOut, 1);
+    runAdds("SignatureChanges", &in, &out, 2);
+    runAdds("SignatureChanges", &in, &out, 2);
+    EXPECT(aclStubStats.compile == before.compile + 3);
+    EXPECT(aclStubStats.execute == before.execute + 4);
+}
+
+static void testRejectedCompile() {
+    diopiTensor in = makeTensor({5});
+    diopiTensor out = makeTensor({5});
+    aclStubRejectCompile("RejectedCompile");
+    AclStubStats before = aclStubStats;
+    runAdds("RejectedCompile", &in, &out, 1);
+    runAdds("RejectedCompile", &in, &out, 1);
+    runAdds("RejectedCompile", &in, &out, 1);
+    // the failure is remembered, later runs do not try aclopCompile again
+    EXPECT(aclStubStats.compile == before.compile + 1);
+    EXPECT(aclStubStats.compileAndExecute == before.compileAndExecute + 3);
+    EXPECT(aclStubStats.execute == before.execute);
+    EXPECT(aclStubStats.liveDescs == before.liveDescs);
+    EXPECT(aclStubStats.liveAttrs == before.liveAttrs);
+}
+
+static void testCompileAndExecuteMode() {
+    diopiTensor in = makeTensor({3});
+    diopiTensor out = makeTensor({3});
+    AclStubStats before = aclStubStats;
+    size_t cached = AclOpCache::instance().size();
+    runAdds("CompileAndExecuteMode", &in, &out, 1, AclOpRunMode::CompileAndExecute);
+    runAdds("CompileAndExecuteMode", &in, &out, 1, AclOpRunMode::CompileAndExecute);
+    EXPECT(aclStubStats.compile == before.compile);
+    EXPECT(aclStubStats.compileAndExecute == before.compileAndExecute + 2);
+    EXPECT(aclStubStats.liveDescs == before.liveDescs);
+    EXPECT(AclOpCache::instance().size() == cached);
+}
+
+static std::shared_ptr<AclOpCacheEntry> makeEntry() {
+    auto entry = std::make_shared<AclOpCacheEntry>();
+    entry->attr = aclopCreateAttr();
+    return entry;
+}
+
+static void testLruEviction() {
+    int liveAttrs = aclStubStats.liveAttrs;
+    {
+        AclOpCache cache(2);
+        cache.insert("a", makeEntry());
+        cache.insert("b", makeEntry());
+        EXPECT(cache.find("a") != nullptr);
+        // "b" is the least recently used now
+        cache.insert("c", makeEntry());
+        EXPECT(cache.size() == 2);
+        EXPECT(cache.find("b") == nullptr);
+        EXPECT(cache.find("a") != nullptr);
+        EXPECT(cache.find("c") != nullptr);
+        EXPECT(aclStubStats.liveAttrs == liveAttrs + 2);
+
+        // an entry still in use outlives its eviction
+        std::shared_ptr<AclOpCacheEntry> inUse = cache.find("a");
+        cache.insert("d", makeEntry());
+        cache.insert("e", makeEntry());
+        EXPECT(cache.find("a") == nullptr);
+        EXPECT(aclStubStats.liveAttrs == liveAttrs + 3);
+        inUse.reset();
+        EXPECT(aclStubStats.liveAttrs == liveAttrs + 2);
+
+        // a second insert of a signature keeps the first entry
+        std::shared_ptr<AclOpCacheEntry> first = cache.find("e");
+        EXPECT(cache.insert("e", makeEntry()) == first);
+        EXPECT(cache.size() == 2);
+    }
+    EXPECT(aclStubStats.liveAttrs == liveAttrs);
+}
+
+int main() {
+    testCompileOnce();
+    testSignatureChanges();
+    testRejectedCompile();
+    testCompileAndExecuteMode();
+    testLruEviction();
+    if (failures) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+// Host stub of the parts of the ACL runtime used by AclOpRunner, see acl_stub.cpp.
+
+#ifndef IMPL_ASCEND_TEST_STUB_ACL_ACL_H_
+#define IMPL_ASCEND_TEST_STUB_ACL_ACL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int aclError;
+static const aclError ACL_SUCCESS = 0;
+static const aclError ACL_ERROR_FAILURE = 500000;
+
+typedef void* aclrtStream;
+
+typedef enum {
+    ACL_DT_UNDEFINED = -1,
+    ACL_FLOAT = 0,
+    ACL_FLOAT16 = 1,
+    ACL_INT8 = 2,
+    ACL_INT32 = 3,
+    ACL_UINT8 = 4,
+    ACL_INT16 = 6,
+    ACL_UINT16 = 7,
+    ACL_UINT32 = 8,
+    ACL_INT64 = 9,
+    ACL_UINT64 = 10,
+    ACL_DOUBLE = 11,
+    ACL_BOOL = 12,
+} aclDataType;
+
+typedef enum {
+    ACL_FORMAT_UNDEFINED = -1,
+    ACL_FORMAT_NCHW = 0,
+    ACL_FORMAT_NHWC = 1,
+    ACL_FORMAT_ND = 2,
+} aclFormat;
+
+typedef struct aclTensorDesc aclTensorDesc;
+typedef struct aclDataBuffer aclDataBuffer;
+
+aclTensorDesc* aclCreateTensorDesc(aclDataType dataType, int numDims, const int64_t* dims, aclFormat format);
+void aclDestroyTensorDesc(const aclTensorDesc* desc);
+aclDataBuffer* aclCreateDataBuffer(void* data, size_t size);
+aclError aclDestroyDataBuffer(const aclDataBuffer* dataBuffer);
+const char* aclGetRecentErrMsg();
+
+#endif  // IMPL_ASCEND_TEST_STUB_ACL_ACL_H_
@@ -0,0 +1,24 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_ASCEND_TEST_STUB_ACL_ACL_OP_H_
+#define IMPL_ASCEND_TEST_STUB_ACL_ACL_OP_H_
+
+#include <acl/acl.h>
+
+typedef struct aclopAttr aclopAttr;
+
+aclopAttr* aclopCreateAttr();
+void aclopDestroyAttr(const aclopAttr* attr);
+aclError aclopSetAttrInt(aclopAttr* attr, const char* attrName, int64_t attrValue);
+aclError aclopSetAttrFloat(aclopAttr* attr, const char* attrName, float attrValue);
+aclError aclopSetAttrBool(aclopAttr* attr, const char* attrName, uint8_t attrValue);
+aclError aclopSetAttrString(aclopAttr* attr, const char* attrName, const char* attrValue);
+aclError aclopSetAttrListInt(aclopAttr* attr, const char* attrName, int numValues, const int64_t* values);
+aclError aclopExecuteV2(const char* opType, int numInputs, aclTensorDesc* inputDesc[], aclDataBuffer* inputs[], int numOutputs,
+                        aclTensorDesc* outputDesc[], aclDataBuffer* outputs[], aclopAttr* attr, aclrtStream stream);
+
+#endif  // IMPL_ASCEND_TEST_STUB_ACL_ACL_OP_H_
@@ -0,0 +1,21 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_ASCEND_TEST_STUB_ACL_ACL_OP_COMPILER_H_
+#define IMPL_ASCEND_TEST_STUB_ACL_ACL_OP_COMPILER_H_
+
+#include <acl/acl_op.h>
+
+typedef enum aclEngineType { ACL_ENGINE_SYS, ACL_ENGINE_AICORE, ACL_ENGINE_VECTOR } aclopEngineType;
+typedef enum aclCompileType { ACL_COMPILE_SYS, ACL_COMPILE_UNREGISTERED } aclopCompileType;
+
+aclError aclopCompile(const char* opType, int numInputs, const aclTensorDesc* const inputDesc[], int numOutputs, const aclTensorDesc* const outputDesc[],
+                      const aclopAttr* attr, aclopEngineType engineType, aclopCompileType compileFlag, const char* opPath);
+aclError aclopCompileAndExecute(const char* opType, int numInputs, const aclTensorDesc* const inputDesc[], const aclDataBuffer* const inputs[], int numOutputs,
+                                const aclTensorDesc* const outputDesc[], aclDataBuffer* const outputs[], const aclopAttr* attr, aclopEngineType engineType,
+                                aclopCompileType compileFlag, const char* opPath, aclrtStream stream);
+
+#endif  // IMPL_ASCEND_TEST_STUB_ACL_ACL_OP_COMPILER_H_
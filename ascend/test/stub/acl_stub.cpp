@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "acl_stub.h"
+
+#include <acl/acl.h>
+#include <acl/acl_op.h>
+#include <acl/acl_op_compiler.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+struct aclTensorDesc {
+    aclDataType dtype;
+    std::vector<int64_t> dims;
+    aclFormat format;
+};
+
+struct aclDataBuffer {
+    void* data;
+    size_t size;
+};
+
+struct aclopAttr {};
+
+AclStubStats aclStubStats;
+
+static std::set<std::string>& rejectedOps() {
+    static std::set<std::string> ops;
+    return ops;
+}
+
+void aclStubRejectCompile(const std::string& opType) { rejectedOps().insert(opType); }
+
+aclTensorDesc* aclCreateTensorDesc(aclDataType dataType, int numDims, const int64_t* dims, aclFormat format) {
+    ++aclStubStats.liveDescs;
+    return new aclTensorDesc{dataType, std::vector<int64_t>(dims, dims + numDims), format};
+}
+
+void aclDestroyTensorDesc(const aclTensorDesc* desc) {
+    --aclStubStats.liveDescs;
+    delete desc;
+}
+
+aclDataBuffer* aclCreateDataBuffer(void* data, size_t size) {
+    ++aclStubStats.liveBuffers;
+    return new aclDataBuffer{data, size};
+}
+
+aclError aclDestroyDataBuffer(const aclDataBuffer* dataBuffer) {
+    --aclStubStats.liveBuffers;
+    delete dataBuffer;
+    return ACL_SUCCESS;
+}
+
+const char* aclGetRecentErrMsg() { return "acl stub error"; }
+
+aclopAttr* aclopCreateAttr() {
+    ++aclStubStats.liveAttrs;
+    return new aclopAttr;
+}
+
+void aclopDestroyAttr(const aclopAttr* attr) {
+    --aclStubStats.liveAttrs;
+    delete attr;
+}
+
+aclError aclopSetAttrInt(aclopAttr*, const char*, int64_t) { return ACL_SUCCESS; }
+
+aclError aclopSetAttrFloat(aclopAttr*, const char*, float) { return ACL_SUCCESS; }
+
+aclError aclopSetAttrBool(aclopAttr*, const char*, uint8_t) { return ACL_SUCCESS; }
+
+aclError aclopSetAttrString(aclopAttr*, const char*, const char*) { return ACL_SUCCESS; }
+
+aclError aclopSetAttrListInt(aclopAttr*, const char*, int, const int64_t*) { return ACL_SUCCESS; }
+
+aclError aclopExecuteV2(const char*, int, aclTensorDesc*[], aclDataBuffer*[], int, aclTensorDesc*[], aclDataBuffer*[], aclopAttr*, aclrtStream) {
+    ++aclStubStats.execute;
+    return ACL_SUCCESS;
+}
+
+aclError aclopCompile(const char* opType, int, const aclTensorDesc* const[], int, const aclTensorDesc* const[], const aclopAttr*, aclopEngineType,
+                      aclopCompileType, const char*) {
+    ++aclStubStats.compile;
+    return rejectedOps().count(opType) ? ACL_ERROR_FAILURE : ACL_SUCCESS;
+}
+
+aclError aclopCompileAndExecute(const char*, int, const aclTensorDesc* const[], const aclDataBuffer* const[], int, const aclTensorDesc* const[],
+                                aclDataBuffer* const[], const aclopAttr*, aclopEngineType, aclopCompileType, const char*, aclrtStream) {
+    ++aclStubStats.compileAndExecute;
+    return ACL_SUCCESS;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_ASCEND_TEST_STUB_ACL_STUB_H_
+#define IMPL_ASCEND_TEST_STUB_ACL_STUB_H_
+
+#include <string>
+
+/* What the stub ACL library has been asked to do so far, for the host tests to check against. */
+struct AclStubStats {
+    int compile = 0;
+    int execute = 0;
+    int compileAndExecute = 0;
+    // descs, attrs and data buffers created and not destroyed yet
+    int liveDescs = 0;
+    int liveAttrs = 0;
+    int liveBuffers = 0;
+};
+
+extern AclStubStats aclStubStats;
+
+/* Makes aclopCompile reject `opType`, aclopCompileAndExecute still runs it. */
+void aclStubRejectCompile(const std::string& opType);
+
+#endif  // IMPL_ASCEND_TEST_STUB_ACL_STUB_H_
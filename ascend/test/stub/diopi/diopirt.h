@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+// The subset of the DIOPI runtime interface AclOpRunner relies on, implemented by the test over host tensors.
+
+#ifndef IMPL_ASCEND_TEST_STUB_DIOPI_DIOPIRT_H_
+#define IMPL_ASCEND_TEST_STUB_DIOPI_DIOPIRT_H_
+
+#include <stdint.h>
+
+typedef enum {
+    diopiSuccess = 0,
+    diopiErrorOccurred = 1,
+} diopiError_t;
+
+typedef enum {
+    diopi_dtype_int8 = 0,
+    diopi_dtype_uint8 = 1,
+    diopi_dtype_int16 = 2,
+    diopi_dtype_uint16 = 3,
+    diopi_dtype_int32 = 4,
+    diopi_dtype_uint32 = 5,
+    diopi_dtype_int64 = 6,
+    diopi_dtype_uint64 = 7,
+    diopi_dtype_float16 = 8,
+    diopi_dtype_float32 = 9,
+    diopi_dtype_float64 = 10,
+    diopi_dtype_bool = 11,
+} diopiDtype_t;
+
+typedef struct diopiSize_t {
+    const int64_t* data;
+    int64_t len;
+} diopiSize_t;
+
+typedef struct {
+    diopiDtype_t stype;
+    union {
+        double fval;
+        int64_t ival;
+    };
+} diopiScalar_t;
+
+struct diopiTensor;
+struct diopiContext;
+typedef struct diopiTensor* diopiTensorHandle_t;
+typedef const struct diopiTensor* diopiConstTensorHandle_t;
+typedef struct diopiContext* diopiContextHandle_t;
+typedef void* diopiStreamHandle_t;
+
+extern "C" {
+diopiError_t diopiGetTensorData(diopiTensorHandle_t th, void** ptr);
+diopiError_t diopiGetTensorDataConst(diopiConstTensorHandle_t th, const void** ptr);
+diopiError_t diopiGetTensorShape(diopiConstTensorHandle_t th, diopiSize_t* size);
+diopiError_t diopiGetTensorStride(diopiConstTensorHandle_t th, diopiSize_t* stride);
+diopiError_t diopiGetTensorDtype(diopiConstTensorHandle_t th, diopiDtype_t* dtype);
+diopiError_t diopiGetTensorNumel(diopiConstTensorHandle_t th, int64_t* numel);
+diopiError_t diopiGetTensorElemSize(diopiConstTensorHandle_t th, int64_t* itemsize);
+diopiError_t diopiGetStream(diopiContextHandle_t ctx, diopiStreamHandle_t* stream);
+}
+
+#endif  // IMPL_ASCEND_TEST_STUB_DIOPI_DIOPIRT_H_
@@ -89,8 +89,8 @@ public:
 
     template <typename T>
     diopiError_t set(T& t, cnnlTensorLayout_t layout) {
-        const std::vector<int64_t>& dimSize = t.shape();
-        const std::vector<int64_t>& dimStride = t.stride();
+        const auto& dimSize = t.shape();
+        const auto& dimStride = t.stride();
         size_t dim = dimSize.size();
         std::vector<int32_t> shape(dim);
         std::vector<int32_t> stride(dim);
@@ -114,7 +114,7 @@ public:
         } else if (layout == CNNL_LAYOUT_HWCN) {
             // HWCN is only used by depthwise conv now, and the dim is 4
             DIOPI_CHECK(dim == 4, "depthwise convolution input's dim must be 4!");
-            auto convert_shape_stride_hwcn = [](const std::vector<int64_t>& vec, std::vector<int>& target_vec) {
+            auto convert_shape_stride_hwcn = [](const SmallVector<int64_t>& vec, std::vector<int>& target_vec) {
                 target_vec[0] = static_cast<int>(vec[2]);
                 target_vec[1] = static_cast<int>(vec[3]);
                 target_vec[2] = static_cast<int>(vec[1]);
@@ -134,7 +134,17 @@ public:
     }
 
     template <typename T>
-    diopiError_t set(T& t, cnnlTensorLayout_t layout, std::vector<int> dims) {
+    diopiError_t set(T& t, cnnlTensorLayout_t layout, const SmallVector<int64_t>& dimSize, const SmallVector<int64_t>& dimStride) {
+        cnnlDataType_t dtype;
+        DIOPI_CALL(CnnlDataType::convertToCnnlType(&dtype, t.dtype()));
+        std::vector<int32_t> shape(dimSize.begin(), dimSize.end());
+        std::vector<int32_t> stride(dimStride.begin(), dimStride.end());
+        DIOPI_CALLCNNL(cnnlSetTensorDescriptorEx(get(), layout, dtype, shape.size(), shape.data(), stride.data()));
+        return diopiSuccess;
+    }
+
+    template <typename T>
+    diopiError_t set(T& t, cnnlTensorLayout_t layout, const SmallVector<int>& dims) {
         cnnlDataType_t dtype;
         DIOPI_CALL(CnnlDataType::convertToCnnlType(&dtype, t.dtype()));
         DIOPI_CALLCNNL(cnnlSetTensorDescriptor(get(), layout, dtype, dims.size(), dims.data()));
@@ -12,15 +12,29 @@ diopiError_t cnnl_op_tensor(diopiContextHandle_t ctx, DiopiTensor input, DiopiTe
     DiopiTensor other_casted = other;
     DiopiTensor output_casted = out;
 
-    std::vector<DiopiTensor*> tensors{&input_casted, &other_casted, &output_casted};
-    DIOPI_CALL(autoCastTensorType(ctx, tensors, {diopi_dtype_float16, diopi_dtype_float32, diopi_dtype_int32}));
+    // with beta == 0 the op never reads the output, so its contents need no cast
+    std::vector<DiopiTensor*> tensors{&input_casted, &other_casted};
+    std::vector<DiopiTensor*> outTensors{&output_casted};
+    if (beta != 0) {
+        tensors.push_back(&output_casted);
+        outTensors.clear();
+    }
+    DIOPI_CALL(autoCastTensorType(ctx, tensors, {diopi_dtype_float16, diopi_dtype_float32, diopi_dtype_int32}, outTensors));
+
+    // operands reach the kernel as zero-stride views of the output shape rather than expanded copies
+    if (input_casted.dim() <= output_casted.dim()) {
+        DIOPI_CALL(broadcastView(input_casted, output_casted.shape(), &input_casted));
+    }
+    if (other_casted.dim() <= output_casted.dim()) {
+        DIOPI_CALL(broadcastView(other_casted, output_casted.shape(), &other_casted));
+    }
 
     cnnlDataType_t comp_type;
     DIOPI_CALL(CnnlDataType::convertToCnnlType(&comp_type, input_casted.dtype()));
 
     CnnlResourceGuard<cnnlOpTensorDescriptor_t, cnnlCreateOpTensorDescriptor, cnnlDestroyOpTensorDescriptor> op_desc;
 
-    DIOPI_CALLCNNL(cnnlSetOpTensorDescriptor(op_desc.get(), CNNL_OP_TENSOR_SUB, comp_type, CNNL_NOT_PROPAGATE_NAN));
+    DIOPI_CALLCNNL(cnnlSetOpTensorDescriptor(op_desc.get(), op_type, comp_type, CNNL_NOT_PROPAGATE_NAN));
 
     std::shared_ptr<void> alpha1_value = nullptr;
     std::shared_ptr<void> alpha2_value = nullptr;
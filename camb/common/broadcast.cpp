@@ -4,38 +4,97 @@
  * @copyright  (c) 2023, DeepLink.
  */
 
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
 #include <set>
+#include <string>
 
 #include "common.hpp"
+#include "copy_plan.hpp"
 
 namespace impl {
 namespace camb {
-diopiError_t broadcast(diopiContextHandle_t ctx, DiopiTensor& out, const DiopiTensor& input) {
-    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
-    // check whether input.shape() match the targetShape
-    std::vector<int64_t> targetShape = out.shape();
-    std::vector<int64_t> inputShape = input.shape();
-    int64_t nDimsTarget = targetShape.size();
-    int64_t nDimsInput = inputShape.size();
-    if (nDimsInput < nDimsTarget) {
-        inputShape.insert(inputShape.begin(), nDimsTarget - nDimsInput, 1);
+
+namespace {
+
+// how often a broadcast still had to be materialized, per op; printed at exit when DIOPI_CAMB_BROADCAST_STATS is set
+class BroadcastStats final {
+public:
+    BroadcastStats() : enabled_(std::getenv("DIOPI_CAMB_BROADCAST_STATS") != nullptr) {}
+
+    ~BroadcastStats() {
+        if (!enabled_ || records_.empty()) return;
+        fprintf(stderr, "%-40s %12s %16s %12s\n", "caller", "materialized", "bytes", "views");
+        for (const auto& item : records_) {
+            fprintf(stderr, "%-40s %12ld %16ld %12ld\n", item.first.c_str(), item.second.materialized, item.second.bytes, item.second.views);
+        }
     }
 
-    for (int i = 0; i < nDimsTarget; i++) {
-        DIOPI_CHECK(((inputShape[i] == 1) || (inputShape[i] == targetShape[i])), "shape1 not match shape2, can't broadcast");
+    void recordMaterialized(const char* caller, int64_t bytes) {
+        if (!enabled_) return;
+        std::lock_guard<std::mutex> guard(mutex_);
+        Record& record = records_[caller];
+        record.materialized += 1;
+        record.bytes += bytes;
+    }
+
+    void recordView(const char* caller) {
+        if (!enabled_) return;
+        std::lock_guard<std::mutex> guard(mutex_);
+        records_[caller].views += 1;
+    }
+
+private:
+    struct Record {
+        int64_t materialized = 0;
+        int64_t bytes = 0;
+        int64_t views = 0;
+    };
+
+    const bool enabled_;
+    std::mutex mutex_;
+    std::map<std::string, Record> records_;
+};
+
+BroadcastStats broadcastStats;
+
+}  // namespace
+
+diopiError_t broadcast(diopiContextHandle_t ctx, DiopiTensor& out, const DiopiTensor& input, const char* caller) {
+    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
+    // check whether input.shape() match the targetShape, the missing leading dims of input count as 1
+    const auto& targetShape = out.shape();
+    const auto& inputShape = input.shape();
+    int64_t offset = static_cast<int64_t>(targetShape.size()) - static_cast<int64_t>(inputShape.size());
+    DIOPI_CHECK(offset >= 0, "shape1 not match shape2, can't broadcast");
+    for (size_t i = 0; i < inputShape.size(); i++) {
+        DIOPI_CHECK(((inputShape[i] == 1) || (inputShape[i] == targetShape[i + offset])), "shape1 not match shape2, can't broadcast");
     }
     CnnlTensorDesc inputDesc(input, CNNL_LAYOUT_ARRAY);
     CnnlTensorDesc outDesc(out, CNNL_LAYOUT_ARRAY);
     DIOPI_CALLCNNL(cnnlExpand(handle, inputDesc.get(), const_cast<DiopiTensor&>(input).data(), outDesc.get(), out.data()));
+    broadcastStats.recordMaterialized(caller, out.numel() * out.elemsize());
+    return diopiSuccess;
+}
+
+diopiError_t broadcastView(const DiopiTensor& input, const SmallVector<int64_t>& targetShape, DiopiTensor* out_tensor, const char* caller) {
+    SmallVector<int64_t> stride;
+    DIOPI_CHECK(broadcastStride(input.shape(), input.stride(), targetShape, &stride), "shape1 not match shape2, can't broadcast");
+    *out_tensor = input;
+    if (input.shape() != targetShape) {
+        out_tensor->as_strided(targetShape, stride);
+        broadcastStats.recordView(caller);
+    }
     return diopiSuccess;
 }
 
-diopiError_t broadcastHelper(diopiContextHandle_t ctx, DiopiTensor input_tensor, DiopiTensor target_tensor, DiopiTensor* out_tensor) {
-    diopiTensorHandle_t bcast_input = nullptr;
+diopiError_t broadcastHelper(diopiContextHandle_t ctx, DiopiTensor input_tensor, DiopiTensor target_tensor, DiopiTensor* out_tensor, const char* caller) {
     DiopiTensor bcast_input_tensor;
     if (input_tensor.shape() != target_tensor.shape()) {
         bcast_input_tensor = requiresTensor(ctx, vec2diopiSize_t(target_tensor.shape()), target_tensor.dtype());
-        DIOPI_CALL(broadcast(ctx, bcast_input_tensor, input_tensor));
+        DIOPI_CALL(broadcast(ctx, bcast_input_tensor, input_tensor, caller));
     } else {
         bcast_input_tensor = input_tensor;
     }
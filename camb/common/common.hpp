@@ -16,20 +16,38 @@ namespace impl {
 namespace camb {
 
 
-diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& src, diopiDtype_t destDtype);
+/* `caller` only labels the cast traffic reported when DIOPI_CAMB_CAST_STATS is set. */
+diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& src, diopiDtype_t destDtype, const char* caller = __builtin_FUNCTION());
 
-diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src);
+diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src, const char* caller = __builtin_FUNCTION());
+
+/* Like dataTypeCast, for a tensor the op is about to overwrite: rebinds to a new tensor without casting the contents. */
+diopiError_t dataTypeCastOutput(diopiContextHandle_t ctx, DiopiTensor& dest, diopiDtype_t destDtype, const char* caller = __builtin_FUNCTION());
 
 diopiError_t makeTensorFromScalar(diopiContextHandle_t ctx, const diopiScalar_t* scalar, DiopiTensor& out);
 
-diopiError_t autoCastTensorType(diopiContextHandle_t ctx, const std::vector<DiopiTensor*>& pTensors, const std::set<diopiDtype_t>& opSupportedDtype);
+diopiError_t autoCastTensorType(diopiContextHandle_t ctx, const std::vector<DiopiTensor*>& pTensors, const std::set<diopiDtype_t>& opSupportedDtype,
+                                const char* caller = __builtin_FUNCTION());
+
+/* pOutTensors take part in choosing the target dtype but are only written by the op, so they go through dataTypeCastOutput. */
+diopiError_t autoCastTensorType(diopiContextHandle_t ctx, const std::vector<DiopiTensor*>& pTensors, const std::set<diopiDtype_t>& opSupportedDtype,
+                                const std::vector<DiopiTensor*>& pOutTensors, const char* caller = __builtin_FUNCTION());
 
-diopiError_t broadcast(diopiContextHandle_t ctx, DiopiTensor& out, const DiopiTensor& input);
+/* Materializes input into out with cnnlExpand; counted per caller when DIOPI_CAMB_BROADCAST_STATS is set. */
+diopiError_t broadcast(diopiContextHandle_t ctx, DiopiTensor& out, const DiopiTensor& input, const char* caller = __builtin_FUNCTION());
 
-diopiError_t broadcastHelper(diopiContextHandle_t ctx, DiopiTensor input_tensor, DiopiTensor target_tensor, DiopiTensor* out_tensor);
+/* Zero-stride view of input in targetShape, no copy. Only for kernels that honor descriptor strides; numel() of the view is still the storage's. */
+diopiError_t broadcastView(const DiopiTensor& input, const SmallVector<int64_t>& targetShape, DiopiTensor* out_tensor, const char* caller = __builtin_FUNCTION());
+
+/* Fallback for kernels that need a dense operand of the target shape. */
+diopiError_t broadcastHelper(diopiContextHandle_t ctx, DiopiTensor input_tensor, DiopiTensor target_tensor, DiopiTensor* out_tensor,
+                             const char* caller = __builtin_FUNCTION());
 
 void print_backtrace();
 
+/* Copies src into dest of the same dtype whatever their strides are, broadcasting src to the shape of dest. */
+diopiError_t stridedCopy(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src);
+
 diopiError_t contiguous_(diopiContextHandle_t& ctx, DiopiTensor& src, MemoryFormat memory_format);
 
 diopiError_t contiguous_(diopiContextHandle_t& ctx, DiopiTensor& src, MemoryFormat memory_format, cnnlTensorLayout_t layout_in, cnnlTensorLayout_t layout_out);
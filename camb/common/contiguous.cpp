@@ -5,6 +5,7 @@
  */
 
 #include "common.hpp"
+#include "copy_plan.hpp"
 
 namespace impl {
 namespace camb {
@@ -18,52 +19,52 @@ diopiError_t transpose(diopiContextHandle_t& ctx, DiopiTensor& in, DiopiTensor&
     size_t workspace_size = 0;
     DIOPI_CALLCNNL(cnnlGetTransposeWorkspaceSize(handle, inDesc.get(), transDesc.get(), &workspace_size));
 
-    void* workspace_ptr = workspace_size == 0 ? requiresBuffer(ctx, workspace_size).data() : nullptr;
+    void* workspace_ptr = workspace_size == 0 ? nullptr : requiresBuffer(ctx, workspace_size).data();
     DIOPI_CALLCNNL(cnnlTranspose_v2(handle, transDesc.get(), inDesc.get(), in.data(), outDesc.get(), out.data(), workspace_ptr, workspace_size));
     return diopiSuccess;
 }
 
-void generate_layout_order(int64_t dim, MemoryFormat memory_format, cnnlTensorLayout_t& layout_in, cnnlTensorLayout_t& layout_out, std::vector<int>& order) {
-    if (memory_format == MemoryFormat::Contiguous) {
-        if (dim == 4) {
-            layout_in = CNNL_LAYOUT_NHWC;
-            layout_out = CNNL_LAYOUT_NCHW;
-            order = {0, 3, 1, 2};
-        } else if (dim == 5) {
-            layout_in = CNNL_LAYOUT_NDHWC;
-            layout_out = CNNL_LAYOUT_NCDHW;
-            order = {0, 4, 1, 2, 3};
-        }
-    } else if (memory_format == MemoryFormat::ChannelsLast) {
-        if (dim == 4) {
-            layout_in = CNNL_LAYOUT_NCHW;
-            layout_out = CNNL_LAYOUT_NHWC;
-            order = {0, 2, 3, 1};
-        }
-    } else if (memory_format == MemoryFormat::ChannelsLast3d) {
-        if (dim == 5) {
-            layout_in = CNNL_LAYOUT_NCDHW;
-            layout_out = CNNL_LAYOUT_NDHWC;
-            order = {0, 2, 3, 4, 1};
-        }
+diopiError_t stridedCopy(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src) {
+    DIOPI_CHECK(src.dtype() == dest.dtype(), "the data type of src and dest should be the same");
+    SmallVector<int64_t> srcStride;
+    DIOPI_CHECK(broadcastStride(src.shape(), src.stride(), dest.shape(), &srcStride), "src can not be broadcast to the shape of dest");
+
+    CopyPlan plan = planCopy(dest.shape(), srcStride, dest.stride());
+    if (plan.kind == CopyKind::Empty) return diopiSuccess;
+
+    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
+    DiopiTensor& in = const_cast<DiopiTensor&>(src);
+    CnnlTensorDesc inDesc;
+    CnnlTensorDesc outDesc;
+    if (plan.kind == CopyKind::Memcpy) {
+        SmallVector<int> dims{static_cast<int>(plan.shape[0])};
+        DIOPI_CALL(inDesc.set(in, CNNL_LAYOUT_ARRAY, dims));
+        DIOPI_CALL(outDesc.set(dest, CNNL_LAYOUT_ARRAY, dims));
+        DIOPI_CALLCNNL(cnnlCopy(handle, inDesc.get(), in.data(), outDesc.get(), dest.data()));
+    } else if (plan.kind == CopyKind::Transpose) {
+        DIOPI_CALL(inDesc.set(in, CNNL_LAYOUT_ARRAY, SmallVector<int>(plan.srcShape.begin(), plan.srcShape.end())));
+        DIOPI_CALL(outDesc.set(dest, CNNL_LAYOUT_ARRAY, SmallVector<int>(plan.shape.begin(), plan.shape.end())));
+        CnnlTransposeDescriptor transDesc(plan.order.size(), plan.order.data());
+        size_t workspace_size = 0;
+        DIOPI_CALLCNNL(cnnlGetTransposeWorkspaceSize(handle, inDesc.get(), transDesc.get(), &workspace_size));
+        void* workspace_ptr = workspace_size == 0 ? nullptr : requiresBuffer(ctx, workspace_size).data();
+        DIOPI_CALLCNNL(cnnlTranspose_v2(handle, transDesc.get(), inDesc.get(), in.data(), outDesc.get(), dest.data(), workspace_ptr, workspace_size));
+    } else {
+        DIOPI_CALL(inDesc.set(in, CNNL_LAYOUT_ARRAY, plan.shape, plan.srcStride));
+        DIOPI_CALL(outDesc.set(dest, CNNL_LAYOUT_ARRAY, plan.shape, plan.destStride));
+        DIOPI_CALLCNNL(cnnlCopy(handle, inDesc.get(), in.data(), outDesc.get(), dest.data()));
     }
+    return diopiSuccess;
 }
 
-/* Inplace contiguous, support NCHW <-> NHWC, NCDHW <-> NDHWC */
+/* Inplace contiguous, support any strided view of any rank */
 diopiError_t contiguous_(diopiContextHandle_t& ctx, DiopiTensor& src, MemoryFormat memory_format) {
     if (src.is_contiguous(memory_format)) return diopiSuccess;
-
-    int64_t dim = src.dim();
-    DIOPI_CHECK(dim == 4 || dim == 5, "only support 4d/5d tensor currently");
-
-    cnnlTensorLayout_t layout_in, layout_out;
-    std::vector<int> order;
-
-    generate_layout_order(dim, memory_format, layout_in, layout_out, order);
+    DIOPI_CHECK(memory_format != MemoryFormat::ChannelsLast || src.dim() == 4, "channels last needs a 4d tensor");
+    DIOPI_CHECK(memory_format != MemoryFormat::ChannelsLast3d || src.dim() == 5, "channels last 3d needs a 5d tensor");
 
     DiopiTensor dest = requiresTensor(ctx, src.shape(), src.dtype(), memory_format);
-    DIOPI_CALL(transpose(ctx, src, dest, layout_in, layout_out, order));
-    // DIOPI_CALL(diopiCopyInp(ctx, src.tensorHandle(), dest.tensorHandle()));
+    DIOPI_CALL(stridedCopy(ctx, dest, src));
     src = dest;
     return diopiSuccess;
 }
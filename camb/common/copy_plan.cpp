@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "copy_plan.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace impl {
+namespace camb {
+
+static bool isDense(const SmallVector<int64_t>& shape, const SmallVector<int64_t>& stride, const SmallVector<int>& perm) {
+    int64_t expected = 1;
+    for (size_t i = perm.size(); i > 0; --i) {
+        if (stride[perm[i - 1]] != expected) return false;
+        expected *= shape[perm[i - 1]];
+    }
+    return true;
+}
+
+CopyPlan planCopy(const SmallVector<int64_t>& shape, const SmallVector<int64_t>& srcStride, const SmallVector<int64_t>& destStride) {
+    CopyPlan plan;
+    SmallVector<int> dims;
+    for (size_t i = 0; i < shape.size(); ++i) {
+        if (shape[i] == 0) return plan;
+        if (shape[i] != 1) dims.push_back(i);
+    }
+
+    // walk dims in dest memory order so that a dense dest coalesces completely
+    std::stable_sort(dims.begin(), dims.end(), [&](int a, int b) { return destStride[a] > destStride[b]; });
+    for (int dim : dims) {
+        if (!plan.shape.empty()) {
+            int64_t size = shape[dim];
+            if (plan.destStride.back() == destStride[dim] * size && plan.srcStride.back() == srcStride[dim] * size) {
+                plan.shape.back() *= size;
+                plan.srcStride.back() = srcStride[dim];
+                plan.destStride.back() = destStride[dim];
+                continue;
+            }
+        }
+        plan.shape.push_back(shape[dim]);
+        plan.srcStride.push_back(srcStride[dim]);
+        plan.destStride.push_back(destStride[dim]);
+    }
+    if (plan.shape.empty()) {
+        // a single element
+        plan.shape = {1};
+        plan.srcStride = {1};
+        plan.destStride = {1};
+    }
+
+    SmallVector<int> identity;
+    identity.resize(plan.shape.size());
+    std::iota(identity.begin(), identity.end(), 0);
+    if (!isDense(plan.shape, plan.destStride, identity)) {
+        plan.kind = CopyKind::Strided;
+        return plan;
+    }
+    if (plan.shape.size() == 1 && plan.srcStride[0] == 1) {
+        plan.kind = CopyKind::Memcpy;
+        return plan;
+    }
+
+    SmallVector<int> perm = identity;
+    std::stable_sort(perm.begin(), perm.end(), [&](int a, int b) { return plan.srcStride[a] > plan.srcStride[b]; });
+    if (!isDense(plan.shape, plan.srcStride, perm)) {
+        plan.kind = CopyKind::Strided;
+        return plan;
+    }
+    plan.kind = CopyKind::Transpose;
+    plan.order.resize(perm.size());
+    for (size_t i = 0; i < perm.size(); ++i) {
+        plan.srcShape.push_back(plan.shape[perm[i]]);
+        plan.order[perm[i]] = i;
+    }
+    return plan;
+}
+
+bool storageOrder(const SmallVector<int64_t>& shape, const SmallVector<int64_t>& stride, SmallVector<int>* order) {
+    order->clear();
+    for (size_t i = 0; i < shape.size(); ++i) {
+        if (shape[i] != 1) order->push_back(i);
+    }
+    std::stable_sort(order->begin(), order->end(), [&](int a, int b) { return stride[a] > stride[b]; });
+    return isDense(shape, stride, *order);
+}
+
+bool broadcastStride(const SmallVector<int64_t>& srcShape, const SmallVector<int64_t>& srcStride, const SmallVector<int64_t>& shape,
+                     SmallVector<int64_t>* stride) {
+    if (srcShape.size() > shape.size()) return false;
+    stride->clear();
+    stride->resize(shape.size(), 0);
+    size_t offset = shape.size() - srcShape.size();
+    for (size_t i = 0; i < srcShape.size(); ++i) {
+        if (srcShape[i] == shape[i + offset]) {
+            (*stride)[i + offset] = srcShape[i] == 1 ? 0 : srcStride[i];
+        } else if (srcShape[i] != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace camb
+}  // namespace impl
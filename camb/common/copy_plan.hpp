@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CAMB_COMMON_COPY_PLAN_HPP_
+#define IMPL_CAMB_COMMON_COPY_PLAN_HPP_
+
+#include <cstdint>
+
+#include "../small_vector.hpp"
+
+namespace impl {
+namespace camb {
+
+/* Pure host-side planning for strided copies, kept free of cnnl so it can be checked without a device. */
+
+enum class CopyKind { Empty, Memcpy, Transpose, Strided };
+
+struct CopyPlan {
+    CopyKind kind = CopyKind::Empty;
+    // coalesced dims, ordered from the outermost to the innermost dim of dest
+    SmallVector<int64_t> shape;
+    SmallVector<int64_t> srcStride;
+    SmallVector<int64_t> destStride;
+    // Transpose only: the dense shape src is stored in, and the permutation such that
+    // shape[i] == srcShape[order[i]], as expected by cnnlTranspose
+    SmallVector<int64_t> srcShape;
+    SmallVector<int> order;
+};
+
+/**
+ * Plans copying a tensor of `shape` from `srcStride` to `destStride`. Size-1 dims are dropped and
+ * adjacent dims are merged wherever both sides allow it. The copy is a memcpy when both sides end up
+ * dense in the same order, a single transpose when dest is dense and src is a dense permutation of
+ * it, and a strided copy otherwise (including stride-0 broadcast sources).
+ */
+CopyPlan planCopy(const SmallVector<int64_t>& shape, const SmallVector<int64_t>& srcStride, const SmallVector<int64_t>& destStride);
+
+/**
+ * If `shape`/`stride` describe a dense permutation of a contiguous tensor, sets `order` to its dims of size > 1 from the
+ * outermost to the innermost in memory. Returns false for views with gaps, overlaps or broadcast dims.
+ */
+bool storageOrder(const SmallVector<int64_t>& shape, const SmallVector<int64_t>& stride, SmallVector<int>* order);
+
+/* Strides of `srcShape` broadcast to `shape`, 0 on broadcast dims. Returns false if the shapes do not broadcast. */
+bool broadcastStride(const SmallVector<int64_t>& srcShape, const SmallVector<int64_t>& srcStride, const SmallVector<int64_t>& shape,
+                     SmallVector<int64_t>* stride);
+
+}  // namespace camb
+}  // namespace impl
+
+#endif  // IMPL_CAMB_COMMON_COPY_PLAN_HPP_
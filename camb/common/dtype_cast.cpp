@@ -6,8 +6,14 @@
 
 #include <cnrt.h>
 
+#include <cstdlib>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <set>
+#include <string>
+#include <unordered_map>
 
 #include "common.hpp"
 
@@ -16,82 +22,201 @@ namespace camb {
 
 #define _MAKE_KEY(a, b) (((static_cast<uint64_t>(a) & 0xFFFFFFFF) << 32) | (static_cast<uint64_t>(b) & 0xFFFFFFFF))
 
-inline bool canCastByInt32(uint64_t castType) {
-    // special convert (cnnl doesn't support)
-    constexpr uint64_t BoolInt64 = _MAKE_KEY(diopi_dtype_bool, diopi_dtype_int64);
-    constexpr uint64_t Int16Int64 = _MAKE_KEY(diopi_dtype_int16, diopi_dtype_int64);
-    constexpr uint64_t Uint8Bool = _MAKE_KEY(diopi_dtype_uint8, diopi_dtype_bool);
-    constexpr uint64_t Int16Bool = _MAKE_KEY(diopi_dtype_int16, diopi_dtype_bool);
-    constexpr uint64_t Int64Bool = _MAKE_KEY(diopi_dtype_int64, diopi_dtype_bool);
-    constexpr uint64_t Int8Bool = _MAKE_KEY(diopi_dtype_int8, diopi_dtype_bool);
-    constexpr uint64_t Int8Int64 = _MAKE_KEY(diopi_dtype_int8, diopi_dtype_int64);
-    constexpr uint64_t Int64Int8 = _MAKE_KEY(diopi_dtype_int64, diopi_dtype_int8);
-
-    return BoolInt64 == castType || Int16Int64 == castType || Uint8Bool == castType || Int16Bool == castType || Int64Bool == castType || Int8Bool == castType ||
-           Int8Int64 == castType || Int64Int8 == castType;
-}
+namespace {
 
-inline bool canCastByFloat32(uint64_t castType) {
-    constexpr uint64_t Int64Float64 = _MAKE_KEY(diopi_dtype_int64, diopi_dtype_float64);
-    constexpr uint64_t Float64Int64 = _MAKE_KEY(diopi_dtype_float64, diopi_dtype_int64);
-    return Int64Float64 == castType || Float64Int64 == castType;
+int64_t dtypeSize(diopiDtype_t dtype) {
+    switch (dtype) {
+        case diopi_dtype_bool:
+        case diopi_dtype_int8:
+        case diopi_dtype_uint8:
+            return 1;
+        case diopi_dtype_int16:
+        case diopi_dtype_uint16:
+        case diopi_dtype_float16:
+        case diopi_dtype_bfloat16:
+            return 2;
+        case diopi_dtype_int32:
+        case diopi_dtype_uint32:
+        case diopi_dtype_float32:
+        case diopi_dtype_tfloat32:
+            return 4;
+        default:
+            return 8;
+    }
 }
 
-static diopiError_t dataTypeCastTwice(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src) {
-    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
-    diopiDtype_t srcDtype = src.dtype();
-    diopiDtype_t destDtype = dest.dtype();
-    cnnlCastDataType_t cast_type;
-    // cast through middle
-    auto key = _MAKE_KEY(srcDtype, destDtype);
-    if (canCastByInt32(key)) {
-        DiopiTensor mid = requiresTensor(ctx, src.shape(), diopi_dtype_int32);
-        DIOPI_CALL(dataTypeCast(ctx, mid, src));
-        DIOPI_CALL(dataTypeCast(ctx, dest, mid));
-    } else if (canCastByFloat32) {
-        DiopiTensor mid = requiresTensor(ctx, src.shape(), diopi_dtype_float32);
-        DIOPI_CALL(dataTypeCast(ctx, mid, src));
-        DIOPI_CALL(dataTypeCast(ctx, dest, mid));
-    } else {
-        // TODO(waiting for dispatch) : cast through cpu
-        set_last_error_string("Can not cast from %d to %d at %s:%d ", srcDtype, destDtype, __FILE__, __LINE__);
-        return diopiDtypeNotSupported;
+/* Chain of cnnl casts from one dtype to another, the source dtype excluded. */
+struct CastPlan {
+    std::vector<diopiDtype_t> hops;
+    // bytes read and written per element over all hops
+    int64_t bytesPerElem = 0;
+};
+
+/**
+ * Routes a cast through the cheapest chain of casts cnnl supports natively. The graph is
+ * gCnnlCastDataTypeMapping and the cost of an edge is the bytes it reads plus the bytes it writes,
+ * so a plan never visits a dtype twice and never casts back to where it came from.
+ */
+class CastPlanner final {
+public:
+    // Returns nullptr when no chain of supported casts exists.
+    const CastPlan* plan(diopiDtype_t srcDtype, diopiDtype_t destDtype) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        uint64_t key = _MAKE_KEY(srcDtype, destDtype);
+        auto it = plans_.find(key);
+        if (it == plans_.end()) {
+            it = plans_.emplace(key, search(srcDtype, destDtype)).first;
+        }
+        return it->second.hops.empty() ? nullptr : &it->second;
     }
-    return diopiSuccess;
-}
+
+private:
+    static CastPlan search(diopiDtype_t srcDtype, diopiDtype_t destDtype) {
+        std::map<diopiDtype_t, std::vector<diopiDtype_t>> edges;
+        for (const auto& item : gCnnlCastDataTypeMapping) {
+            edges[item.first[0]].push_back(item.first[1]);
+        }
+
+        using Node = std::pair<int64_t, diopiDtype_t>;
+        std::map<diopiDtype_t, int64_t> cost{{srcDtype, 0}};
+        std::map<diopiDtype_t, diopiDtype_t> prev;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+        queue.emplace(0, srcDtype);
+        while (!queue.empty()) {
+            Node node = queue.top();
+            queue.pop();
+            if (node.first > cost[node.second]) continue;
+            if (node.second == destDtype) break;
+            for (diopiDtype_t next : edges[node.second]) {
+                int64_t nextCost = node.first + dtypeSize(node.second) + dtypeSize(next);
+                auto found = cost.find(next);
+                if (found == cost.end() || nextCost < found->second) {
+                    cost[next] = nextCost;
+                    prev[next] = node.second;
+                    queue.emplace(nextCost, next);
+                }
+            }
+        }
+
+        CastPlan plan;
+        if (srcDtype == destDtype || prev.find(destDtype) == prev.end()) {
+            return plan;
+        }
+        for (diopiDtype_t dtype = destDtype; dtype != srcDtype; dtype = prev[dtype]) {
+            plan.hops.insert(plan.hops.begin(), dtype);
+        }
+        plan.bytesPerElem = cost[destDtype];
+        return plan;
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, CastPlan> plans_;
+};
+
+CastPlanner castPlanner;
+
+/**
+ * Per-caller cast traffic, enabled by setting DIOPI_CAMB_CAST_STATS. The table is written to stderr at
+ * exit; `elided` counts output casts skipped because the op overwrites the tensor anyway.
+ */
+class CastStats final {
+public:
+    CastStats() : enabled_(std::getenv("DIOPI_CAMB_CAST_STATS") != nullptr) {}
+
+    ~CastStats() {
+        if (!enabled_ || records_.empty()) return;
+        fprintf(stderr, "%-40s %12s %16s %12s\n", "caller", "casts", "bytes", "elided");
+        for (const auto& item : records_) {
+            fprintf(stderr, "%-40s %12ld %16ld %12ld\n", item.first.c_str(), item.second.casts, item.second.bytes, item.second.elided);
+        }
+    }
+
+    void record(const char* caller, int64_t bytes) {
+        if (!enabled_) return;
+        std::lock_guard<std::mutex> guard(mutex_);
+        Record& record = records_[caller];
+        record.casts += 1;
+        record.bytes += bytes;
+    }
+
+    void recordElided(const char* caller) {
+        if (!enabled_) return;
+        std::lock_guard<std::mutex> guard(mutex_);
+        records_[caller].elided += 1;
+    }
+
+private:
+    struct Record {
+        int64_t casts = 0;
+        int64_t bytes = 0;
+        int64_t elided = 0;
+    };
+
+    const bool enabled_;
+    std::mutex mutex_;
+    std::map<std::string, Record> records_;
+};
+
+CastStats castStats;
+
+}  // namespace
 
 #undef _MAKE_KEY
 
-diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& src, diopiDtype_t destDtype) {
+static diopiError_t castOnce(cnnlHandle_t handle, DiopiTensor& dest, const DiopiTensor& src) {
+    auto it = gCnnlCastDataTypeMapping.find({src.dtype(), dest.dtype()});
+    DIOPI_CHECK(it != gCnnlCastDataTypeMapping.end(), "cnnl can not cast from %d to %d", src.dtype(), dest.dtype());
+    CnnlTensorDesc srcDesc(src, CNNL_LAYOUT_ARRAY);
+    CnnlTensorDesc destDesc(dest, CNNL_LAYOUT_ARRAY);
+    DIOPI_CALLCNNL(cnnlCastDataType(handle, srcDesc.get(), src.data(), it->second, destDesc.get(), dest.data()));
+    return diopiSuccess;
+}
+
+diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& src, diopiDtype_t destDtype, const char* caller) {
     if (src.dtype() == destDtype) {
         return diopiSuccess;
     }
     DiopiTensor dest = requiresTensor(ctx, src.shape(), destDtype);
-    dataTypeCast(ctx, dest, src);
+    DIOPI_CALL(dataTypeCast(ctx, dest, src, caller));
     src = dest;
     return diopiSuccess;
 }
 
-diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src) {
+diopiError_t dataTypeCast(diopiContextHandle_t ctx, DiopiTensor& dest, const DiopiTensor& src, const char* caller) {
     if (dest.dtype() == src.dtype()) {
         return diopiSuccess;
     }
     // check size of dest and src
     DIOPI_CHECK(src.shape() == dest.shape(), "the shapes of src and dest are not equal");
 
-    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
     diopiDtype_t srcDtype = src.dtype();
     diopiDtype_t destDtype = dest.dtype();
+    const CastPlan* plan = castPlanner.plan(srcDtype, destDtype);
+    if (plan == nullptr) {
+        // TODO(waiting for dispatch) : cast through cpu
+        set_last_error_string("Can not cast from %d to %d at %s:%d ", srcDtype, destDtype, __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
 
-    auto it = gCnnlCastDataTypeMapping.find({srcDtype, destDtype});
-    if (it != gCnnlCastDataTypeMapping.end()) {
-        CnnlTensorDesc srcDesc(src, CNNL_LAYOUT_ARRAY);
-        CnnlTensorDesc destDesc(dest, CNNL_LAYOUT_ARRAY);
-        cnnlCastDataType_t castType = it->second;
-        DIOPI_CALLCNNL(cnnlCastDataType(handle, srcDesc.get(), src.data(), castType, destDesc.get(), dest.data()));
-    } else {
-        DIOPI_CALL(dataTypeCastTwice(ctx, dest, src));
+    // intermediates are temporaries, the last hop writes straight into dest
+    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
+    DiopiTensor from = src;
+    for (size_t i = 0; i + 1 < plan->hops.size(); ++i) {
+        DiopiTensor mid = requiresTensor(ctx, src.shape(), plan->hops[i]);
+        DIOPI_CALL(castOnce(handle, mid, from));
+        from = mid;
+    }
+    DIOPI_CALL(castOnce(handle, dest, from));
+    castStats.record(caller, plan->bytesPerElem * src.numel());
+    return diopiSuccess;
+}
+
+diopiError_t dataTypeCastOutput(diopiContextHandle_t ctx, DiopiTensor& dest, diopiDtype_t destDtype, const char* caller) {
+    if (dest.dtype() == destDtype) {
+        return diopiSuccess;
     }
+    dest = requiresTensor(ctx, dest.shape(), destDtype);
+    castStats.recordElided(caller);
     return diopiSuccess;
 }
 
@@ -115,59 +240,76 @@ static diopiError_t choiceDtype(const std::set<diopiDtype_t>& opSupportedDtypes,
     return diopiSuccess;
 }
 
-diopiError_t autoCastTensorType(diopiContextHandle_t ctx, const std::vector<DiopiTensor*>& pTensors, const std::set<diopiDtype_t>& opSupportedDtype) {
-    std::set<diopiDtype_t> dtypeAndTensorPtrs;
-    diopiDtype_t targetType = diopi_dtype_float32;
-    for (const auto& pTensor : pTensors) {
-        dtypeAndTensorPtrs.insert(pTensor->dtype());
-    }
+static diopiError_t autoChoiceDtype(const std::set<diopiDtype_t>& dtypeAndTensorPtrs, const std::set<diopiDtype_t>& opSupportedDtype, diopiDtype_t* targetType) {
     if (dtypeAndTensorPtrs.find(diopi_dtype_float64) != dtypeAndTensorPtrs.end() || dtypeAndTensorPtrs.find(diopi_dtype_float32) != dtypeAndTensorPtrs.end()) {
         if (opSupportedDtype.find(diopi_dtype_float32) == opSupportedDtype.end()) {  // not support float32
-            DIOPI_CALL(choiceDtype(opSupportedDtype, &targetType));
+            DIOPI_CALL(choiceDtype(opSupportedDtype, targetType));
         } else {  // all tensors cast into float32
-            targetType = diopi_dtype_float32;
+            *targetType = diopi_dtype_float32;
         }
     } else if (dtypeAndTensorPtrs.find(diopi_dtype_float16) != dtypeAndTensorPtrs.end()) {
         if (opSupportedDtype.find(diopi_dtype_float16) == opSupportedDtype.end()) {  // not support float16
-            DIOPI_CALL(choiceDtype(opSupportedDtype, &targetType));
+            DIOPI_CALL(choiceDtype(opSupportedDtype, targetType));
         } else {  // all tensors cast into float16
-            targetType = diopi_dtype_float16;
+            *targetType = diopi_dtype_float16;
         }
     } else if (dtypeAndTensorPtrs.find(diopi_dtype_int64) != dtypeAndTensorPtrs.end() ||
                dtypeAndTensorPtrs.find(diopi_dtype_int32) != dtypeAndTensorPtrs.end() ||
                dtypeAndTensorPtrs.find(diopi_dtype_uint64) != dtypeAndTensorPtrs.end() ||
                dtypeAndTensorPtrs.find(diopi_dtype_uint32) != dtypeAndTensorPtrs.end()) {
         if (opSupportedDtype.find(diopi_dtype_int32) == opSupportedDtype.end()) {  // not support int32
-            DIOPI_CALL(choiceDtype(opSupportedDtype, &targetType));
+            DIOPI_CALL(choiceDtype(opSupportedDtype, targetType));
         } else {  // all tensors cast into int32
-            targetType = diopi_dtype_int32;
+            *targetType = diopi_dtype_int32;
         }
     } else if (dtypeAndTensorPtrs.find(diopi_dtype_int16) != dtypeAndTensorPtrs.end() ||
                dtypeAndTensorPtrs.find(diopi_dtype_uint16) != dtypeAndTensorPtrs.end()) {
         if (opSupportedDtype.find(diopi_dtype_int16) == opSupportedDtype.end()) {  // not support int16
-            DIOPI_CALL(choiceDtype(opSupportedDtype, &targetType));
+            DIOPI_CALL(choiceDtype(opSupportedDtype, targetType));
         } else {  // all tensors cast into int16
-            targetType = diopi_dtype_int16;
+            *targetType = diopi_dtype_int16;
         }
     } else if (dtypeAndTensorPtrs.find(diopi_dtype_int8) != dtypeAndTensorPtrs.end() ||
                dtypeAndTensorPtrs.find(diopi_dtype_uint8) != dtypeAndTensorPtrs.end()) {
         if (opSupportedDtype.find(diopi_dtype_int8) == opSupportedDtype.end()) {  // not support int8
-            DIOPI_CALL(choiceDtype(opSupportedDtype, &targetType));
+            DIOPI_CALL(choiceDtype(opSupportedDtype, targetType));
         } else {  // all tensors cast into int8
-            targetType = diopi_dtype_int8;
+            *targetType = diopi_dtype_int8;
         }
     } else if (dtypeAndTensorPtrs.find(diopi_dtype_bool) != dtypeAndTensorPtrs.end()) {
         if (opSupportedDtype.find(diopi_dtype_bool) == opSupportedDtype.end()) {  // not support bool
-            DIOPI_CALL(choiceDtype(opSupportedDtype, &targetType));
+            DIOPI_CALL(choiceDtype(opSupportedDtype, targetType));
         } else {  // all tensors cast into bool
-            targetType = diopi_dtype_bool;
+            *targetType = diopi_dtype_bool;
         }
     } else {
         set_last_error_string("tensor's dtype error, can't be cast");
         return diopiDtypeNotSupported;
     }
+    return diopiSuccess;
+}
+
+diopiError_t autoCastTensorType(diopiContextHandle_t ctx, const std::vector<DiopiTensor*>& pTensors, const std::set<diopiDtype_t>& opSupportedDtype,
+                                const char* caller) {
+    return autoCastTensorType(ctx, pTensors, opSupportedDtype, {}, caller);
+}
+
+diopiError_t autoCastTensorType(diopiContextHandle_t ctx, const std::vector<DiopiTensor*>& pTensors, const std::set<diopiDtype_t>& opSupportedDtype,
+                                const std::vector<DiopiTensor*>& pOutTensors, const char* caller) {
+    std::set<diopiDtype_t> dtypeAndTensorPtrs;
+    diopiDtype_t targetType = diopi_dtype_float32;
+    for (const auto& pTensor : pTensors) {
+        dtypeAndTensorPtrs.insert(pTensor->dtype());
+    }
+    for (const auto& pTensor : pOutTensors) {
+        dtypeAndTensorPtrs.insert(pTensor->dtype());
+    }
+    DIOPI_CALL(autoChoiceDtype(dtypeAndTensorPtrs, opSupportedDtype, &targetType));
     for (const auto& pTensor : pTensors) {
-        DIOPI_CALL(dataTypeCast(ctx, *pTensor, targetType));
+        DIOPI_CALL(dataTypeCast(ctx, *pTensor, targetType, caller));
+    }
+    for (const auto& pTensor : pOutTensors) {
+        DIOPI_CALL(dataTypeCastOutput(ctx, *pTensor, targetType, caller));
     }
     return diopiSuccess;
 }
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "error.hpp"
+#include "small_vector.hpp"
 namespace impl {
 namespace camb {
 
@@ -106,11 +107,9 @@ public:
             diopiSize_t diopiShape;
             diopiSize_t diopiStride;
             diopiGetTensorShape(tensor_, &diopiShape);
-            std::vector<int64_t> shapeTmp(diopiShape.data, diopiShape.data + diopiShape.len);
+            shape_.assign(diopiShape.data, diopiShape.data + diopiShape.len);
             diopiGetTensorStride(tensor_, &diopiStride);
-            std::vector<int64_t> strideTmp(diopiStride.data, diopiStride.data + diopiStride.len);
-            shape_ = std::move(shapeTmp);
-            stride_ = std::move(strideTmp);
+            stride_.assign(diopiStride.data, diopiStride.data + diopiStride.len);
         }
     }
     explicit DiopiTensor(const diopiConstTensorHandle_t& tensor) : DiopiTensor(const_cast<diopiTensorHandle_t>(tensor)) {}
@@ -123,33 +122,38 @@ public:
         diopiGetTensorDevice(tensor_, &device);
         return device;
     }
+    // dtype, numel and elemsize are fixed for a handle, so each is fetched from the runtime at most once
     diopiDtype_t dtype() const {
         DIOPI_CHECK_NULLPTR_ABORT(tensor_);
-        diopiDtype_t dtype;
-        diopiGetTensorDtype(tensor_, &dtype);
-        return dtype;
+        if (!dtypeCached_) {
+            diopiGetTensorDtype(tensor_, &dtype_);
+            dtypeCached_ = true;
+        }
+        return dtype_;
     }
 
-    const std::vector<int64_t>& shape() const {
+    const SmallVector<int64_t>& shape() const {
         DIOPI_CHECK_NULLPTR_ABORT(tensor_);
         return shape_;
     }
-    const std::vector<int64_t>& stride() const {
+    const SmallVector<int64_t>& stride() const {
         DIOPI_CHECK_NULLPTR_ABORT(tensor_);
         return stride_;
     }
 
     int64_t numel() const {
         DIOPI_CHECK_NULLPTR_ABORT(tensor_);
-        int64_t numel;
-        diopiGetTensorNumel(tensor_, &numel);
-        return numel;
+        if (numel_ < 0) {
+            diopiGetTensorNumel(tensor_, &numel_);
+        }
+        return numel_;
     }
     int64_t elemsize() const {
         DIOPI_CHECK_NULLPTR_ABORT(tensor_);
-        int64_t elemsize;
-        diopiGetTensorElemSize(tensor_, &elemsize);
-        return elemsize;
+        if (elemsize_ < 0) {
+            diopiGetTensorElemSize(tensor_, &elemsize_);
+        }
+        return elemsize_;
     }
     int64_t dim() const { return this->shape().size(); }
 
@@ -202,8 +206,8 @@ public:
     bool is_contiguous(MemoryFormat format = MemoryFormat::Contiguous) {
         int64_t stride = 1;
         int64_t dim = this->dim();
-        auto strides = this->stride();
-        auto shape = this->shape();
+        const auto& strides = this->stride();
+        const auto& shape = this->shape();
 
         if (format == MemoryFormat::Contiguous) {
             for (int i = dim - 1; i >= 0; i--) {
@@ -237,7 +241,13 @@ public:
         return this->numel() != 0;
     }
 
-    void reshape(const std::vector<int64_t> shape) { this->shape_ = shape; }
+    void reshape(const SmallVector<int64_t>& shape) { this->shape_ = shape; }
+
+    // reinterpret the same storage with another geometry, e.g. zero strides for broadcast dims
+    void as_strided(const SmallVector<int64_t>& shape, const SmallVector<int64_t>& stride) {
+        this->shape_ = shape;
+        this->stride_ = stride;
+    }
 
     void* data() {
         void* p = nullptr;
@@ -266,8 +276,12 @@ public:
 
 protected:
     diopiTensorHandle_t tensor_ = 0;
-    std::vector<int64_t> shape_{0};
-    std::vector<int64_t> stride_{0};
+    SmallVector<int64_t> shape_{0};
+    SmallVector<int64_t> stride_{0};
+    mutable diopiDtype_t dtype_ = diopi_dtype_float32;
+    mutable bool dtypeCached_ = false;
+    mutable int64_t numel_ = -1;
+    mutable int64_t elemsize_ = -1;
 };
 
 inline auto makeTensor(diopiContextHandle_t ctx, const diopiScalar_t* pScalar) -> DiopiTensor {
@@ -294,7 +308,7 @@ inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const diopiSize_t& s
     return DiopiTensor(tensor);
 }
 
-inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const std::vector<int64_t>& size, const std::vector<int64_t>& stride, diopiDtype_t dtype) {
+inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const SmallVector<int64_t>& size, const SmallVector<int64_t>& stride, diopiDtype_t dtype) {
     diopiSize_t size_(size.data(), size.size());
     diopiSize_t stride_(stride.data(), stride.size());
     diopiTensorHandle_t tensor = nullptr;
@@ -302,16 +316,17 @@ inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const std::vector<in
     return DiopiTensor(tensor);
 }
 
-inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const std::vector<int64_t>& size, diopiDtype_t dtype) {
+inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const SmallVector<int64_t>& size, diopiDtype_t dtype) {
     diopiSize_t size_(size.data(), size.size());
     diopiTensorHandle_t tensor = nullptr;
     diopiRequireTensor(ctx, &tensor, &size_, nullptr, dtype, diopi_device);
     return DiopiTensor(tensor);
 }
 
-inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const std::vector<int64_t>& size, diopiDtype_t dtype, MemoryFormat memory_format) {
+inline DiopiTensor requiresTensor(diopiContextHandle_t ctx, const SmallVector<int64_t>& size, diopiDtype_t dtype, MemoryFormat memory_format) {
     int64_t dim = size.size();
-    std::vector<int64_t> strides(dim);
+    SmallVector<int64_t> strides;
+    strides.resize(dim);
     int64_t stride = 1;
     if (memory_format == MemoryFormat::Contiguous) {
         for (size_t i = dim; i > 0; --i) {
@@ -373,6 +388,11 @@ inline diopiSize_t vec2diopiSize_t(const std::vector<int64_t>& sizeIn) {
     return diopiSize;
 }
 
+inline diopiSize_t vec2diopiSize_t(const SmallVector<int64_t>& sizeIn) {
+    diopiSize_t diopiSize(sizeIn.data(), sizeIn.size());
+    return diopiSize;
+}
+
 inline void syncStreamInCtx(const diopiContextHandle_t ctx) {
     cnrtQueue_t queue = getStream(ctx);
     cnrtQueueSync(queue);
@@ -41,7 +41,7 @@ DIOPI_API diopiError_t diopiAvgPool2d(diopiContextHandle_t ctx, diopiTensorHandl
     DIOPI_CALL(autoCastTensorType(ctx, pTensors, {diopi_dtype_float16, diopi_dtype_float32}));
     DiopiTensor input_tensor_tmp = *pTensors[0];
     DiopiTensor out_tensor_tmp = out_tensor;
-    DIOPI_CALL(dataTypeCast(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
+    DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
 
     std::vector<int> input_dim = getDim(input_tensor_tmp);
     std::vector<int> out_dim = getDim(out_tensor_tmp);
@@ -20,22 +20,16 @@ diopiError_t diopiCopyInp(diopiContextHandle_t ctx, diopiConstTensorHandle_t src
         return diopiSuccess;
     }
 
-    // TODO(waiting for dispatch): support broadcast, dealing with uncontiguous
-    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
-
     DiopiTensor dest_tr(input);
     DiopiTensor src_tr(src);
 
-
-
     if (src_tr.dtype() != dest_tr.dtype()) {
+        DIOPI_CALL(contiguous_(ctx, src_tr, MemoryFormat::Contiguous));
         DIOPI_CALL(dataTypeCast(ctx, src_tr, dest_tr.dtype()));
     }
 
-    CnnlTensorDesc input_desc(dest_tr, CNNL_LAYOUT_ARRAY);
-    CnnlTensorDesc src_desc(src_tr, CNNL_LAYOUT_ARRAY);
-
-    DIOPI_CALLCNNL(cnnlCopy(handle, src_desc.get(), src_tr.data(), input_desc.get(), dest_tr.data()));
+    // handles broadcast and any strides of src and dest
+    DIOPI_CALL(stridedCopy(ctx, dest_tr, src_tr));
 
     return diopiSuccess;
 }
@@ -19,7 +19,7 @@ DIOPI_API diopiError_t Log(diopiContextHandle_t ctx, diopiTensorHandle_t out, di
     DIOPI_CALL(autoCastTensorType(ctx, pTensors, supportedDtypes));
     DiopiTensor input_tensor_tmp = *pTensors[0];
     DiopiTensor out_tensor_tmp = out_tensor;
-    DIOPI_CALL(dataTypeCast(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
+    DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
 
     CnnlTensorDesc input_desc(input_tensor_tmp, CNNL_LAYOUT_ARRAY);
     CnnlTensorDesc out_desc(out_tensor_tmp, CNNL_LAYOUT_ARRAY);
@@ -30,7 +30,7 @@ DIOPI_API diopiError_t Logic(diopiContextHandle_t ctx, diopiTensorHandle_t out,
 
     DiopiTensor out_tensor_temp = out_tensor;
     if (out_tensor.dtype() != input_tensor.dtype()) {
-        DIOPI_CALL(dataTypeCast(ctx, out_tensor_temp, input_tensor.dtype()));
+        DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_temp, input_tensor.dtype()));
     }
 
     CnnlTensorDesc input_desc(input_tensor, CNNL_LAYOUT_ARRAY);
@@ -82,7 +82,7 @@ DIOPI_API diopiError_t LogicScalar(diopiContextHandle_t ctx, diopiTensorHandle_t
 
     DiopiTensor out_tensor_temp = out_tensor;
     if (out_tensor.dtype() != input_tensor.dtype()) {
-        DIOPI_CALL(dataTypeCast(ctx, out_tensor_temp, input_tensor.dtype()));
+        DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_temp, input_tensor.dtype()));
     }
 
     CnnlTensorDesc input_desc(input_tensor, CNNL_LAYOUT_ARRAY);
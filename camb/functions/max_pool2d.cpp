@@ -43,7 +43,7 @@ DIOPI_API diopiError_t diopiMaxPool2d(diopiContextHandle_t ctx, diopiTensorHandl
     DIOPI_CALL(autoCastTensorType(ctx, pTensors, {diopi_dtype_float16, diopi_dtype_float32}));
     DiopiTensor input_tensor_tmp = *pTensors[0];
     DiopiTensor out_tensor_tmp = out_tensor;
-    DIOPI_CALL(dataTypeCast(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
+    DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
 
     std::vector<int> input_dim = getDim(input_tensor_tmp);
     std::vector<int> out_dim = getDim(out_tensor_tmp);
@@ -117,16 +117,13 @@ DIOPI_API diopiError_t diopiMaxPool2dWithIndices(diopiContextHandle_t ctx, diopi
     DIOPI_CALL(autoCastTensorType(ctx, pTensors, {diopi_dtype_float16, diopi_dtype_float32}));
     DiopiTensor input_tensor_tmp = *pTensors[0];
     DiopiTensor out_tensor_tmp = out_tensor;
-    DIOPI_CALL(dataTypeCast(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
+    DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_tmp, input_tensor_tmp.dtype()));
 
     DiopiTensor indices_tensor_tmp = indices_tensor;
-    if (indices_tensor.dtype() == diopi_dtype_int64) {
-        DIOPI_CALL(dataTypeCast(ctx, indices_tensor_tmp, diopi_dtype_int32));
-    }
     if (input_tensor_tmp.dtype() == diopi_dtype_float16) {
-        DIOPI_CALL(dataTypeCast(ctx, indices_tensor_tmp, diopi_dtype_int16));
+        DIOPI_CALL(dataTypeCastOutput(ctx, indices_tensor_tmp, diopi_dtype_int16));
     } else if (input_tensor_tmp.dtype() == diopi_dtype_float32) {
-        DIOPI_CALL(dataTypeCast(ctx, indices_tensor_tmp, diopi_dtype_int32));
+        DIOPI_CALL(dataTypeCastOutput(ctx, indices_tensor_tmp, diopi_dtype_int32));
     } else {
         DIOPI_CHECK(false, "non-empty 3D or 4D (batch mode) tensor expected for input");
     }
@@ -206,9 +203,6 @@ DIOPI_API diopiError_t diopiMaxPool2dWithIndices(diopiContextHandle_t ctx, diopi
                                                workspace,
                                                workspace_size));
 
-    if (indices_tensor.dtype() == diopi_dtype_int64) {
-        DIOPI_CALL(dataTypeCast(ctx, indices_tensor_tmp, diopi_dtype_int32));
-    }
     DIOPI_CALL(dataTypeCast(ctx, indices_tensor, indices_tensor_tmp));
     DIOPI_CALL(dataTypeCast(ctx, out_tensor, out_tensor_tmp));
 
@@ -235,9 +229,6 @@ DIOPI_API diopiError_t diopiMaxPool2dBackward(diopiContextHandle_t ctx, diopiTen
     DIOPI_CALL(dataTypeCast(ctx, grad_input_tensor_tmp, input_tensor_tmp.dtype()));
 
     DiopiTensor indices_tensor_tmp = indices_tensor;
-    if (indices_tensor.dtype() == diopi_dtype_int64) {
-        DIOPI_CALL(dataTypeCast(ctx, indices_tensor_tmp, diopi_dtype_int32));
-    }
     if (input_tensor_tmp.dtype() == diopi_dtype_float16) {
         DIOPI_CALL(dataTypeCast(ctx, indices_tensor_tmp, diopi_dtype_int16));
     } else if (input_tensor_tmp.dtype() == diopi_dtype_float32) {
@@ -14,34 +14,10 @@ namespace camb {
 extern "C" {
 
 DIOPI_API diopiError_t diopiMul(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiConstTensorHandle_t other) {
-    cnnlHandle_t handle = cnnlHandlePool.get(ctx);
     DiopiTensor input_tensor(input);
     DiopiTensor other_tensor(other);
     DiopiTensor out_tensor(out);
-
-    DiopiTensor out_tensor_tmp = out_tensor;
-    if ((out_tensor.dtype() != diopi_dtype_float16) && (out_tensor.dtype() != diopi_dtype_float32)) {
-        DIOPI_CALL(dataTypeCast(ctx, out_tensor_tmp, diopi_dtype_float32));
-    }
-    DIOPI_CALL(dataTypeCast(ctx, input_tensor, out_tensor_tmp.dtype()));
-    DIOPI_CALL(dataTypeCast(ctx, other_tensor, out_tensor_tmp.dtype()));
-
-    DiopiTensor bcast_input_tensor;
-    broadcastHelper(ctx, input_tensor, out_tensor_tmp, &bcast_input_tensor);
-    DiopiTensor bcast_other_tensor;
-    broadcastHelper(ctx, other_tensor, out_tensor_tmp, &bcast_other_tensor);
-
-    CnnlTensorDesc bcast_input_desc(bcast_input_tensor, CNNL_LAYOUT_ARRAY);
-    CnnlTensorDesc bcast_other_desc(bcast_other_tensor, CNNL_LAYOUT_ARRAY);
-    CnnlTensorDesc out_desc(out_tensor_tmp, CNNL_LAYOUT_ARRAY);
-
-    cnnlTensorDescriptor_t input_descs[] = {bcast_input_desc.get(), bcast_other_desc.get()};
-    const void* inputs[] = {bcast_input_tensor.data(), bcast_other_tensor.data()};
-
-    DIOPI_CALLCNNL(cnnlMulN(handle, input_descs, inputs, 2, out_desc.get(), out_tensor_tmp.data()))
-    if (out_tensor_tmp.dtype() != out_tensor.dtype()) {
-        DIOPI_CALL(dataTypeCast(ctx, out_tensor, out_tensor_tmp));
-    }
+    DIOPI_CALL(cnnl_op_tensor(ctx, input_tensor, other_tensor, out_tensor, CNNL_OP_TENSOR_MUL));
     return diopiSuccess;
 }
 
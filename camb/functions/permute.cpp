@@ -36,7 +36,7 @@ extern "C" diopiError_t diopiPermute(diopiContextHandle_t ctx, diopiTensorHandle
 
     CnnlResourceGuard<cnnlTransposeDescriptor_t, cnnlCreateTransposeDescriptor, cnnlDestroyTransposeDescriptor> trans_desc;
 
-    const std::vector<int64_t> src_input_shape = input_tensor.shape();
+    const SmallVector<int64_t>& src_input_shape = input_tensor.shape();
     int dim_num = src_input_shape.size();
     DIOPI_CALLCNNL(cnnlSetTransposeDescriptor(trans_desc.get(), dim_num, perm_data.data()));
     size_t workspace_size;
@@ -10,6 +10,7 @@
 
 #include "../cnnl_helper.hpp"
 #include "../common/common.hpp"
+#include "../common/copy_plan.hpp"
 
 namespace impl {
 namespace camb {
@@ -32,7 +33,7 @@ std::vector<int64_t> getRealDims(std::vector<int64_t> input_dim, int64_t t_dim)
     return dim_vec;
 }
 
-std::vector<int> infer_desc_shape(std::vector<int64_t> input_dim, std::vector<int64_t> reduce_dim, bool keepdim) {
+std::vector<int> infer_desc_shape(const SmallVector<int64_t>& input_dim, const std::vector<int64_t>& reduce_dim, bool keepdim) {
     std::vector<int> output_dim(input_dim.begin(), input_dim.end());
     if (input_dim.size() == 0) {
         return output_dim;
@@ -63,12 +64,54 @@ static std::unordered_map<cnnlReduceOp_t, std::set<diopiDtype_t>, HashCnnlReduce
     {CNNL_REDUCE_NORM1, {diopi_dtype_float16, diopi_dtype_float32}},
     {CNNL_REDUCE_NORM2, {diopi_dtype_float16, diopi_dtype_float32}}};
 
+/*
+A dense permutation of a contiguous tensor (a transposed or channels-last view) is read as the contiguous tensor of its
+memory order, with size-1 dims dropped and reduce_dim mapped along. This needs no copy as long as the kept dims stay in
+order, since the output then has the same layout either way.
+*/
+static bool viewInMemoryOrder(DiopiTensor& input_tr, std::vector<int64_t>& reduce_dim) {
+    SmallVector<int> order;
+    if (!storageOrder(input_tr.shape(), input_tr.stride(), &order) || order.empty()) return false;
+    std::vector<bool> reduced(input_tr.dim(), false);
+    for (auto d : reduce_dim) {
+        if (d < 0 || d >= input_tr.dim()) return false;
+        reduced[d] = true;
+    }
+    std::vector<int64_t> mapped;
+    SmallVector<int64_t> shape;
+    int last_kept = -1;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (reduced[order[i]]) {
+            mapped.push_back(i);
+        } else if (order[i] < last_kept) {
+            return false;
+        } else {
+            last_kept = order[i];
+        }
+        shape.push_back(input_tr.shape()[order[i]]);
+    }
+    if (mapped.empty()) return false;
+    SmallVector<int64_t> stride;
+    stride.resize(shape.size());
+    int64_t step = 1;
+    for (size_t i = shape.size(); i > 0; --i) {
+        stride[i - 1] = step;
+        step *= shape[i - 1];
+    }
+    input_tr.as_strided(shape, stride);
+    reduce_dim = mapped;
+    return true;
+}
+
 diopiError_t reduce_internal(diopiContextHandle_t ctx, DiopiTensor& input_tr, DiopiTensor& output_tr, DiopiTensor& index_tr,
-                             const std::vector<int64_t> reduce_dim, cnnlReduceOp_t reduce_op) {
+                             std::vector<int64_t> reduce_dim, cnnlReduceOp_t reduce_op) {
     cnnlHandle_t handle = cnnlHandlePool.get(ctx);
 
     DIOPI_CHECK(input_tr.numel() > 0, "operation does not have an identity.");
-    DIOPI_CHECK(input_tr.is_contiguous(), "input tensor should be contiguous");
+    if (!input_tr.is_contiguous() && !viewInMemoryOrder(input_tr, reduce_dim)) {
+        // views with gaps, or whose kept dims are permuted, are still gathered first
+        DIOPI_CALL(contiguous_(ctx, input_tr, MemoryFormat::Contiguous));
+    }
 
     CnnlReduceDescriptor reduce_desc;
     CnnlTensorDesc input_desc;
@@ -22,8 +22,9 @@ diopiError_t softmax_forward(diopiContextHandle_t ctx, DiopiTensor input, DiopiT
     DiopiTensor input_casted = input;
     DiopiTensor output_casted = output;
 
-    std::vector<DiopiTensor*> tensors{&input_casted, &output_casted};
-    DIOPI_CALL(autoCastTensorType(ctx, tensors, {diopi_dtype_float16, diopi_dtype_float32}));
+    std::vector<DiopiTensor*> tensors{&input_casted};
+    std::vector<DiopiTensor*> outTensors{&output_casted};
+    DIOPI_CALL(autoCastTensorType(ctx, tensors, {diopi_dtype_float16, diopi_dtype_float32}, outTensors));
     std::vector<int> src_input_shape{input_casted.shape().begin(), input_casted.shape().end()};
     std::vector<int> src_output_shape{output_casted.shape().begin(), output_casted.shape().end()};
 
@@ -87,8 +88,9 @@ diopiError_t softmax_backward(diopiContextHandle_t ctx, DiopiTensor grad_input_t
     DiopiTensor grad_output_casted = grad_output_tensor;
     DiopiTensor output_casted = output_tensor;
 
-    std::vector<DiopiTensor*> tensors{&grad_input_casted, &grad_output_casted, &output_casted};
-    DIOPI_CALL(autoCastTensorType(ctx, tensors, {diopi_dtype_float16, diopi_dtype_float32}));
+    std::vector<DiopiTensor*> tensors{&grad_output_casted, &output_casted};
+    std::vector<DiopiTensor*> outTensors{&grad_input_casted};
+    DIOPI_CALL(autoCastTensorType(ctx, tensors, {diopi_dtype_float16, diopi_dtype_float32}, outTensors));
 
     std::vector<int> src_output_shape{output_casted.shape().begin(), output_casted.shape().end()};
 
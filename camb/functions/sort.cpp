@@ -40,7 +40,7 @@ DIOPI_API diopiError_t diopiSort(diopiContextHandle_t ctx, diopiTensorHandle_t v
     CnnlTensorDesc indices_desc(indices_tensor_temp, CNNL_LAYOUT_ARRAY);
 
     uint64_t k;
-    std::vector<int64_t> input_shape = input_tensor_temp.shape();
+    const SmallVector<int64_t>& input_shape = input_tensor_temp.shape();
 
     if (dim < 0) {
         dim += input_shape.size();
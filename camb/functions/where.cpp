@@ -24,7 +24,7 @@ DIOPI_API diopiError_t diopiWhere(diopiContextHandle_t ctx, diopiTensorHandle_t
 
     DiopiTensor out_tensor_temp = out_tensor;
     if (out_tensor_temp.dtype() != input_tensor.dtype()) {
-        DIOPI_CALL(dataTypeCast(ctx, out_tensor_temp, input_tensor.dtype()));
+        DIOPI_CALL(dataTypeCastOutput(ctx, out_tensor_temp, input_tensor.dtype()));
     }
 
     CnnlTensorDesc input_desc(input_tensor, CNNL_LAYOUT_ARRAY);
@@ -0,0 +1,160 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CAMB_SMALL_VECTOR_HPP_
+#define IMPL_CAMB_SMALL_VECTOR_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace impl {
+namespace camb {
+
+/**
+ * Vector keeping up to N elements inline, used for tensor shapes and strides so that
+ * building, copying and moving a DiopiTensor needs no heap allocation for ranks <= N.
+ * Larger sizes spill to the heap. The conversion to std::vector is explicit so that any
+ * copy to the heap stays visible at the call site.
+ */
+template <typename T, size_t N = 8>
+class SmallVector final {
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() = default;
+
+    SmallVector(std::initializer_list<T> list) { assign(list.begin(), list.end()); }
+
+    template <typename InputIt>
+    SmallVector(InputIt first, InputIt last) {
+        assign(first, last);
+    }
+
+    SmallVector(const std::vector<T>& vec) { assign(vec.begin(), vec.end()); }  // NOLINT(runtime/explicit)
+
+    SmallVector(const SmallVector& other) { assign(other.begin(), other.end()); }
+
+    SmallVector(SmallVector&& other) noexcept { moveFrom(other); }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) moveFrom(other);
+        return *this;
+    }
+
+    explicit operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        size_t count = std::distance(first, last);
+        reserve(count);
+        std::copy(first, last, data());
+        size_ = count;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity <= this->capacity()) return;
+        std::unique_ptr<T[]> heap(new T[capacity]);
+        std::copy(begin(), end(), heap.get());
+        heap_ = std::move(heap);
+        heapCapacity_ = capacity;
+    }
+
+    void resize(size_t count, const T& value = T()) {
+        reserve(count);
+        if (count > size_) std::fill(data() + size_, data() + count, value);
+        size_ = count;
+    }
+
+    void push_back(const T& value) {
+        if (size_ == capacity()) reserve(2 * capacity());
+        data()[size_++] = value;
+    }
+
+    void clear() { size_ = 0; }
+
+    T* data() { return heap_ ? heap_.get() : inline_; }
+    const T* data() const { return heap_ ? heap_.get() : inline_; }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return heap_ ? heapCapacity_ : N; }
+    bool empty() const { return size_ == 0; }
+
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    T& front() { return data()[0]; }
+    const T& front() const { return data()[0]; }
+    T& back() { return data()[size_ - 1]; }
+    const T& back() const { return data()[size_ - 1]; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size_; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size_; }
+
+private:
+    void moveFrom(SmallVector& other) {
+        if (other.heap_) {
+            heap_ = std::move(other.heap_);
+            heapCapacity_ = other.heapCapacity_;
+            size_ = other.size_;
+        } else {
+            heap_.reset();
+            assign(other.begin(), other.end());
+        }
+        other.size_ = 0;
+    }
+
+    T inline_[N];
+    std::unique_ptr<T[]> heap_;
+    size_t heapCapacity_ = 0;
+    size_t size_ = 0;
+};
+
+template <typename T, size_t N>
+inline bool operator==(const SmallVector<T, N>& lhs, const SmallVector<T, N>& rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <typename T, size_t N>
+inline bool operator==(const SmallVector<T, N>& lhs, const std::vector<T>& rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <typename T, size_t N>
+inline bool operator==(const std::vector<T>& lhs, const SmallVector<T, N>& rhs) {
+    return rhs == lhs;
+}
+
+template <typename T, size_t N>
+inline bool operator!=(const SmallVector<T, N>& lhs, const SmallVector<T, N>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename T, size_t N>
+inline bool operator!=(const SmallVector<T, N>& lhs, const std::vector<T>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename T, size_t N>
+inline bool operator!=(const std::vector<T>& lhs, const SmallVector<T, N>& rhs) {
+    return !(rhs == lhs);
+}
+
+}  // namespace camb
+}  // namespace impl
+
+#endif  // IMPL_CAMB_SMALL_VECTOR_HPP_
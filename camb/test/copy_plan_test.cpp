@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "../common/copy_plan.hpp"
+
+using impl::camb::broadcastStride;
+using impl::camb::CopyKind;
+using impl::camb::CopyPlan;
+using impl::camb::planCopy;
+using impl::camb::SmallVector;
+using impl::camb::storageOrder;
+
+static int failures = 0;
+
+#define EXPECT(cond)                                                  \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            std::printf("%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                               \
+        }                                                             \
+    } while (0)
+
+static void testMemcpy() {
+    // contiguous to contiguous coalesces into one dim, size-1 dims and all
+    CopyPlan plan = planCopy({2, 1, 3, 4}, {12, 7, 4, 1}, {12, 12, 4, 1});
+    EXPECT(plan.kind == CopyKind::Memcpy);
+    EXPECT(plan.shape == std::vector<int64_t>({24}));
+}
+
+static void testTranspose() {
+    // a transposed (3, 4) matrix copied into a contiguous one
+    CopyPlan plan = planCopy({4, 3}, {1, 4}, {3, 1});
+    EXPECT(plan.kind == CopyKind::Transpose);
+    EXPECT(plan.srcShape == std::vector<int64_t>({3, 4}));
+    EXPECT(plan.order == std::vector<int>({1, 0}));
+
+    // NHWC to NCHW: C stays apart, H and W merge
+    plan = planCopy({2, 3, 4, 5}, {60, 1, 15, 3}, {60, 20, 5, 1});
+    EXPECT(plan.kind == CopyKind::Transpose);
+    EXPECT(plan.shape == std::vector<int64_t>({2, 3, 20}));
+    EXPECT(plan.srcShape == std::vector<int64_t>({2, 20, 3}));
+    EXPECT(plan.order == std::vector<int>({0, 2, 1}));
+}
+
+static void testStrided() {
+    // every other column of a (4, 8) matrix is one run with stride 2
+    CopyPlan plan = planCopy({4, 4}, {8, 2}, {4, 1});
+    EXPECT(plan.kind == CopyKind::Strided);
+    EXPECT(plan.shape == std::vector<int64_t>({16}));
+    EXPECT(plan.srcStride == std::vector<int64_t>({2}));
+
+    // the first half of each row of a (4, 8) matrix does not merge
+    plan = planCopy({4, 4}, {8, 1}, {4, 1});
+    EXPECT(plan.kind == CopyKind::Strided);
+    EXPECT(plan.srcStride == std::vector<int64_t>({8, 1}));
+
+    // a row broadcast down a (3, 5) tensor
+    plan = planCopy({3, 5}, {0, 1}, {5, 1});
+    EXPECT(plan.kind == CopyKind::Strided);
+    EXPECT(plan.srcStride == std::vector<int64_t>({0, 1}));
+
+    // a dense source into a non-dense destination
+    plan = planCopy({4, 4}, {4, 1}, {8, 1});
+    EXPECT(plan.kind == CopyKind::Strided);
+}
+
+static void testEmptyAndScalar() {
+    EXPECT(planCopy({3, 0, 2}, {0, 2, 1}, {0, 2, 1}).kind == CopyKind::Empty);
+    CopyPlan plan = planCopy({1, 1}, {5, 9}, {1, 1});
+    EXPECT(plan.kind == CopyKind::Memcpy);
+    EXPECT(plan.shape == std::vector<int64_t>({1}));
+}
+
+static void testStorageOrder() {
+    SmallVector<int> order;
+    EXPECT(storageOrder({2, 3, 4, 5}, {60, 1, 15, 3}, &order));
+    EXPECT(order == std::vector<int>({0, 2, 3, 1}));
+    // size-1 dims are left out whatever their stride
+    EXPECT(storageOrder({4, 1, 3}, {1, 100, 4}, &order));
+    EXPECT(order == std::vector<int>({2, 0}));
+    EXPECT(!storageOrder({4, 4}, {8, 2}, &order));
+    EXPECT(!storageOrder({3, 5}, {0, 1}, &order));
+}
+
+static void testBroadcastStride() {
+    SmallVector<int64_t> stride;
+    // a bias row (C) against (N, C), and a (C, 1) column against (N, C, W)
+    EXPECT(broadcastStride({5}, {1}, {3, 5}, &stride));
+    EXPECT(stride == std::vector<int64_t>({0, 1}));
+    EXPECT(broadcastStride({4, 1}, {1, 1}, {2, 4, 6}, &stride));
+    EXPECT(stride == std::vector<int64_t>({0, 1, 0}));
+    EXPECT(!broadcastStride({4}, {1}, {3, 5}, &stride));
+    EXPECT(!broadcastStride({2, 3}, {3, 1}, {3}, &stride));
+}
+
+int main() {
+    testMemcpy();
+    testTranspose();
+    testStrided();
+    testEmptyAndScalar();
+    testStorageOrder();
+    testBroadcastStride();
+    if (failures == 0) std::printf("copy_plan_test passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -71,6 +72,9 @@ extern "C" diopiError_t diopiActiveRotatedFilter(diopiContextHandle_t ctx, diopi
     auto input = impl::cuda::makeTensor(input_);
     auto indices = impl::cuda::makeTensor(indices_);
     auto output = impl::cuda::makeTensor(output_);
+    if (input.device() == diopi_host) {
+        return impl::cuda::host::activeRotatedFilter(input_, indices_, output_);
+    }
 
     int num_output_planes = input.size(0);
     int num_input_planes = input.size(1);
@@ -105,6 +109,9 @@ extern "C" diopiError_t diopiActiveRotatedFilterBackward(diopiContextHandle_t ct
     auto grad_out = impl::cuda::makeTensor(grad_out_);
     auto indices = impl::cuda::makeTensor(indices_);
     auto grad_in = impl::cuda::makeTensor(grad_in_);
+    if (grad_out.device() == diopi_host) {
+        return impl::cuda::host::activeRotatedFilterBackward(grad_out_, indices_, grad_in_);
+    }
 
     int num_orientations = indices.size(0);
     int kH = indices.size(1);
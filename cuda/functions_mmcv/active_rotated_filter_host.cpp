@@ -0,0 +1,206 @@
+/**
+ * @file active_rotated_filter_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+// distinct (orientations, kernel size, rotations) tables a process keeps plans for
+constexpr size_t kMaxRotationPlans = 8;
+
+/**
+ * The indices table of shape (orientations, kH, kW, rotations), compiled into flat gathers. Entry l of a filter lands
+ * on entry indices[l][k] - 1 of its k-th rotation. gather[k][m] is the entry read for entry m of rotation k, which is
+ * the inverse of the table when every rotation is a permutation. scatter[k][l] is the table itself, transposed so
+ * that backward walks each rotation contiguously.
+ */
+struct RotationPlan {
+    int64_t entries;
+    int64_t rotations;
+    std::vector<int32_t> table;
+    bool permutation;
+    std::vector<int32_t> gather;
+    std::vector<int32_t> scatter;
+};
+
+bool buildRotationPlan(const int32_t* indices, int64_t entries, int64_t rotations, RotationPlan& plan) {
+    plan.entries = entries;
+    plan.rotations = rotations;
+    plan.table.assign(indices, indices + entries * rotations);
+    plan.gather.assign(entries * rotations, -1);
+    plan.scatter.resize(entries * rotations);
+    plan.permutation = true;
+    for (int64_t l = 0; l < entries; ++l) {
+        for (int64_t k = 0; k < rotations; ++k) {
+            const int32_t target = indices[l * rotations + k] - 1;
+            if (target < 0 || target >= entries) return false;
+            plan.scatter[k * entries + l] = target;
+            plan.permutation = plan.permutation && plan.gather[k * entries + target] < 0;
+            plan.gather[k * entries + target] = static_cast<int32_t>(l);
+        }
+    }
+    return true;
+}
+
+/**
+ * Plans are cached by table content; comparing a table of a few hundred entries is cheap next to the weights it
+ * rotates. Returns null if an index is out of range.
+ */
+std::shared_ptr<const RotationPlan> rotationPlan(const int32_t* indices, int64_t entries, int64_t rotations) {
+    static std::mutex mutex;
+    static std::vector<std::shared_ptr<const RotationPlan>> plans;
+    const size_t bytes = entries * rotations * sizeof(int32_t);
+    std::lock_guard<std::mutex> guard(mutex);
+    for (const auto& plan : plans) {
+        if (plan->entries == entries && plan->rotations == rotations && std::memcmp(plan->table.data(), indices, bytes) == 0) return plan;
+    }
+    auto plan = std::make_shared<RotationPlan>();
+    if (!buildRotationPlan(indices, entries, rotations, *plan)) return nullptr;
+    if (plans.size() == kMaxRotationPlans) plans.erase(plans.begin());
+    plans.push_back(plan);
+    return plan;
+}
+
+/**
+ * weight is (O, I, entries), output (O, rotations, I, entries). Output planes (i, k) are written front to back, while
+ * the I rows of filter i they read stay in cache across the rotations.
+ */
+template <typename T>
+void activeRotatedFilterImpl(const T* weight, const RotationPlan& plan, T* output, int64_t outputPlanes, int64_t inputPlanes) {
+    const int64_t entries = plan.entries;
+    const int64_t rotations = plan.rotations;
+    const bool permutation = plan.permutation;
+    parallelFor(0, outputPlanes * rotations, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const int64_t i = plane / rotations;
+            const int64_t k = plane % rotations;
+            const T* filter = weight + i * inputPlanes * entries;
+            T* rotated = output + plane * inputPlanes * entries;
+            if (permutation) {
+                const int32_t* __restrict gather = plan.gather.data() + k * entries;
+                for (int64_t j = 0; j < inputPlanes; ++j) {
+                    const T* __restrict src = filter + j * entries;
+                    T* __restrict dst = rotated + j * entries;
+                    for (int64_t m = 0; m < entries; ++m) {
+                        dst[m] = src[gather[m]];
+                    }
+                }
+            } else {
+                // a table that is not a permutation keeps the scatter order, the last entry writing a target wins
+                const int32_t* scatter = plan.scatter.data() + k * entries;
+                for (int64_t j = 0; j < inputPlanes; ++j) {
+                    for (int64_t l = 0; l < entries; ++l) {
+                        rotated[j * entries + scatter[l]] = filter[j * entries + l];
+                    }
+                }
+            }
+        }
+    });
+}
+
+// the transpose of the forward gather: every entry of grad_in sums the entries it was rotated to
+template <typename T>
+void activeRotatedFilterBackwardImpl(const T* gradOutput, const RotationPlan& plan, T* gradInput, int64_t outputPlanes, int64_t inputPlanes) {
+    const int64_t entries = plan.entries;
+    const int64_t rotations = plan.rotations;
+    parallelFor(0, outputPlanes, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            T* filter = gradInput + i * inputPlanes * entries;
+            std::fill(filter, filter + inputPlanes * entries, T(0));
+            for (int64_t k = 0; k < rotations; ++k) {
+                const int32_t* __restrict scatter = plan.scatter.data() + k * entries;
+                for (int64_t j = 0; j < inputPlanes; ++j) {
+                    const T* __restrict src = gradOutput + ((i * rotations + k) * inputPlanes + j) * entries;
+                    T* __restrict dst = filter + j * entries;
+                    for (int64_t l = 0; l < entries; ++l) {
+                        dst[l] += src[scatter[l]];
+                    }
+                }
+            }
+        }
+    });
+}
+
+}  // namespace
+
+diopiError_t activeRotatedFilter(diopiConstTensorHandle_t input_, diopiConstTensorHandle_t indices_, diopiTensorHandle_t output_) {
+    auto input = makeTensor(input_);
+    auto indices = makeTensor(indices_);
+    auto output = makeTensor(output_);
+    const int64_t num_output_planes = input.size(0);
+    const int64_t num_input_planes = input.size(1);
+    const int64_t entries = input.size(2) * input.size(3) * input.size(4);
+    const int64_t num_rotations = indices.size(3);
+    if (indices.dtype() != diopi_dtype_int32) {
+        set_last_error_string("active rotated filter on host does not support indices dtype %d at %s:%d", indices.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    auto plan = rotationPlan(static_cast<const int32_t*>(indices.data()), entries, num_rotations);
+    if (!plan) {
+        set_last_error_string("active rotated filter indices must lie in [1, %ld] at %s:%d", entries, __FILE__, __LINE__);
+        return diopiErrorOccurred;
+    }
+    if (input.dtype() == diopi_dtype_float32) {
+        activeRotatedFilterImpl(static_cast<const float*>(input.data()), *plan, static_cast<float*>(output.data()), num_output_planes, num_input_planes);
+    } else if (input.dtype() == diopi_dtype_float64) {
+        activeRotatedFilterImpl(static_cast<const double*>(input.data()), *plan, static_cast<double*>(output.data()), num_output_planes, num_input_planes);
+    } else {
+        set_last_error_string("active rotated filter on host does not support dtype %d at %s:%d", input.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t activeRotatedFilterBackward(diopiConstTensorHandle_t grad_out_, diopiConstTensorHandle_t indices_, diopiTensorHandle_t grad_in_) {
+    auto grad_out = makeTensor(grad_out_);
+    auto indices = makeTensor(indices_);
+    auto grad_in = makeTensor(grad_in_);
+    const int64_t num_orientations = indices.size(0);
+    const int64_t entries = num_orientations * indices.size(1) * indices.size(2);
+    const int64_t num_rotations = indices.size(3);
+    const int64_t num_output_planes = grad_out.size(0) / num_rotations;
+    const int64_t num_input_planes = grad_out.size(1) / num_orientations;
+    if (indices.dtype() != diopi_dtype_int32) {
+        set_last_error_string("active rotated filter backward on host does not support indices dtype %d at %s:%d", indices.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    auto plan = rotationPlan(static_cast<const int32_t*>(indices.data()), entries, num_rotations);
+    if (!plan) {
+        set_last_error_string("active rotated filter indices must lie in [1, %ld] at %s:%d", entries, __FILE__, __LINE__);
+        return diopiErrorOccurred;
+    }
+    if (grad_out.dtype() == diopi_dtype_float32) {
+        activeRotatedFilterBackwardImpl(
+            static_cast<const float*>(grad_out.data()), *plan, static_cast<float*>(grad_in.data()), num_output_planes, num_input_planes);
+    } else if (grad_out.dtype() == diopi_dtype_float64) {
+        activeRotatedFilterBackwardImpl(
+            static_cast<const double*>(grad_out.data()), *plan, static_cast<double*>(grad_in.data()), num_output_planes, num_input_planes);
+    } else {
+        set_last_error_string("active rotated filter backward on host does not support dtype %d at %s:%d", grad_out.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
@@ -15,6 +15,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -128,6 +129,9 @@ diopiError_t diopiAssignScoreWithk(diopiContextHandle_t ctx, diopiConstTensorHan
     auto scores = impl::cuda::makeTensor(scores_);
     auto knn_idx = impl::cuda::makeTensor(knn_idx_);
     auto output = impl::cuda::makeTensor(output_);
+    if (points.device() == diopi_host) {
+        return impl::cuda::host::assignScoreWithk(points_, centers_, scores_, knn_idx_, output_, B, N0, N1, M, K, O);
+    }
 
     // // at::cuda::CUDAGuard device_guard(points.device());
     auto stream = impl::cuda::getStream(ctx);
@@ -167,6 +171,10 @@ diopiError_t diopiAssignScoreWithkBackward(diopiContextHandle_t ctx, diopiConstT
     auto grad_points = impl::cuda::makeTensor(grad_points_);
     auto grad_centers = impl::cuda::makeTensor(grad_centers_);
     auto grad_scores = impl::cuda::makeTensor(grad_scores_);
+    if (grad_out.device() == diopi_host) {
+        return impl::cuda::host::assignScoreWithkBackward(
+            grad_out_, points_, centers_, scores_, knn_idx_, grad_points_, grad_centers_, grad_scores_, B, N0, N1, M, K, O);
+    }
 
     // // at::cuda::CUDAGuard device_guard(grad_out.device());
     auto stream = impl::cuda::getStream(ctx);
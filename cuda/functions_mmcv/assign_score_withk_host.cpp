@@ -0,0 +1,324 @@
+/**
+ * @file assign_score_withk_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+/**
+ * Layouts follow the CUDA kernels: points and centers are (B, N0, M, O), scores (B, N1, K, M), knn_idx (B, N1, K) with
+ * the center of point n first, output and grad_out (B, O, N1, K).
+ *
+ * For one point n the op is a batch of K small products: out[k][:] = scores[n][k][:] (1 x M) times the M x O block
+ * points[kn] - centers[cn]. The rows of those blocks are gathered once per point as pointers and shared by the forward
+ * and both backward passes.
+ */
+struct AssignShape {
+    int64_t b;
+    int64_t n0;
+    int64_t n1;
+    int64_t m;
+    int64_t k;
+    int64_t o;
+};
+
+// the M x O blocks of the K neighbours of point n and of its center; a null neighbour is out of range and skipped
+template <typename T>
+void neighbourRows(const T* points, const T* centers, const int64_t* knn, const AssignShape& s, int64_t b, int64_t n, const T** rows, const T** center) {
+    const int64_t* idx = knn + (b * s.n1 + n) * s.k;
+    const int64_t block = s.m * s.o;
+    *center = centers + (b * s.n0 + idx[0]) * block;
+    for (int64_t k = 0; k < s.k; ++k) {
+        rows[k] = idx[k] < 0 || idx[k] >= s.n0 ? nullptr : points + (b * s.n0 + idx[k]) * block;
+    }
+}
+
+// tile[k][o - o0] = grad_out[b][o][n][k] for o in [o0, o1), the K x O slice of point n with o contiguous
+template <typename T>
+void gradTile(const T* gradOut, const AssignShape& s, int64_t b, int64_t n, int64_t o0, int64_t o1, T* tile) {
+    const int64_t width = o1 - o0;
+    for (int64_t o = o0; o < o1; ++o) {
+        const T* src = gradOut + ((b * s.o + o) * s.n1 + n) * s.k;
+        for (int64_t k = 0; k < s.k; ++k) {
+            tile[k * width + o - o0] = src[k];
+        }
+    }
+}
+
+/**
+ * out[o] = sum over m of score[m] * (row[m][o] - center[m][o]). Bases is the compile-time M of the common cases, 0 for
+ * any other M; with it fixed the m loop unrolls and the kLanes accumulators of a tile stay in registers.
+ */
+template <int Bases, typename T>
+void combineBases(const T* score, const T* row, const T* center, int64_t bases, int64_t channels, T* out) {
+    const int64_t m = Bases > 0 ? Bases : bases;
+    int64_t o0 = 0;
+    for (; o0 + kLanes <= channels; o0 += kLanes) {
+        T acc[kLanes] = {};
+        for (int64_t i = 0; i < m; ++i) {
+            const T si = score[i];
+            const T* r = row + i * channels + o0;
+            const T* c = center + i * channels + o0;
+            for (int l = 0; l < kLanes; ++l) {
+                acc[l] += si * (r[l] - c[l]);
+            }
+        }
+        for (int l = 0; l < kLanes; ++l) {
+            out[o0 + l] = acc[l];
+        }
+    }
+    for (; o0 < channels; ++o0) {
+        T acc = 0;
+        for (int64_t i = 0; i < m; ++i) {
+            acc += score[i] * (row[i * channels + o0] - center[i * channels + o0]);
+        }
+        out[o0] = acc;
+    }
+}
+
+/**
+ * The transposed products for one point on the o range of a tile: grad[row][m][:] += score[k][m] * tile[k][:] for every
+ * neighbour, and the center takes minus the sum over k, accumulated in registers and subtracted once.
+ */
+template <int Bases, typename T>
+void spreadBases(const T* scores, T* const* rows, T* center, const T* tile, int64_t bases, int64_t neighbours, int64_t channels, int64_t width) {
+    const int64_t m = Bases > 0 ? Bases : bases;
+    int64_t o0 = 0;
+    for (; o0 + kLanes <= width; o0 += kLanes) {
+        for (int64_t i = 0; i < m; ++i) {
+            T acc[kLanes] = {};
+            for (int64_t k = 0; k < neighbours; ++k) {
+                if (rows[k] == nullptr) continue;
+                const T sk = scores[k * m + i];
+                const T* t = tile + k * width + o0;
+                T* g = rows[k] + i * channels + o0;
+                for (int l = 0; l < kLanes; ++l) {
+                    g[l] += sk * t[l];
+                    acc[l] += sk * t[l];
+                }
+            }
+            T* c = center + i * channels + o0;
+            for (int l = 0; l < kLanes; ++l) {
+                c[l] -= acc[l];
+            }
+        }
+    }
+    for (; o0 < width; ++o0) {
+        for (int64_t i = 0; i < m; ++i) {
+            T acc = 0;
+            for (int64_t k = 0; k < neighbours; ++k) {
+                if (rows[k] == nullptr) continue;
+                const T v = scores[k * m + i] * tile[k * width + o0];
+                rows[k][i * channels + o0] += v;
+                acc += v;
+            }
+            center[i * channels + o0] -= acc;
+        }
+    }
+}
+
+template <int Bases, typename T>
+void assignScoreImpl(const T* points, const T* centers, const T* scores, const int64_t* knn, T* output, const AssignShape& s) {
+    parallelFor(0, s.b * s.n1, 16, [&](int64_t begin, int64_t end) {
+        std::vector<const T*> rows(s.k);
+        std::vector<T> tile(s.k * s.o);
+        for (int64_t bn = begin; bn < end; ++bn) {
+            const int64_t b = bn / s.n1;
+            const int64_t n = bn % s.n1;
+            const T* center = nullptr;
+            neighbourRows(points, centers, knn, s, b, n, rows.data(), &center);
+            const T* score = scores + bn * s.k * s.m;
+            for (int64_t k = 0; k < s.k; ++k) {
+                if (rows[k] == nullptr) continue;
+                combineBases<Bases>(score + k * s.m, rows[k], center, s.m, s.o, tile.data() + k * s.o);
+            }
+            // output is (B, O, N1, K) and accumulated into, like the CUDA kernel
+            for (int64_t o = 0; o < s.o; ++o) {
+                T* dst = output + ((b * s.o + o) * s.n1 + n) * s.k;
+                for (int64_t k = 0; k < s.k; ++k) {
+                    if (rows[k] != nullptr) dst[k] += tile[k * s.o + o];
+                }
+            }
+        }
+    });
+}
+
+template <int Bases, typename T>
+void assignScoreBackwardImpl(const T* gradOut, const T* points, const T* centers, const T* scores, const int64_t* knn, T* gradPoints, T* gradCenters,
+                             T* gradScores, const AssignShape& s) {
+    // points and centers: every worker owns a slice of O for a whole batch, so the neighbour scatter needs no atomics
+    const int64_t slice = 4 * kLanes;
+    const int64_t slices = (s.o + slice - 1) / slice;
+    parallelFor(0, s.b * slices, 1, [&](int64_t begin, int64_t end) {
+        std::vector<const T*> rows(s.k);
+        std::vector<T*> gradRows(s.k);
+        std::vector<T> tile(s.k * slice);
+        for (int64_t bs = begin; bs < end; ++bs) {
+            const int64_t b = bs / slices;
+            const int64_t o0 = bs % slices * slice;
+            const int64_t o1 = std::min(o0 + slice, s.o);
+            for (int64_t n = 0; n < s.n1; ++n) {
+                const T* center = nullptr;
+                neighbourRows(points, centers, knn, s, b, n, rows.data(), &center);
+                for (int64_t k = 0; k < s.k; ++k) {
+                    gradRows[k] = rows[k] == nullptr ? nullptr : gradPoints + (rows[k] - points) + o0;
+                }
+                gradTile(gradOut, s, b, n, o0, o1, tile.data());
+                spreadBases<Bases>(
+                    scores + (b * s.n1 + n) * s.k * s.m, gradRows.data(), gradCenters + (center - centers) + o0, tile.data(), s.m, s.k, s.o, o1 - o0);
+            }
+        }
+    });
+    // scores: one point per task, reading the same gathered rows against its gradient tile
+    parallelFor(0, s.b * s.n1, 16, [&](int64_t begin, int64_t end) {
+        std::vector<const T*> rows(s.k);
+        std::vector<T> tile(s.k * s.o);
+        for (int64_t bn = begin; bn < end; ++bn) {
+            const int64_t b = bn / s.n1;
+            const int64_t n = bn % s.n1;
+            const T* center = nullptr;
+            neighbourRows(points, centers, knn, s, b, n, rows.data(), &center);
+            gradTile(gradOut, s, b, n, 0, s.o, tile.data());
+            T* grad = gradScores + bn * s.k * s.m;
+            for (int64_t k = 0; k < s.k; ++k) {
+                if (rows[k] == nullptr) continue;
+                const T* __restrict t = tile.data() + k * s.o;
+                for (int64_t i = 0; i < s.m; ++i) {
+                    const T* __restrict r = rows[k] + i * s.o;
+                    const T* __restrict c = center + i * s.o;
+                    T acc = 0;
+                    for (int64_t o = 0; o < s.o; ++o) {
+                        acc += (r[o] - c[o]) * t[o];
+                    }
+                    grad[k * s.m + i] += acc;
+                }
+            }
+        }
+    });
+}
+
+// the weight bank sizes of PAConv configurations get a specialized micro-kernel, anything else the generic one
+template <typename F>
+void dispatchBases(int64_t bases, const F& f) {
+    switch (bases) {
+        case 4:
+            f(std::integral_constant<int, 4>());
+            break;
+        case 8:
+            f(std::integral_constant<int, 8>());
+            break;
+        case 16:
+            f(std::integral_constant<int, 16>());
+            break;
+        default:
+            f(std::integral_constant<int, 0>());
+            break;
+    }
+}
+
+template <typename T>
+void assignScoreDispatch(const void* points, const void* centers, const void* scores, const int64_t* knn, void* output, const AssignShape& s) {
+    dispatchBases(s.m, [&](auto bases) {
+        assignScoreImpl<decltype(bases)::value>(
+            static_cast<const T*>(points), static_cast<const T*>(centers), static_cast<const T*>(scores), knn, static_cast<T*>(output), s);
+    });
+}
+
+template <typename T>
+void assignScoreBackwardDispatch(const void* gradOut, const void* points, const void* centers, const void* scores, const int64_t* knn, void* gradPoints,
+                                 void* gradCenters, void* gradScores, const AssignShape& s) {
+    dispatchBases(s.m, [&](auto bases) {
+        assignScoreBackwardImpl<decltype(bases)::value>(static_cast<const T*>(gradOut),
+                                                        static_cast<const T*>(points),
+                                                        static_cast<const T*>(centers),
+                                                        static_cast<const T*>(scores),
+                                                        knn,
+                                                        static_cast<T*>(gradPoints),
+                                                        static_cast<T*>(gradCenters),
+                                                        static_cast<T*>(gradScores),
+                                                        s);
+    });
+}
+
+}  // namespace
+
+diopiError_t assignScoreWithk(diopiConstTensorHandle_t points_, diopiConstTensorHandle_t centers_, diopiConstTensorHandle_t scores_,
+                              diopiConstTensorHandle_t knn_idx_, diopiTensorHandle_t output_, int64_t B, int64_t N0, int64_t N1, int64_t M, int64_t K,
+                              int64_t O) {
+    auto points = makeTensor(points_);
+    auto centers = makeTensor(centers_);
+    auto scores = makeTensor(scores_);
+    auto knn_idx = makeTensor(knn_idx_);
+    auto output = makeTensor(output_);
+    const int64_t* knn = static_cast<const int64_t*>(knn_idx.data());
+    if (points.dtype() == diopi_dtype_float32) {
+        assignScoreDispatch<float>(points.data(), centers.data(), scores.data(), knn, output.data(), AssignShape{B, N0, N1, M, K, O});
+    } else if (points.dtype() == diopi_dtype_float64) {
+        assignScoreDispatch<double>(points.data(), centers.data(), scores.data(), knn, output.data(), AssignShape{B, N0, N1, M, K, O});
+    } else {
+        set_last_error_string("assign score withk on host does not support dtype %d at %s:%d", points.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t assignScoreWithkBackward(diopiConstTensorHandle_t grad_out_, diopiConstTensorHandle_t points_, diopiConstTensorHandle_t centers_,
+                                      diopiConstTensorHandle_t scores_, diopiConstTensorHandle_t knn_idx_, diopiTensorHandle_t grad_points_,
+                                      diopiTensorHandle_t grad_centers_, diopiTensorHandle_t grad_scores_, int64_t B, int64_t N0, int64_t N1, int64_t M,
+                                      int64_t K, int64_t O) {
+    auto grad_out = makeTensor(grad_out_);
+    auto points = makeTensor(points_);
+    auto centers = makeTensor(centers_);
+    auto scores = makeTensor(scores_);
+    auto knn_idx = makeTensor(knn_idx_);
+    auto grad_points = makeTensor(grad_points_);
+    auto grad_centers = makeTensor(grad_centers_);
+    auto grad_scores = makeTensor(grad_scores_);
+    const int64_t* knn = static_cast<const int64_t*>(knn_idx.data());
+    if (grad_out.dtype() == diopi_dtype_float32) {
+        assignScoreBackwardDispatch<float>(grad_out.data(),
+                                           points.data(),
+                                           centers.data(),
+                                           scores.data(),
+                                           knn,
+                                           grad_points.data(),
+                                           grad_centers.data(),
+                                           grad_scores.data(),
+                                           AssignShape{B, N0, N1, M, K, O});
+    } else if (grad_out.dtype() == diopi_dtype_float64) {
+        assignScoreBackwardDispatch<double>(grad_out.data(),
+                                            points.data(),
+                                            centers.data(),
+                                            scores.data(),
+                                            knn,
+                                            grad_points.data(),
+                                            grad_centers.data(),
+                                            grad_scores.data(),
+                                            AssignShape{B, N0, N1, M, K, O});
+    } else {
+        set_last_error_string("assign score withk backward on host does not support dtype %d at %s:%d", grad_out.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -100,6 +101,9 @@ diopiError_t diopiBboxOverlaps(diopiContextHandle_t ctx, diopiConstTensorHandle_
     auto bboxes1 = impl::cuda::makeTensor(bboxes1_);
     auto bboxes2 = impl::cuda::makeTensor(bboxes2_);
     auto ious = impl::cuda::makeTensor(ious_);
+    if (bboxes1.device() == diopi_host) {
+        return impl::cuda::host::bboxOverlaps(bboxes1_, bboxes2_, ious_, mode, aligned, offset);
+    }
     int output_size = ious.numel();
     int num_bbox1 = bboxes1.size(0);
     int num_bbox2 = bboxes2.size(0);
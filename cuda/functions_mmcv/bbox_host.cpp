@@ -0,0 +1,207 @@
+/**
+ * @file bbox_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+enum BboxOverlapMode { kIoU = 0, kIoF = 1, kGIoU = 2 };
+
+// columns of bboxes2 swept per tile: five SoA arrays of this length stay in L1 while a block of rows reuses them
+constexpr int64_t kBboxTile = 1024;
+constexpr int64_t kBboxRows = 16;
+// smallest union and enclosing area of GIoU
+constexpr double kGIoUEps = 1e-6;
+
+template <typename T>
+inline T maxOf(T a, T b) {
+    return a > b ? a : b;
+}
+
+template <typename T>
+inline T minOf(T a, T b) {
+    return a < b ? a : b;
+}
+
+// bboxes2 converted to SoA once, with the areas precomputed
+template <typename T>
+struct BoxesSoA {
+    BoxesSoA(const T* boxes, int64_t num, T offset) : x1(num), y1(num), x2(num), y2(num), area(num) {
+        parallelFor(0, num, 4096, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                x1[i] = boxes[i * 4 + 0];
+                y1[i] = boxes[i * 4 + 1];
+                x2[i] = boxes[i * 4 + 2];
+                y2[i] = boxes[i * 4 + 3];
+                area[i] = (x2[i] - x1[i] + offset) * (y2[i] - y1[i] + offset);
+            }
+        });
+    }
+
+    std::vector<T> x1;
+    std::vector<T> y1;
+    std::vector<T> x2;
+    std::vector<T> y2;
+    std::vector<T> area;
+};
+
+/**
+ * The same arithmetic as the CUDA kernel for IoU and IoF. GIoU is host only; as in mmcv's bbox_overlaps its union and
+ * enclosing areas are clamped to kGIoUEps, so degenerate boxes with offset 0 give a finite result.
+ */
+template <int Mode, typename T>
+inline T overlap(T ax1, T ay1, T ax2, T ay2, T aArea, T bx1, T by1, T bx2, T by2, T bArea, T offset) {
+    const T width = maxOf(minOf(ax2, bx2) - maxOf(ax1, bx1) + offset, T(0));
+    const T height = maxOf(minOf(ay2, by2) - maxOf(ay1, by1) + offset, T(0));
+    const T interS = width * height;
+    const T unionS = aArea + bArea - interS;
+    const T floorS = Mode == kGIoU ? maxOf(offset, T(kGIoUEps)) : offset;
+    const T baseS = maxOf(Mode == kIoF ? aArea : unionS, floorS);
+    if (Mode != kGIoU) return interS / baseS;
+    const T enclosedS = maxOf((maxOf(ax2, bx2) - minOf(ax1, bx1) + offset) * (maxOf(ay2, by2) - minOf(ay1, by1) + offset), floorS);
+    return interS / baseS - (enclosedS - baseS) / enclosedS;
+}
+
+// one row of bboxes1 against columns [j0, j1) of bboxes2; a plain counted loop over restrict pointers that the compiler vectorizes
+template <int Mode, typename T>
+void overlapRow(const T* box, T offset, const BoxesSoA<T>& soa, int64_t j0, int64_t j1, T* __restrict out) {
+    const T ax1 = box[0];
+    const T ay1 = box[1];
+    const T ax2 = box[2];
+    const T ay2 = box[3];
+    const T aArea = (ax2 - ax1 + offset) * (ay2 - ay1 + offset);
+    const T* __restrict bx1 = soa.x1.data();
+    const T* __restrict by1 = soa.y1.data();
+    const T* __restrict bx2 = soa.x2.data();
+    const T* __restrict by2 = soa.y2.data();
+    const T* __restrict bArea = soa.area.data();
+    for (int64_t j = j0; j < j1; ++j) {
+        out[j - j0] = overlap<Mode>(ax1, ay1, ax2, ay2, aArea, bx1[j], by1[j], bx2[j], by2[j], bArea[j], offset);
+    }
+}
+
+template <typename O, typename T>
+inline O storeAs(T value) {
+    return static_cast<O>(value);
+}
+
+template <>
+inline uint16_t storeAs<uint16_t, float>(float value) {
+    return floatToHalfBits(value);
+}
+
+template <typename O, typename T>
+inline void storeRow(const T* values, int64_t num, O* out) {
+    for (int64_t j = 0; j < num; ++j) {
+        out[j] = storeAs<O>(values[j]);
+    }
+}
+
+// O is the element type of ious: T itself, or uint16_t half bits when fp16 output is requested for float boxes
+template <int Mode, typename O, typename T>
+void overlapsPairwise(const T* bboxes1, const T* bboxes2, O* ious, int64_t num1, int64_t num2, T offset) {
+    const BoxesSoA<T> soa(bboxes2, num2, offset);
+    const int64_t blocks = (num1 + kBboxRows - 1) / kBboxRows;
+    parallelFor(0, blocks, 1, [&](int64_t begin, int64_t end) {
+        std::vector<T> row(std::is_same<O, T>::value ? 0 : std::min(kBboxTile, num2));
+        for (int64_t block = begin; block < end; ++block) {
+            const int64_t i0 = block * kBboxRows;
+            const int64_t i1 = std::min(i0 + kBboxRows, num1);
+            for (int64_t j0 = 0; j0 < num2; j0 += kBboxTile) {
+                const int64_t j1 = std::min(j0 + kBboxTile, num2);
+                for (int64_t i = i0; i < i1; ++i) {
+                    O* out = ious + i * num2 + j0;
+                    if (std::is_same<O, T>::value) {
+                        overlapRow<Mode>(bboxes1 + i * 4, offset, soa, j0, j1, reinterpret_cast<T*>(out));
+                    } else {
+                        overlapRow<Mode>(bboxes1 + i * 4, offset, soa, j0, j1, row.data());
+                        storeRow(row.data(), j1 - j0, out);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <int Mode, typename O, typename T>
+void overlapsAligned(const T* bboxes1, const T* bboxes2, O* ious, int64_t num, T offset) {
+    parallelFor(0, num, 4096, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            const T* a = bboxes1 + i * 4;
+            const T* b = bboxes2 + i * 4;
+            const T aArea = (a[2] - a[0] + offset) * (a[3] - a[1] + offset);
+            const T bArea = (b[2] - b[0] + offset) * (b[3] - b[1] + offset);
+            ious[i] = storeAs<O>(overlap<Mode>(a[0], a[1], a[2], a[3], aArea, b[0], b[1], b[2], b[3], bArea, offset));
+        }
+    });
+}
+
+template <int Mode, typename O, typename T>
+void bboxOverlapsImpl(const void* bboxes1, const void* bboxes2, void* ious, int64_t num1, int64_t num2, bool aligned, T offset) {
+    if (aligned) {
+        overlapsAligned<Mode>(static_cast<const T*>(bboxes1), static_cast<const T*>(bboxes2), static_cast<O*>(ious), num1, offset);
+    } else {
+        overlapsPairwise<Mode>(static_cast<const T*>(bboxes1), static_cast<const T*>(bboxes2), static_cast<O*>(ious), num1, num2, offset);
+    }
+}
+
+template <typename O, typename T>
+void bboxOverlapsDispatch(const void* bboxes1, const void* bboxes2, void* ious, int64_t num1, int64_t num2, int64_t mode, bool aligned, T offset) {
+    if (mode == kIoU) {
+        bboxOverlapsImpl<kIoU, O, T>(bboxes1, bboxes2, ious, num1, num2, aligned, offset);
+    } else if (mode == kIoF) {
+        bboxOverlapsImpl<kIoF, O, T>(bboxes1, bboxes2, ious, num1, num2, aligned, offset);
+    } else {
+        bboxOverlapsImpl<kGIoU, O, T>(bboxes1, bboxes2, ious, num1, num2, aligned, offset);
+    }
+}
+
+}  // namespace
+
+diopiError_t bboxOverlaps(diopiConstTensorHandle_t bboxes1_, diopiConstTensorHandle_t bboxes2_, diopiTensorHandle_t ious_, int64_t mode, bool aligned,
+                          int64_t offset) {
+    auto bboxes1 = makeTensor(bboxes1_);
+    auto bboxes2 = makeTensor(bboxes2_);
+    auto ious = makeTensor(ious_);
+    const int64_t num_bbox1 = bboxes1.size(0);
+    const int64_t num_bbox2 = bboxes2.size(0);
+    if (mode < kIoU || mode > kGIoU) {
+        set_last_error_string("bbox overlaps mode %ld is not one of iou(0), iof(1), giou(2) at %s:%d", mode, __FILE__, __LINE__);
+        return diopiErrorOccurred;
+    }
+    const diopiDtype_t dtype = bboxes1.dtype();
+    const diopiDtype_t outDtype = ious.dtype();
+    if (dtype == diopi_dtype_float32 && outDtype == diopi_dtype_float32) {
+        bboxOverlapsDispatch<float, float>(bboxes1.data(), bboxes2.data(), ious.data(), num_bbox1, num_bbox2, mode, aligned, static_cast<float>(offset));
+    } else if (dtype == diopi_dtype_float32 && outDtype == diopi_dtype_float16) {
+        // computed in float, stored as half to halve the bandwidth of large overlap matrices
+        bboxOverlapsDispatch<uint16_t, float>(bboxes1.data(), bboxes2.data(), ious.data(), num_bbox1, num_bbox2, mode, aligned, static_cast<float>(offset));
+    } else if (dtype == diopi_dtype_float64 && outDtype == diopi_dtype_float64) {
+        bboxOverlapsDispatch<double, double>(bboxes1.data(), bboxes2.data(), ious.data(), num_bbox1, num_bbox2, mode, aligned, static_cast<double>(offset));
+    } else {
+        set_last_error_string("bbox overlaps on host does not support dtype %d with output dtype %d at %s:%d", dtype, outDtype, __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
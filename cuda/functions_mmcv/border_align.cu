@@ -16,6 +16,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -197,6 +198,9 @@ diopiError_t diopiBorderAlign(diopiContextHandle_t ctx, diopiConstTensorHandle_t
     auto boxes = impl::cuda::makeTensor(boxes_);
     auto output = impl::cuda::makeTensor(output_);
     auto argmax_idx = impl::cuda::makeTensor(argmax_idx_);
+    if (input.device() == diopi_host) {
+        return impl::cuda::host::borderAlign(input_, boxes_, output_, argmax_idx_, pool_size);
+    }
     // shape assertion
     assert(input.ndimension() == 4);
     assert(boxes.ndimension() == 3);
@@ -238,6 +242,9 @@ diopiError_t diopiBorderAlignBackward(diopiContextHandle_t ctx, diopiConstTensor
     auto boxes = impl::cuda::makeTensor(boxes_);
     auto argmax_idx = impl::cuda::makeTensor(argmax_idx_);
     auto grad_input = impl::cuda::makeTensor(grad_input_);
+    if (grad_output.device() == diopi_host) {
+        return impl::cuda::host::borderAlignBackward(grad_output_, boxes_, argmax_idx_, grad_input_, pool_size);
+    }
 
     int batch_size = grad_input.size(0);
     int feat_channels = grad_input.size(1);
@@ -0,0 +1,257 @@
+/**
+ * @file border_align_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+// the input holds the features of the top, left, bottom and right borders as four consecutive groups of channels
+constexpr int kBorderGroups = 4;
+
+// start and step of border g of an (x1, y1, x2, y2) box: top and left walk from (x1, y1), bottom and right walk back from (x2, y2)
+template <typename T>
+inline void borderWalk(const T* box, int64_t poolSize, int g, T* x, T* y, T* xStride, T* yStride) {
+    const T boxWidth = box[2] - box[0];
+    const T boxHeight = box[3] - box[1];
+    *x = box[g / 2 * 2];
+    *y = box[g / 2 * 2 + 1];
+    *xStride = g == 0 ? boxWidth / poolSize : (g == 2 ? -boxWidth / poolSize : 0);
+    *yStride = g == 1 ? boxHeight / poolSize : (g == 3 ? -boxHeight / poolSize : 0);
+}
+
+// the pool_size + 1 sampling points of the four borders of one box, group by group, stepped the way the CUDA forward kernel steps them
+template <typename T>
+void borderPoints(const T* box, int64_t height, int64_t width, int64_t poolSize, BilinearPoint<T>* points) {
+    for (int g = 0; g < kBorderGroups; ++g) {
+        T x, y, xStride, yStride;
+        borderWalk(box, poolSize, g, &x, &y, &xStride, &yStride);
+        BilinearPoint<T>* out = points + g * (poolSize + 1);
+        out[0] = bilinearPoint(height, width, y, x);
+        for (int64_t i = 1; i <= poolSize; ++i) {
+            x += xStride;
+            y += yStride;
+            out[i] = bilinearPoint(height, width, y, x);
+        }
+    }
+}
+
+// the bilinear samples of one point for all channels, taken into the running max when First is false
+template <bool First, typename T>
+inline void borderMaxStep(const T* image, int64_t pixelStride, int64_t channels, const BilinearPoint<T>& p, int32_t index, T* __restrict maxVal,
+                          int32_t* __restrict maxIdx) {
+    const T* __restrict v0 = image + p.offset[0] * pixelStride;
+    const T* __restrict v1 = image + p.offset[1] * pixelStride;
+    const T* __restrict v2 = image + p.offset[2] * pixelStride;
+    const T* __restrict v3 = image + p.offset[3] * pixelStride;
+    for (int64_t c = 0; c < channels; ++c) {
+        const T val = p.weight[0] * v0[c] + p.weight[1] * v1[c] + p.weight[2] * v2[c] + p.weight[3] * v3[c];
+        if (First) {
+            maxVal[c] = val;
+            maxIdx[c] = 0;
+        } else {
+            // strictly larger wins, like the CUDA kernel; the mask select keeps the loop vectorizable
+            const int32_t m = -static_cast<int32_t>(val > maxVal[c]);
+            maxVal[c] = val > maxVal[c] ? val : maxVal[c];
+            maxIdx[c] = (index & m) | (maxIdx[c] & ~m);
+        }
+    }
+}
+
+/**
+ * Max pooling of one border for all channels of its group at once: image points at the group's channel slice of a
+ * channels-last image with pixelStride channels per pixel, so every sample is a contiguous run of channels.
+ */
+template <typename T>
+void borderMax(const T* image, int64_t pixelStride, int64_t channels, const BilinearPoint<T>* points, int64_t poolSize, T* maxVal, int32_t* maxIdx) {
+    borderMaxStep<true>(image, pixelStride, channels, points[0], 0, maxVal, maxIdx);
+    for (int64_t i = 1; i <= poolSize; ++i) {
+        borderMaxStep<false>(image, pixelStride, channels, points[i], static_cast<int32_t>(i), maxVal, maxIdx);
+    }
+}
+
+// I is the argmax element type: int32_t like the CUDA kernel, or int16_t to halve the argmax memory
+template <typename T, typename I>
+void borderAlignImpl(const T* input, const T* boxes, T* output, I* argmax, int64_t batch, int64_t channels, int64_t height, int64_t width, int64_t boxSize,
+                     int64_t poolSize) {
+    const std::vector<T> nhwc = toChannelsLast(input, batch, channels * kBorderGroups, height, width);
+    const int64_t pixelStride = channels * kBorderGroups;
+    parallelFor(0, batch * boxSize, 16, [&](int64_t begin, int64_t end) {
+        std::vector<BilinearPoint<T>> points(kBorderGroups * (poolSize + 1));
+        std::vector<T> maxVal(channels);
+        std::vector<int32_t> maxIdx(channels);
+        for (int64_t nb = begin; nb < end; ++nb) {
+            const int64_t n = nb / boxSize;
+            const int64_t b = nb % boxSize;
+            borderPoints(boxes + nb * 4, height, width, poolSize, points.data());
+            for (int g = 0; g < kBorderGroups; ++g) {
+                const T* image = nhwc.data() + n * height * width * pixelStride + g * channels;
+                borderMax(image, pixelStride, channels, points.data() + g * (poolSize + 1), poolSize, maxVal.data(), maxIdx.data());
+                // output and argmax are (N, C, box_size, 4)
+                const int64_t base = (n * channels * boxSize + b) * kBorderGroups + g;
+                for (int64_t c = 0; c < channels; ++c) {
+                    output[base + c * boxSize * kBorderGroups] = maxVal[c];
+                    argmax[base + c * boxSize * kBorderGroups] = static_cast<I>(maxIdx[c]);
+                }
+            }
+        }
+    });
+}
+
+template <typename T, typename I>
+void borderAlignBackwardImpl(const T* gradOutput, const T* boxes, const I* argmax, T* gradInput, int64_t batch, int64_t channels, int64_t height,
+                             int64_t width, int64_t boxSize, int64_t poolSize) {
+    // every worker owns whole (image, channel) planes of grad_input, so the scatter needs no atomics
+    const int64_t planes = batch * channels * kBorderGroups;
+    parallelFor(0, planes, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const int64_t n = plane / (channels * kBorderGroups);
+            const int64_t g = plane / channels % kBorderGroups;
+            const int64_t c = plane % channels;
+            T* grad = gradInput + plane * height * width;
+            for (int64_t b = 0; b < boxSize; ++b) {
+                const int64_t index = ((n * channels + c) * boxSize + b) * kBorderGroups + g;
+                // only the argmax point is needed, placed at start + argmax * step like the CUDA backward kernel places it
+                T x, y, xStride, yStride;
+                borderWalk(boxes + (n * boxSize + b) * 4, poolSize, static_cast<int>(g), &x, &y, &xStride, &yStride);
+                const T step = static_cast<T>(argmax[index]);
+                const BilinearPoint<T> p = bilinearPoint(height, width, y + yStride * step, x + xStride * step);
+                const T go = gradOutput[index];
+                for (int k = 0; k < 4; ++k) {
+                    grad[p.offset[k]] += go * p.weight[k];
+                }
+            }
+        }
+    });
+}
+
+template <typename T>
+diopiError_t borderAlignDispatch(const void* input, const void* boxes, void* output, void* argmax, diopiDtype_t argmaxDtype, int64_t batch, int64_t channels,
+                                 int64_t height, int64_t width, int64_t boxSize, int64_t poolSize) {
+    if (argmaxDtype == diopi_dtype_int32) {
+        borderAlignImpl(static_cast<const T*>(input),
+                        static_cast<const T*>(boxes),
+                        static_cast<T*>(output),
+                        static_cast<int32_t*>(argmax),
+                        batch,
+                        channels,
+                        height,
+                        width,
+                        boxSize,
+                        poolSize);
+    } else if (argmaxDtype == diopi_dtype_int16 && poolSize <= std::numeric_limits<int16_t>::max()) {
+        borderAlignImpl(static_cast<const T*>(input),
+                        static_cast<const T*>(boxes),
+                        static_cast<T*>(output),
+                        static_cast<int16_t*>(argmax),
+                        batch,
+                        channels,
+                        height,
+                        width,
+                        boxSize,
+                        poolSize);
+    } else {
+        set_last_error_string("border align on host does not support argmax dtype %d with pool_size %ld at %s:%d", argmaxDtype, poolSize, __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+template <typename T>
+diopiError_t borderAlignBackwardDispatch(const void* gradOutput, const void* boxes, const void* argmax, diopiDtype_t argmaxDtype, void* gradInput,
+                                         int64_t batch, int64_t channels, int64_t height, int64_t width, int64_t boxSize, int64_t poolSize) {
+    if (argmaxDtype == diopi_dtype_int32) {
+        borderAlignBackwardImpl(static_cast<const T*>(gradOutput),
+                                static_cast<const T*>(boxes),
+                                static_cast<const int32_t*>(argmax),
+                                static_cast<T*>(gradInput),
+                                batch,
+                                channels,
+                                height,
+                                width,
+                                boxSize,
+                                poolSize);
+    } else if (argmaxDtype == diopi_dtype_int16) {
+        borderAlignBackwardImpl(static_cast<const T*>(gradOutput),
+                                static_cast<const T*>(boxes),
+                                static_cast<const int16_t*>(argmax),
+                                static_cast<T*>(gradInput),
+                                batch,
+                                channels,
+                                height,
+                                width,
+                                boxSize,
+                                poolSize);
+    } else {
+        set_last_error_string("border align backward on host does not support argmax dtype %d at %s:%d", argmaxDtype, __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace
+
+diopiError_t borderAlign(diopiConstTensorHandle_t input_, diopiConstTensorHandle_t boxes_, diopiTensorHandle_t output_, diopiTensorHandle_t argmax_idx_,
+                         const int64_t pool_size) {
+    auto input = makeTensor(input_);
+    auto boxes = makeTensor(boxes_);
+    auto output = makeTensor(output_);
+    auto argmax_idx = makeTensor(argmax_idx_);
+    // input is (N, 4C, H, W), boxes (N, box_size, 4), output and argmax_idx (N, C, box_size, 4)
+    const int64_t batch = input.size(0);
+    const int64_t channels = input.size(1) / kBorderGroups;
+    const int64_t height = input.size(2);
+    const int64_t width = input.size(3);
+    const int64_t box_size = boxes.size(1);
+    if (input.dtype() == diopi_dtype_float32) {
+        return borderAlignDispatch<float>(
+            input.data(), boxes.data(), output.data(), argmax_idx.data(), argmax_idx.dtype(), batch, channels, height, width, box_size, pool_size);
+    } else if (input.dtype() == diopi_dtype_float64) {
+        return borderAlignDispatch<double>(
+            input.data(), boxes.data(), output.data(), argmax_idx.data(), argmax_idx.dtype(), batch, channels, height, width, box_size, pool_size);
+    }
+    set_last_error_string("border align on host does not support dtype %d at %s:%d", input.dtype(), __FILE__, __LINE__);
+    return diopiDtypeNotSupported;
+}
+
+diopiError_t borderAlignBackward(diopiConstTensorHandle_t grad_output_, diopiConstTensorHandle_t boxes_, diopiConstTensorHandle_t argmax_idx_,
+                                 diopiTensorHandle_t grad_input_, const int64_t pool_size) {
+    auto grad_output = makeTensor(grad_output_);
+    auto boxes = makeTensor(boxes_);
+    auto argmax_idx = makeTensor(argmax_idx_);
+    auto grad_input = makeTensor(grad_input_);
+    const int64_t batch = grad_input.size(0);
+    const int64_t channels = grad_input.size(1) / kBorderGroups;
+    const int64_t height = grad_input.size(2);
+    const int64_t width = grad_input.size(3);
+    const int64_t box_size = boxes.size(1);
+    if (grad_output.dtype() == diopi_dtype_float32) {
+        return borderAlignBackwardDispatch<float>(
+            grad_output.data(), boxes.data(), argmax_idx.data(), argmax_idx.dtype(), grad_input.data(), batch, channels, height, width, box_size, pool_size);
+    } else if (grad_output.dtype() == diopi_dtype_float64) {
+        return borderAlignBackwardDispatch<double>(
+            grad_output.data(), boxes.data(), argmax_idx.data(), argmax_idx.dtype(), grad_input.data(), batch, channels, height, width, box_size, pool_size);
+    }
+    set_last_error_string("border align backward on host does not support dtype %d at %s:%d", grad_output.dtype(), __FILE__, __LINE__);
+    return diopiDtypeNotSupported;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
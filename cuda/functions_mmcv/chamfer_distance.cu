@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -121,6 +122,9 @@ extern "C" diopiError_t diopiChamferDistance(diopiContextHandle_t ctx, diopiCons
     auto dist2 = impl::cuda::makeTensor(dist2_out);
     auto idx1 = impl::cuda::makeTensor(idx1_out);
     auto idx2 = impl::cuda::makeTensor(idx2_out);
+    if (xyz1.device() == diopi_host) {
+        return impl::cuda::host::chamferDistance(xyz1_in, xyz2_in, dist1_out, dist2_out, idx1_out, idx2_out);
+    }
     int batch_size = xyz1.size(0);
     int n = xyz1.size(1);
     int m = xyz2.size(1);
@@ -165,6 +169,9 @@ extern "C" diopiError_t diopiChamferDistanceBackward(diopiContextHandle_t ctx, d
     auto grad_dist2 = impl::cuda::makeTensor(grad_dist2_in);
     auto grad_xyz1 = impl::cuda::makeTensor(grad_xyz1_out);
     auto grad_xyz2 = impl::cuda::makeTensor(grad_xyz2_out);
+    if (xyz1.device() == diopi_host) {
+        return impl::cuda::host::chamferDistanceBackward(xyz1_in, xyz2_in, idx1_in, idx2_in, grad_dist1_in, grad_dist2_in, grad_xyz1_out, grad_xyz2_out);
+    }
     int batch_size = xyz1.size(0);
     int n = xyz1.size(1);
     int m = xyz2.size(1);
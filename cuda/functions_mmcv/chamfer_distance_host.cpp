@@ -0,0 +1,294 @@
+/**
+ * @file chamfer_distance_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+// xyz2 is swept in tiles whose SoA coordinates and running column minima stay in L1
+constexpr int64_t kChamferTile = 1024;
+constexpr int64_t kChamferRows = 64;
+
+template <typename T>
+struct ChamferScratch {
+    std::vector<T> x2;
+    std::vector<T> y2;
+    std::vector<T> colBest;
+    std::vector<int> colIdx;
+};
+
+/**
+ * R rows of set 1 starting at row against columns [j0, j1) of set 2. Every distance updates both the row
+ * minimum (dist1/idx1) and the column minimum kept in colBest/colIdx (dist2/idx2 candidates), so one sweep
+ * serves both directions. Ties keep the lowest index, as a sequential scan would.
+ */
+template <int R, typename T>
+void chamferRowGroup(const T* xyz1, int64_t row, const T* x2, const T* y2, int64_t j0, int64_t j1, T* dist1, int* idx1, T* colBest, int* colIdx) {
+    T px[R];
+    T py[R];
+    T best[R][kLanes];
+    int bestIdx[R][kLanes];
+    for (int r = 0; r < R; ++r) {
+        px[r] = xyz1[(row + r) * 2 + 0];
+        py[r] = xyz1[(row + r) * 2 + 1];
+        for (int lane = 0; lane < kLanes; ++lane) {
+            best[r][lane] = std::numeric_limits<T>::max();
+            bestIdx[r][lane] = 0;
+        }
+    }
+    int64_t j = j0;
+    for (; j + kLanes <= j1; j += kLanes) {
+        // local copies keep the lane loops free of aliasing so they map to SIMD compares and selects
+        T cb[kLanes];
+        int ci[kLanes];
+        for (int lane = 0; lane < kLanes; ++lane) {
+            cb[lane] = colBest[j + lane];
+            ci[lane] = colIdx[j + lane];
+        }
+        const int base = static_cast<int>(j);
+        for (int r = 0; r < R; ++r) {
+            const int i = static_cast<int>(row + r);
+            for (int lane = 0; lane < kLanes; ++lane) {
+                const T dx = x2[j + lane] - px[r];
+                const T dy = y2[j + lane] - py[r];
+                const T d = dx * dx + dy * dy;
+                // integer selects are spelled as masks, a ternary keyed on a float compare stays a branch
+                const int rowMask = -static_cast<int>(d < best[r][lane]);
+                best[r][lane] = d < best[r][lane] ? d : best[r][lane];
+                bestIdx[r][lane] = ((base + lane) & rowMask) | (bestIdx[r][lane] & ~rowMask);
+                const int colMask = -static_cast<int>(d < cb[lane]);
+                cb[lane] = d < cb[lane] ? d : cb[lane];
+                ci[lane] = (i & colMask) | (ci[lane] & ~colMask);
+            }
+        }
+        for (int lane = 0; lane < kLanes; ++lane) {
+            colBest[j + lane] = cb[lane];
+            colIdx[j + lane] = ci[lane];
+        }
+    }
+    for (int r = 0; r < R; ++r) {
+        const int64_t i = row + r;
+        T rowBest = dist1[i];
+        int rowIdx = idx1[i];
+        for (int lane = 0; lane < kLanes; ++lane) {
+            if (best[r][lane] < rowBest || (best[r][lane] == rowBest && bestIdx[r][lane] < rowIdx)) {
+                rowBest = best[r][lane];
+                rowIdx = bestIdx[r][lane];
+            }
+        }
+        for (int64_t k = j; k < j1; ++k) {
+            const T dx = x2[k] - px[r];
+            const T dy = y2[k] - py[r];
+            const T d = dx * dx + dy * dy;
+            if (d < rowBest) {
+                rowBest = d;
+                rowIdx = static_cast<int>(k);
+            }
+            if (d < colBest[k]) {
+                colBest[k] = d;
+                colIdx[k] = static_cast<int>(i);
+            }
+        }
+        dist1[i] = rowBest;
+        idx1[i] = rowIdx;
+    }
+}
+
+// rows [rowBegin, rowEnd) of set 1 against all m points of set 2, tile by tile
+template <typename T>
+void chamferRows(const T* xyz1, int64_t rowBegin, int64_t rowEnd, const T* x2, const T* y2, int64_t m, T* dist1, int* idx1, T* colBest, int* colIdx) {
+    constexpr int kGroup = 4;
+    for (int64_t i = rowBegin; i < rowEnd; ++i) {
+        dist1[i] = std::numeric_limits<T>::max();
+        idx1[i] = 0;
+    }
+    for (int64_t j0 = 0; j0 < m; j0 += kChamferTile) {
+        const int64_t j1 = std::min(j0 + kChamferTile, m);
+        int64_t i = rowBegin;
+        for (; i + kGroup <= rowEnd; i += kGroup) {
+            chamferRowGroup<kGroup>(xyz1, i, x2, y2, j0, j1, dist1, idx1, colBest, colIdx);
+        }
+        for (; i < rowEnd; ++i) {
+            chamferRowGroup<1>(xyz1, i, x2, y2, j0, j1, dist1, idx1, colBest, colIdx);
+        }
+    }
+}
+
+template <typename T>
+void chamferForward(int64_t b, int64_t n, int64_t m, const T* xyz1, const T* xyz2, T* dist1, T* dist2, int* idx1, int* idx2) {
+    const int workers = hostThreads();
+    std::vector<ChamferScratch<T>> scratch(workers);
+    std::vector<char> used(workers);
+    const int64_t blocks = (n + kChamferRows - 1) / kChamferRows;
+    for (int64_t bs = 0; bs < b; ++bs) {
+        const T* p1 = xyz1 + bs * n * 2;
+        const T* p2 = xyz2 + bs * m * 2;
+        std::fill(used.begin(), used.end(), 0);
+        // column minima are per worker and merged below, so no two workers write the same dist2 slot
+        parallelForDynamic(0, blocks, 1, [&](int worker, int64_t begin, int64_t end) {
+            ChamferScratch<T>& s = scratch[worker];
+            if (!used[worker]) {
+                used[worker] = 1;
+                s.x2.resize(m);
+                s.y2.resize(m);
+                for (int64_t j = 0; j < m; ++j) {
+                    s.x2[j] = p2[j * 2 + 0];
+                    s.y2[j] = p2[j * 2 + 1];
+                }
+                s.colBest.assign(m, std::numeric_limits<T>::max());
+                s.colIdx.assign(m, std::numeric_limits<int>::max());
+            }
+            chamferRows(p1, begin * kChamferRows, std::min(end * kChamferRows, n), s.x2.data(), s.y2.data(), m, dist1 + bs * n, idx1 + bs * n,
+                        s.colBest.data(), s.colIdx.data());
+        });
+        parallelFor(0, m, 4096, [&](int64_t begin, int64_t end) {
+            for (int64_t j = begin; j < end; ++j) {
+                T best = std::numeric_limits<T>::max();
+                int bestIdx = 0;
+                bool found = false;
+                for (int w = 0; w < workers; ++w) {
+                    if (!used[w]) continue;
+                    const T d = scratch[w].colBest[j];
+                    const int idx = scratch[w].colIdx[j];
+                    if (!found || d < best || (d == best && idx < bestIdx)) {
+                        best = d;
+                        bestIdx = idx;
+                        found = true;
+                    }
+                }
+                dist2[bs * m + j] = best;
+                idx2[bs * m + j] = found && n > 0 ? bestIdx : 0;
+            }
+        });
+    }
+}
+
+/**
+ * Gradients of both directions. Each point writes its own gradient directly; the matching gradient of its
+ * nearest neighbour is scattered into a per-worker buffer that is summed at the end, so no atomics are needed.
+ */
+template <typename T>
+void chamferBackward(int64_t b, int64_t n, int64_t m, const T* xyz1, const T* xyz2, const int* idx1, const int* idx2, const T* gradDist1, const T* gradDist2,
+                     T* gradXyz1, T* gradXyz2) {
+    const int workers = hostThreads();
+    std::vector<std::vector<T>> scatter1(workers);
+    std::vector<std::vector<T>> scatter2(workers);
+    const int64_t total1 = b * n;
+    const int64_t total2 = b * m;
+
+    parallelForDynamic(0, total1 + total2, 4096, [&](int worker, int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; ++k) {
+            const bool first = k < total1;
+            const int64_t item = first ? k : k - total1;
+            const int64_t count = first ? n : m;
+            const int64_t other = first ? m : n;
+            const int64_t bs = item / count;
+            const T* self = first ? xyz1 : xyz2;
+            const T* target = first ? xyz2 : xyz1;
+            const int64_t j = bs * other + (first ? idx1 : idx2)[item];
+            const T g = (first ? gradDist1 : gradDist2)[item] * 2;
+            const T gx = g * (self[item * 2 + 0] - target[j * 2 + 0]);
+            const T gy = g * (self[item * 2 + 1] - target[j * 2 + 1]);
+            T* own = first ? gradXyz1 : gradXyz2;
+            own[item * 2 + 0] = gx;
+            own[item * 2 + 1] = gy;
+            std::vector<T>& buffer = first ? scatter2[worker] : scatter1[worker];
+            if (buffer.empty()) buffer.assign((first ? total2 : total1) * 2, 0);
+            buffer[j * 2 + 0] -= gx;
+            buffer[j * 2 + 1] -= gy;
+        }
+    });
+
+    auto merge = [&](std::vector<std::vector<T>>& buffers, T* grad, int64_t size) {
+        parallelFor(0, size, 4096, [&](int64_t begin, int64_t end) {
+            for (const auto& buffer : buffers) {
+                if (buffer.empty()) continue;
+                for (int64_t k = begin; k < end; ++k) {
+                    grad[k] += buffer[k];
+                }
+            }
+        });
+    };
+    merge(scatter1, gradXyz1, total1 * 2);
+    merge(scatter2, gradXyz2, total2 * 2);
+}
+
+}  // namespace
+
+diopiError_t chamferDistance(diopiConstTensorHandle_t xyz1_in, diopiConstTensorHandle_t xyz2_in, diopiTensorHandle_t dist1_out, diopiTensorHandle_t dist2_out,
+                             diopiTensorHandle_t idx1_out, diopiTensorHandle_t idx2_out) {
+    auto xyz1 = makeTensor(xyz1_in);
+    auto xyz2 = makeTensor(xyz2_in);
+    auto dist1 = makeTensor(dist1_out);
+    auto dist2 = makeTensor(dist2_out);
+    auto idx1 = makeTensor(idx1_out);
+    auto idx2 = makeTensor(idx2_out);
+    const int64_t batch_size = xyz1.size(0);
+    const int64_t n = xyz1.size(1);
+    const int64_t m = xyz2.size(1);
+    int* idx1Ptr = static_cast<int*>(idx1.data());
+    int* idx2Ptr = static_cast<int*>(idx2.data());
+    if (xyz1.dtype() == diopi_dtype_float32) {
+        chamferForward(batch_size, n, m, static_cast<const float*>(xyz1.data()), static_cast<const float*>(xyz2.data()), static_cast<float*>(dist1.data()),
+                       static_cast<float*>(dist2.data()), idx1Ptr, idx2Ptr);
+    } else if (xyz1.dtype() == diopi_dtype_float64) {
+        chamferForward(batch_size, n, m, static_cast<const double*>(xyz1.data()), static_cast<const double*>(xyz2.data()), static_cast<double*>(dist1.data()),
+                       static_cast<double*>(dist2.data()), idx1Ptr, idx2Ptr);
+    } else {
+        set_last_error_string("chamfer distance on host does not support dtype %d at %s:%d", xyz1.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t chamferDistanceBackward(diopiConstTensorHandle_t xyz1_in, diopiConstTensorHandle_t xyz2_in, diopiConstTensorHandle_t idx1_in,
+                                     diopiConstTensorHandle_t idx2_in, diopiConstTensorHandle_t grad_dist1_in, diopiConstTensorHandle_t grad_dist2_in,
+                                     diopiTensorHandle_t grad_xyz1_out, diopiTensorHandle_t grad_xyz2_out) {
+    auto xyz1 = makeTensor(xyz1_in);
+    auto xyz2 = makeTensor(xyz2_in);
+    auto idx1 = makeTensor(idx1_in);
+    auto idx2 = makeTensor(idx2_in);
+    auto grad_dist1 = makeTensor(grad_dist1_in);
+    auto grad_dist2 = makeTensor(grad_dist2_in);
+    auto grad_xyz1 = makeTensor(grad_xyz1_out);
+    auto grad_xyz2 = makeTensor(grad_xyz2_out);
+    const int64_t batch_size = xyz1.size(0);
+    const int64_t n = xyz1.size(1);
+    const int64_t m = xyz2.size(1);
+    const int* idx1Ptr = static_cast<const int*>(idx1.data());
+    const int* idx2Ptr = static_cast<const int*>(idx2.data());
+    if (xyz1.dtype() == diopi_dtype_float32) {
+        chamferBackward(batch_size, n, m, static_cast<const float*>(xyz1.data()), static_cast<const float*>(xyz2.data()), idx1Ptr, idx2Ptr,
+                        static_cast<const float*>(grad_dist1.data()), static_cast<const float*>(grad_dist2.data()), static_cast<float*>(grad_xyz1.data()),
+                        static_cast<float*>(grad_xyz2.data()));
+    } else if (xyz1.dtype() == diopi_dtype_float64) {
+        chamferBackward(batch_size, n, m, static_cast<const double*>(xyz1.data()), static_cast<const double*>(xyz2.data()), idx1Ptr, idx2Ptr,
+                        static_cast<const double*>(grad_dist1.data()), static_cast<const double*>(grad_dist2.data()), static_cast<double*>(grad_xyz1.data()),
+                        static_cast<double*>(grad_xyz2.data()));
+    } else {
+        set_last_error_string("chamfer distance backward on host does not support dtype %d at %s:%d", xyz1.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -796,6 +797,9 @@ diopiError_t diopiConvexIou(diopiContextHandle_t ctx, diopiConstTensorHandle_t p
     auto pointsets = impl::cuda::makeTensor(pointsets_);
     auto polygons = impl::cuda::makeTensor(polygons_);
     auto ious = impl::cuda::makeTensor(ious_);
+    if (pointsets.device() == diopi_host) {
+        return impl::cuda::host::convexIou(pointsets_, polygons_, ious_);
+    }
 
     int output_size = ious.numel();
     int num_pointsets = pointsets.size(0);
@@ -820,6 +824,9 @@ diopiError_t diopiConvexGiou(diopiContextHandle_t ctx, diopiConstTensorHandle_t
     auto pointsets = impl::cuda::makeTensor(pointsets_);
     auto polygons = impl::cuda::makeTensor(polygons_);
     auto output = impl::cuda::makeTensor(output_);
+    if (pointsets.device() == diopi_host) {
+        return impl::cuda::host::convexGiou(pointsets_, polygons_, output_);
+    }
 
     int output_size = output.numel();
     int num_pointsets = pointsets.size(0);
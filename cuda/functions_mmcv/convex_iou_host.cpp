@@ -0,0 +1,423 @@
+/**
+ * @file convex_iou_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_geometry.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+constexpr double kConvexEps = 1e-8;
+constexpr int kPointsetSize = 9;
+constexpr int kQuadSize = 4;
+// a quad clipped by a 9 edge hull gains at most one vertex per convex edge, the rest is headroom for concave quads
+constexpr int kClipCapacity = 32;
+
+inline bool samePoint(const Vec2& a, const Vec2& b) { return std::abs(a.x - b.x) <= kConvexEps && std::abs(a.y - b.y) <= kConvexEps; }
+
+/**
+ * Convex hulls of all pointsets, computed once and kept as a compact SoA buffer: kPointsetSize vertex slots per hull,
+ * each edge stored as the line nx * x + ny * y + c >= 0 of its inner half plane, plus the bounding box for cheap
+ * rejection of disjoint pairs.
+ */
+struct HullBuffer {
+    explicit HullBuffer(int64_t num)
+        : count(num), source(num * kPointsetSize), x(num * kPointsetSize), y(num * kPointsetSize), nx(num * kPointsetSize), ny(num * kPointsetSize),
+          c(num * kPointsetSize), area(num), box(num * 4) {}
+
+    template <typename T>
+    void build(int64_t i, const T* pointset) {
+        Vec2 points[kPointsetSize];
+        int tag[kPointsetSize];
+        for (int p = 0; p < kPointsetSize; ++p) {
+            points[p] = {static_cast<double>(pointset[p * 2]), static_cast<double>(pointset[p * 2 + 1])};
+            tag[p] = p;
+        }
+        Vec2 hull[kPointsetSize];
+        int hullTag[kPointsetSize];
+        const int n = convexHull<kPointsetSize>(points, tag, hull, hullTag);
+        count[i] = n;
+        const int64_t base = i * kPointsetSize;
+        double lo[2] = {hull[0].x, hull[0].y};
+        double hi[2] = {hull[0].x, hull[0].y};
+        for (int v = 0; v < n; ++v) {
+            // gradients go to the first input point at this position, as in the CUDA kernel
+            int first = hullTag[v];
+            for (int p = 0; p < kPointsetSize; ++p) {
+                if (samePoint(points[p], hull[v])) {
+                    first = p;
+                    break;
+                }
+            }
+            const Vec2& a = hull[v];
+            const Vec2& b = hull[v + 1 == n ? 0 : v + 1];
+            source[base + v] = first;
+            x[base + v] = a.x;
+            y[base + v] = a.y;
+            nx[base + v] = -(b.y - a.y);
+            ny[base + v] = b.x - a.x;
+            c[base + v] = (b.y - a.y) * a.x - (b.x - a.x) * a.y;
+            lo[0] = std::min(lo[0], a.x);
+            lo[1] = std::min(lo[1], a.y);
+            hi[0] = std::max(hi[0], a.x);
+            hi[1] = std::max(hi[1], a.y);
+        }
+        area[i] = n >= 3 ? signedArea(hull, n) : 0;
+        box[i * 4 + 0] = lo[0];
+        box[i * 4 + 1] = lo[1];
+        box[i * 4 + 2] = hi[0];
+        box[i * 4 + 3] = hi[1];
+    }
+
+    Vec2 vertex(int64_t i, int v) const { return {x[i * kPointsetSize + v], y[i * kPointsetSize + v]}; }
+
+    std::vector<int> count;
+    std::vector<int> source;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> nx;
+    std::vector<double> ny;
+    std::vector<double> c;
+    std::vector<double> area;
+    std::vector<double> box;
+};
+
+// A quad in counter-clockwise order with its area and bounding box.
+struct Quad {
+    template <typename T>
+    explicit Quad(const T* q) {
+        for (int v = 0; v < kQuadSize; ++v) {
+            p[v] = {static_cast<double>(q[v * 2]), static_cast<double>(q[v * 2 + 1])};
+        }
+        area = signedArea<kQuadSize>(p);
+        if (area < 0) {
+            std::reverse(p, p + kQuadSize);
+            area = -area;
+        }
+        lo = hi = p[0];
+        for (int v = 1; v < kQuadSize; ++v) {
+            lo = {std::min(lo.x, p[v].x), std::min(lo.y, p[v].y)};
+            hi = {std::max(hi.x, p[v].x), std::max(hi.y, p[v].y)};
+        }
+    }
+
+    Vec2 p[kQuadSize];
+    double area;
+    Vec2 lo;
+    Vec2 hi;
+};
+
+/**
+ * A vertex of the clipped polygon together with where it comes from, so that the area gradient can be taken back to
+ * the hull vertices. out is the line the edge to the next vertex lies on: quad edge q as q, hull edge k as kQuadSize + k.
+ */
+struct ClipVertex {
+    enum Kind { kFixed, kOnHullEdge, kHullCorner };
+    Vec2 p;
+    Kind kind;
+    int quadEdge;
+    int hullEdge;
+    int out;
+};
+
+/**
+ * Sutherland-Hodgman: the quad is clipped by each edge of the convex hull in turn. The hull is the clipper since it is
+ * convex by construction, the quad may be anything simple. Returns the vertex count of the intersection polygon.
+ */
+int clipQuadByHull(const Quad& quad, const HullBuffer& hulls, int64_t h, ClipVertex* out) {
+    ClipVertex buffer[kClipCapacity];
+    ClipVertex* cur = out;
+    ClipVertex* next = buffer;
+    int n = kQuadSize;
+    for (int v = 0; v < kQuadSize; ++v) {
+        cur[v] = {quad.p[v], ClipVertex::kFixed, -1, -1, v};
+    }
+    const int hullCount = hulls.count[h];
+    const int64_t base = h * kPointsetSize;
+    for (int k = 0; k < hullCount && n > 0; ++k) {
+        const double nx = hulls.nx[base + k];
+        const double ny = hulls.ny[base + k];
+        const double c = hulls.c[base + k];
+        int m = 0;
+        const ClipVertex* s = &cur[n - 1];
+        double ds = nx * s->p.x + ny * s->p.y + c;
+        for (int i = 0; i < n && m + 2 <= kClipCapacity; ++i) {
+            const ClipVertex& e = cur[i];
+            const double de = nx * e.p.x + ny * e.p.y + c;
+            const bool inE = de >= 0;
+            const bool inS = ds >= 0;
+            if (inE != inS) {
+                const double t = ds / (ds - de);
+                ClipVertex& x = next[m++];
+                x.p = {s->p.x + t * (e.p.x - s->p.x), s->p.y + t * (e.p.y - s->p.y)};
+                x.out = inE ? s->out : kQuadSize + k;
+                x.quadEdge = -1;
+                x.hullEdge = k;
+                if (s->out < kQuadSize) {
+                    x.kind = ClipVertex::kOnHullEdge;
+                    x.quadEdge = s->out;
+                } else {
+                    // two hull edges meet in the hull vertex between them
+                    const int j = s->out - kQuadSize;
+                    x.kind = ClipVertex::kHullCorner;
+                    if ((j + 1) % hullCount == k) {
+                        x.hullEdge = k;
+                    } else if ((k + 1) % hullCount == j) {
+                        x.hullEdge = j;
+                    } else {
+                        x.kind = ClipVertex::kFixed;
+                    }
+                }
+            }
+            if (inE) next[m++] = e;
+            s = &e;
+            ds = de;
+        }
+        std::swap(cur, next);
+        n = m;
+    }
+    if (cur != out) std::copy(cur, cur + n, out);
+    return n;
+}
+
+inline double clippedArea(const ClipVertex* v, int n) {
+    double res = 0;
+    for (int i = 0; i < n; ++i) {
+        const int j = i + 1 == n ? 0 : i + 1;
+        res += v[i].p.x * v[j].p.y - v[i].p.y * v[j].p.x;
+    }
+    return res / 2;
+}
+
+inline bool boxesDisjoint(const HullBuffer& hulls, int64_t h, const Quad& quad) {
+    const double* box = &hulls.box[h * 4];
+    return box[0] > quad.hi.x || box[2] < quad.lo.x || box[1] > quad.hi.y || box[3] < quad.lo.y;
+}
+
+double intersectionArea(const HullBuffer& hulls, int64_t h, const Quad& quad) {
+    if (hulls.count[h] < 3 || boxesDisjoint(hulls, h, quad)) return 0;
+    ClipVertex clipped[kClipCapacity];
+    const int n = clipQuadByHull(quad, hulls, h, clipped);
+    return n >= 3 ? std::abs(clippedArea(clipped, n)) : 0;
+}
+
+// d area / d vertex i of a counter-clockwise polygon given by point accessor get
+template <typename Get>
+inline Vec2 areaGrad(const Get& get, int n, int i) {
+    const Vec2 prev = get(i == 0 ? n - 1 : i - 1);
+    const Vec2 next = get(i + 1 == n ? 0 : i + 1);
+    return {(next.y - prev.y) / 2, (prev.x - next.x) / 2};
+}
+
+/**
+ * Chains the gradient g of a clipped vertex lying on hull edge k (a -> b) and quad edge (c -> d) back to a and b. With
+ * s1 = cross(a, b, c), s2 = cross(a, b, d) the vertex is (c * s2 - d * s1) / (s2 - s1).
+ */
+inline void edgeCrossGrad(const Vec2& a, const Vec2& b, const Vec2& c, const Vec2& d, const Vec2& x, const Vec2& g, double* gradA, double* gradB) {
+    const double s1 = cross(a, b, c);
+    const double s2 = cross(a, b, d);
+    const double den = s2 - s1;
+    if (std::abs(den) <= kConvexEps) return;
+    // partial derivatives of cross(a, b, p) by ax, ay, bx, by
+    const double ds1[4] = {b.y - c.y, c.x - b.x, c.y - a.y, a.x - c.x};
+    const double ds2[4] = {b.y - d.y, d.x - b.x, d.y - a.y, a.x - d.x};
+    double grad[4];
+    for (int q = 0; q < 4; ++q) {
+        const double dx = ((c.x - x.x) * ds2[q] - (d.x - x.x) * ds1[q]) / den;
+        const double dy = ((c.y - x.y) * ds2[q] - (d.y - x.y) * ds1[q]) / den;
+        grad[q] = g.x * dx + g.y * dy;
+    }
+    gradA[0] += grad[0];
+    gradA[1] += grad[1];
+    gradB[0] += grad[2];
+    gradB[1] += grad[3];
+}
+
+/**
+ * GIoU of a pointset hull and its quad, with the gradient of the GIoU by the 9 input points. Hull vertices take the
+ * gradient of the intersection, hull and enclosing areas; points inside the hull get zero, as in the CUDA kernel.
+ */
+template <typename T>
+void convexGiouOne(const HullBuffer& hulls, int64_t h, const Quad& quad, T* out) {
+    const int n = hulls.count[h];
+    auto hullVertex = [&](int v) { return hulls.vertex(h, v); };
+    double gradI[kPointsetSize][2] = {};
+    double gradA[kPointsetSize][2] = {};
+    double gradC[kPointsetSize][2] = {};
+
+    double inter = 0;
+    if (n >= 3 && !boxesDisjoint(hulls, h, quad)) {
+        ClipVertex clipped[kClipCapacity];
+        const int m = clipQuadByHull(quad, hulls, h, clipped);
+        if (m >= 3) {
+            inter = clippedArea(clipped, m);
+            auto clippedVertex = [&](int v) { return clipped[v].p; };
+            for (int v = 0; v < m; ++v) {
+                const ClipVertex& cv = clipped[v];
+                const Vec2 g = areaGrad(clippedVertex, m, v);
+                if (cv.kind == ClipVertex::kHullCorner) {
+                    gradI[cv.hullEdge][0] += g.x;
+                    gradI[cv.hullEdge][1] += g.y;
+                } else if (cv.kind == ClipVertex::kOnHullEdge) {
+                    const int k = cv.hullEdge;
+                    const int k1 = k + 1 == n ? 0 : k + 1;
+                    const int q1 = cv.quadEdge + 1 == kQuadSize ? 0 : cv.quadEdge + 1;
+                    edgeCrossGrad(hullVertex(k), hullVertex(k1), quad.p[cv.quadEdge], quad.p[q1], cv.p, g, gradI[k], gradI[k1]);
+                }
+            }
+        }
+    }
+
+    const double hullArea = hulls.area[h];
+    if (n >= 3) {
+        for (int v = 0; v < n; ++v) {
+            const Vec2 g = areaGrad(hullVertex, n, v);
+            gradA[v][0] = g.x;
+            gradA[v][1] = g.y;
+        }
+    }
+
+    // enclosing hull of both polygons; quad corners sitting on a hull vertex are dropped so the hull vertex gets the gradient
+    Vec2 points[kPointsetSize + kQuadSize];
+    int tag[kPointsetSize + kQuadSize];
+    int count = 0;
+    for (int v = 0; v < n; ++v) {
+        points[count] = hullVertex(v);
+        tag[count++] = v;
+    }
+    for (int q = 0; q < kQuadSize; ++q) {
+        bool shared = false;
+        for (int v = 0; v < n; ++v) shared = shared || samePoint(quad.p[q], points[v]);
+        if (shared) continue;
+        points[count] = quad.p[q];
+        tag[count++] = -1;
+    }
+    // pad with copies of the last point so the hull size stays a compile-time constant; duplicates never survive the chain
+    for (int i = count; i < kPointsetSize + kQuadSize; ++i) {
+        points[i] = points[count - 1];
+        tag[i] = tag[count - 1];
+    }
+    Vec2 enclosing[kPointsetSize + kQuadSize];
+    int enclosingTag[kPointsetSize + kQuadSize];
+    const int e = convexHull<kPointsetSize + kQuadSize>(points, tag, enclosing, enclosingTag);
+    const double enclosed = e >= 3 ? signedArea(enclosing, e) : 0;
+    auto enclosingVertex = [&](int v) { return enclosing[v]; };
+    for (int v = 0; v < e && e >= 3; ++v) {
+        if (enclosingTag[v] < 0) continue;
+        const Vec2 g = areaGrad(enclosingVertex, e, v);
+        gradC[enclosingTag[v]][0] += g.x;
+        gradC[enclosingTag[v]][1] += g.y;
+    }
+
+    const double unionArea = hullArea + quad.area - inter;
+    const double iou = inter / unionArea;
+    for (int p = 0; p < 2 * kPointsetSize; ++p) out[p] = 0;
+    for (int v = 0; v < n; ++v) {
+        const int p = hulls.source[h * kPointsetSize + v];
+        for (int a = 0; a < 2; ++a) {
+            const double grad = (unionArea + inter) / (unionArea * unionArea) * gradI[v][a] - iou / unionArea * gradA[v][a] -
+                                1 / enclosed * (gradI[v][a] - gradA[v][a]) - unionArea / enclosed / enclosed * gradC[v][a];
+            out[2 * p + a] = static_cast<T>(static_cast<float>(grad));
+        }
+    }
+    out[2 * kPointsetSize] = static_cast<T>(static_cast<float>(iou - (enclosed - unionArea) / enclosed));
+}
+
+template <typename T>
+void buildHulls(HullBuffer& hulls, const T* pointsets, int64_t num) {
+    parallelFor(0, num, 256, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            hulls.build(i, pointsets + i * 2 * kPointsetSize);
+        }
+    });
+}
+
+template <typename T>
+void convexIouImpl(const T* pointsets, const T* polygons, T* ious, int64_t numPointsets, int64_t numPolygons) {
+    HullBuffer hulls(numPointsets);
+    buildHulls(hulls, pointsets, numPointsets);
+    std::vector<Quad> quads;
+    quads.reserve(numPolygons);
+    for (int64_t j = 0; j < numPolygons; ++j) {
+        quads.emplace_back(polygons + j * 2 * kQuadSize);
+    }
+    parallelFor(0, numPointsets, 16, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            const double hullArea = hulls.area[i];
+            for (int64_t j = 0; j < numPolygons; ++j) {
+                const double inter = intersectionArea(hulls, i, quads[j]);
+                ious[i * numPolygons + j] = static_cast<T>(static_cast<float>(inter / (hullArea + quads[j].area - inter)));
+            }
+        }
+    });
+}
+
+template <typename T>
+void convexGiouImpl(const T* pointsets, const T* polygons, T* output, int64_t num) {
+    HullBuffer hulls(num);
+    buildHulls(hulls, pointsets, num);
+    parallelFor(0, num, 256, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            convexGiouOne(hulls, i, Quad(polygons + i * 2 * kQuadSize), output + i * (2 * kPointsetSize + 1));
+        }
+    });
+}
+
+}  // namespace
+
+diopiError_t convexIou(diopiConstTensorHandle_t pointsets_, diopiConstTensorHandle_t polygons_, diopiTensorHandle_t ious_) {
+    auto pointsets = makeTensor(pointsets_);
+    auto polygons = makeTensor(polygons_);
+    auto ious = makeTensor(ious_);
+    const int64_t num_pointsets = pointsets.size(0);
+    const int64_t num_polygons = polygons.size(0);
+    if (pointsets.dtype() == diopi_dtype_float32) {
+        convexIouImpl(static_cast<const float*>(pointsets.data()), static_cast<const float*>(polygons.data()), static_cast<float*>(ious.data()),
+                      num_pointsets, num_polygons);
+    } else if (pointsets.dtype() == diopi_dtype_float64) {
+        convexIouImpl(static_cast<const double*>(pointsets.data()), static_cast<const double*>(polygons.data()), static_cast<double*>(ious.data()),
+                      num_pointsets, num_polygons);
+    } else {
+        set_last_error_string("convex iou on host does not support dtype %d at %s:%d", pointsets.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t convexGiou(diopiConstTensorHandle_t pointsets_, diopiConstTensorHandle_t polygons_, diopiTensorHandle_t output_) {
+    auto pointsets = makeTensor(pointsets_);
+    auto polygons = makeTensor(polygons_);
+    auto output = makeTensor(output_);
+    const int64_t num_pointsets = pointsets.size(0);
+    if (pointsets.dtype() == diopi_dtype_float32) {
+        convexGiouImpl(static_cast<const float*>(pointsets.data()), static_cast<const float*>(polygons.data()), static_cast<float*>(output.data()),
+                       num_pointsets);
+    } else if (pointsets.dtype() == diopi_dtype_float64) {
+        convexGiouImpl(static_cast<const double*>(pointsets.data()), static_cast<const double*>(polygons.data()), static_cast<double*>(output.data()),
+                       num_pointsets);
+    } else {
+        set_last_error_string("convex giou on host does not support dtype %d at %s:%d", pointsets.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
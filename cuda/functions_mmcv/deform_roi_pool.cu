@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -172,6 +173,9 @@ diopiError_t diopiDeformRoiPool(diopiContextHandle_t ctx, diopiTensorHandle_t in
     auto rois = impl::cuda::makeTensor(rois_);
     auto offset = impl::cuda::makeTensor(offset_);
     auto output = impl::cuda::makeTensor(output_);
+    if (input.device() == diopi_host) {
+        return impl::cuda::host::deformRoiPool(input_, rois_, offset_, output_, pooled_height, pooled_width, spatial_scale, sampling_ratio, gamma);
+    }
     int output_size = output.numel();
     int channels = input.size(1);
     int height = input.size(2);
@@ -210,6 +214,10 @@ diopiError_t diopiDeformRoiPoolBackward(diopiContextHandle_t ctx, diopiTensorHan
     auto offset = impl::cuda::makeTensor(offset_);
     auto grad_input = impl::cuda::makeTensor(grad_input_);
     auto grad_offset = impl::cuda::makeTensor(grad_offset_);
+    if (grad_output.device() == diopi_host) {
+        return impl::cuda::host::deformRoiPoolBackward(
+            grad_output_, input_, rois_, offset_, grad_input_, grad_offset_, pooled_height, pooled_width, spatial_scale, sampling_ratio, gamma);
+    }
 
     int output_size = grad_output.numel();
     int channels = grad_input.size(1);
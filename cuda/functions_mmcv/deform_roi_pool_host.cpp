@@ -0,0 +1,342 @@
+/**
+ * @file deform_roi_pool_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+// one roi in feature map coordinates, with the sampling grid of its bins
+template <typename T>
+struct DeformRoi {
+    DeformRoi(const T* roi, int64_t pooledHeight, int64_t pooledWidth, T scale, int64_t samplingRatio) {
+        batch = static_cast<int64_t>(roi[0]);
+        // no rounding, like the CUDA kernel
+        startW = roi[1] * scale - T(0.5);
+        startH = roi[2] * scale - T(0.5);
+        width = roi[3] * scale - T(0.5) - startW;
+        height = roi[4] * scale - T(0.5) - startH;
+        binW = width / static_cast<T>(pooledWidth);
+        binH = height / static_cast<T>(pooledHeight);
+        // an inverted roi gives a negative adaptive grid, which samples nothing like the empty loops of the CUDA kernel
+        gridH = samplingRatio > 0 ? samplingRatio : std::max<int64_t>(static_cast<int64_t>(std::ceil(height / pooledHeight)), 0);
+        gridW = samplingRatio > 0 ? samplingRatio : std::max<int64_t>(static_cast<int64_t>(std::ceil(width / pooledWidth)), 0);
+    }
+
+    int64_t batch;
+    T startW;
+    T startH;
+    T width;
+    T height;
+    T binW;
+    T binH;
+    int64_t gridH;
+    int64_t gridW;
+};
+
+template <typename T>
+struct DeformSample {
+    BilinearPoint<T> point;
+    // the sample position before clamping and whether it lies on the feature map, for the offset gradient
+    T y;
+    T x;
+    bool inside;
+};
+
+/**
+ * The sampling grid of bin (ph, pw) of roi n, shifted by the bin's learned offset. It does not depend on the channel,
+ * so it is computed once per bin and applied to all channels. offset may be null.
+ */
+template <typename T>
+void binSamples(const DeformRoi<T>& roi, const T* offset, int64_t n, int64_t ph, int64_t pw, int64_t pooledHeight, int64_t pooledWidth, T gamma,
+                int64_t height, int64_t width, std::vector<DeformSample<T>>& samples) {
+    T startW = roi.startW;
+    T startH = roi.startH;
+    if (offset != nullptr) {
+        const T* offsetBin = offset + n * pooledWidth * pooledHeight * 2 + ph * pooledWidth + pw;
+        startW += gamma * roi.width * offsetBin[0];
+        startH += gamma * roi.height * offsetBin[pooledWidth * pooledHeight];
+    }
+    samples.resize(roi.gridH * roi.gridW);
+    for (int64_t iy = 0; iy < roi.gridH; ++iy) {
+        const T y = startH + ph * roi.binH + static_cast<T>(iy + .5f) * roi.binH / static_cast<T>(roi.gridH);
+        for (int64_t ix = 0; ix < roi.gridW; ++ix) {
+            const T x = startW + pw * roi.binW + static_cast<T>(ix + .5f) * roi.binW / static_cast<T>(roi.gridW);
+            DeformSample<T>& s = samples[iy * roi.gridW + ix];
+            s.point = bilinearPoint(height, width, y, x);
+            s.y = y;
+            s.x = x;
+            s.inside = !(y < -1.0 || y > height || x < -1.0 || x > width);
+        }
+    }
+}
+
+template <typename T>
+inline void axpyChannels(T weight, const T* __restrict x, T* __restrict y, int64_t channels) {
+    for (int64_t c = 0; c < channels; ++c) {
+        y[c] += weight * x[c];
+    }
+}
+
+template <typename T>
+inline T dotChannels(const T* __restrict x, const T* __restrict y, int64_t channels) {
+    T sum = 0;
+    for (int64_t c = 0; c < channels; ++c) {
+        sum += x[c] * y[c];
+    }
+    return sum;
+}
+
+template <typename T>
+void deformRoiPoolImpl(const T* input, const T* rois, const T* offset, T* output, int64_t batch, int64_t channels, int64_t height, int64_t width,
+                       int64_t numRois, int64_t pooledHeight, int64_t pooledWidth, T scale, int64_t samplingRatio, T gamma) {
+    const std::vector<T> nhwc = toChannelsLast(input, batch, channels, height, width);
+    const int64_t bins = pooledHeight * pooledWidth;
+    // adaptive grids make the cost per roi differ, so rois are handed out on demand
+    parallelForDynamic(0, numRois, 1, [&](int, int64_t begin, int64_t end) {
+        std::vector<DeformSample<T>> samples;
+        std::vector<T> acc(channels);
+        for (int64_t n = begin; n < end; ++n) {
+            const DeformRoi<T> roi(rois + n * 5, pooledHeight, pooledWidth, scale, samplingRatio);
+            const T* image = nhwc.data() + roi.batch * height * width * channels;
+            const T count = std::max<int64_t>(roi.gridH * roi.gridW, 1);
+            for (int64_t ph = 0; ph < pooledHeight; ++ph) {
+                for (int64_t pw = 0; pw < pooledWidth; ++pw) {
+                    binSamples(roi, offset, n, ph, pw, pooledHeight, pooledWidth, gamma, height, width, samples);
+                    std::fill(acc.begin(), acc.end(), T(0));
+                    for (const DeformSample<T>& s : samples) {
+                        for (int k = 0; k < 4; ++k) {
+                            axpyChannels(s.point.weight[k], image + s.point.offset[k] * channels, acc.data(), channels);
+                        }
+                    }
+                    T* out = output + n * channels * bins + ph * pooledWidth + pw;
+                    for (int64_t c = 0; c < channels; ++c) {
+                        out[c * bins] = acc[c] / count;
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * Rois are taken image by image. Within an image every worker scatters into its own channels-last grad buffer, which
+ * keeps the scatter a vectorized axpy without atomics; the buffers of the workers that took part are then added to
+ * grad_input. grad_offset entries belong to one roi each, so they are written directly.
+ */
+template <typename T>
+void deformRoiPoolBackwardImpl(const T* gradOutput, const T* input, const T* rois, const T* offset, T* gradInput, T* gradOffset, int64_t batch,
+                               int64_t channels, int64_t height, int64_t width, int64_t numRois, int64_t pooledHeight, int64_t pooledWidth, T scale,
+                               int64_t samplingRatio, T gamma) {
+    const std::vector<T> nhwc = toChannelsLast(input, batch, channels, height, width);
+    const int64_t bins = pooledHeight * pooledWidth;
+    const int64_t imageSize = height * width * channels;
+    std::vector<std::vector<int64_t>> groups(batch);
+    for (int64_t n = 0; n < numRois; ++n) {
+        const int64_t b = static_cast<int64_t>(rois[n * 5]);
+        if (b >= 0 && b < batch) groups[b].push_back(n);
+    }
+    std::vector<std::vector<T>> workerGrad(hostThreads());
+    std::vector<char> used(hostThreads());
+    for (int64_t b = 0; b < batch; ++b) {
+        if (groups[b].empty()) continue;
+        std::fill(used.begin(), used.end(), 0);
+        const T* image = nhwc.data() + b * imageSize;
+        parallelForDynamic(0, static_cast<int64_t>(groups[b].size()), 1, [&](int worker, int64_t begin, int64_t end) {
+            std::vector<T>& grad = workerGrad[worker];
+            if (!used[worker]) {
+                grad.assign(imageSize, T(0));
+                used[worker] = 1;
+            }
+            std::vector<DeformSample<T>> samples;
+            std::vector<T> g(channels);
+            for (int64_t i = begin; i < end; ++i) {
+                const int64_t n = groups[b][i];
+                const DeformRoi<T> roi(rois + n * 5, pooledHeight, pooledWidth, scale, samplingRatio);
+                const T count = static_cast<T>(roi.gridH * roi.gridW);
+                for (int64_t ph = 0; ph < pooledHeight; ++ph) {
+                    for (int64_t pw = 0; pw < pooledWidth; ++pw) {
+                        binSamples(roi, offset, n, ph, pw, pooledHeight, pooledWidth, gamma, height, width, samples);
+                        const T* go = gradOutput + n * channels * bins + ph * pooledWidth + pw;
+                        for (int64_t c = 0; c < channels; ++c) {
+                            g[c] = go[c * bins] / count;
+                        }
+                        T offsetX = 0;
+                        T offsetY = 0;
+                        for (const DeformSample<T>& s : samples) {
+                            if (!s.inside) continue;
+                            for (int k = 0; k < 4; ++k) {
+                                axpyChannels(s.point.weight[k], g.data(), grad.data() + s.point.offset[k] * channels, channels);
+                            }
+                            if (offset == nullptr) continue;
+                            const T yLow = static_cast<T>(s.point.offset[0] / width);
+                            const T yHigh = static_cast<T>(s.point.offset[2] / width);
+                            const T xLow = static_cast<T>(s.point.offset[0] % width);
+                            const T xHigh = static_cast<T>(s.point.offset[1] % width);
+                            const T g00 = dotChannels(g.data(), image + s.point.offset[0] * channels, channels);
+                            const T g10 = dotChannels(g.data(), image + s.point.offset[1] * channels, channels);
+                            const T g01 = dotChannels(g.data(), image + s.point.offset[2] * channels, channels);
+                            const T g11 = dotChannels(g.data(), image + s.point.offset[3] * channels, channels);
+                            offsetX += g11 * (s.y - yLow) + g10 * (yHigh - s.y) + g01 * (yLow - s.y) + g00 * (s.y - yHigh);
+                            offsetY += g11 * (s.x - xLow) + g01 * (xHigh - s.x) + g10 * (xLow - s.x) + g00 * (s.x - xHigh);
+                        }
+                        if (offset != nullptr) {
+                            T* gradOffsetBin = gradOffset + n * bins * 2 + ph * pooledWidth + pw;
+                            gradOffsetBin[0] += gamma * roi.width * offsetX;
+                            gradOffsetBin[bins] += gamma * roi.height * offsetY;
+                        }
+                    }
+                }
+            }
+        });
+        T* gradImage = gradInput + b * channels * height * width;
+        parallelFor(0, height, 1, [&](int64_t begin, int64_t end) {
+            for (size_t worker = 0; worker < workerGrad.size(); ++worker) {
+                if (!used[worker]) continue;
+                const T* grad = workerGrad[worker].data();
+                for (int64_t h = begin; h < end; ++h) {
+                    for (int64_t c0 = 0; c0 < channels; c0 += 2 * kLanes) {
+                        const int64_t c1 = std::min(c0 + 2 * kLanes, channels);
+                        for (int64_t w = 0; w < width; ++w) {
+                            for (int64_t c = c0; c < c1; ++c) {
+                                gradImage[(c * height + h) * width + w] += grad[(h * width + w) * channels + c];
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+}  // namespace
+
+diopiError_t deformRoiPool(diopiTensorHandle_t input_, diopiTensorHandle_t rois_, diopiTensorHandle_t offset_, diopiTensorHandle_t output_,
+                           int64_t pooled_height, int64_t pooled_width, float spatial_scale, int64_t sampling_ratio, float gamma) {
+    auto input = makeTensor(input_);
+    auto rois = makeTensor(rois_);
+    auto offset = makeTensor(offset_);
+    auto output = makeTensor(output_);
+    const int64_t batch = input.size(0);
+    const int64_t channels = input.size(1);
+    const int64_t height = input.size(2);
+    const int64_t width = input.size(3);
+    const int64_t num_rois = rois.size(0);
+    const void* offset_data = offset_ == nullptr ? nullptr : offset.data();
+    if (input.dtype() == diopi_dtype_float32) {
+        deformRoiPoolImpl(static_cast<const float*>(input.data()),
+                          static_cast<const float*>(rois.data()),
+                          static_cast<const float*>(offset_data),
+                          static_cast<float*>(output.data()),
+                          batch,
+                          channels,
+                          height,
+                          width,
+                          num_rois,
+                          pooled_height,
+                          pooled_width,
+                          spatial_scale,
+                          sampling_ratio,
+                          gamma);
+    } else if (input.dtype() == diopi_dtype_float64) {
+        deformRoiPoolImpl(static_cast<const double*>(input.data()),
+                          static_cast<const double*>(rois.data()),
+                          static_cast<const double*>(offset_data),
+                          static_cast<double*>(output.data()),
+                          batch,
+                          channels,
+                          height,
+                          width,
+                          num_rois,
+                          pooled_height,
+                          pooled_width,
+                          static_cast<double>(spatial_scale),
+                          sampling_ratio,
+                          static_cast<double>(gamma));
+    } else {
+        set_last_error_string("deform roi pool on host does not support dtype %d at %s:%d", input.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t deformRoiPoolBackward(diopiTensorHandle_t grad_output_, diopiTensorHandle_t input_, diopiTensorHandle_t rois_, diopiTensorHandle_t offset_,
+                                   diopiTensorHandle_t grad_input_, diopiTensorHandle_t grad_offset_, int64_t pooled_height, int64_t pooled_width,
+                                   float spatial_scale, int64_t sampling_ratio, float gamma) {
+    auto grad_output = makeTensor(grad_output_);
+    auto input = makeTensor(input_);
+    auto rois = makeTensor(rois_);
+    auto offset = makeTensor(offset_);
+    auto grad_input = makeTensor(grad_input_);
+    auto grad_offset = makeTensor(grad_offset_);
+    const int64_t batch = grad_input.size(0);
+    const int64_t channels = grad_input.size(1);
+    const int64_t height = grad_input.size(2);
+    const int64_t width = grad_input.size(3);
+    const int64_t num_rois = rois.size(0);
+    const void* offset_data = offset_ == nullptr ? nullptr : offset.data();
+    void* grad_offset_data = grad_offset_ == nullptr ? nullptr : grad_offset.data();
+    if (offset_data != nullptr && grad_offset_data == nullptr) {
+        set_last_error_string("deform roi pool backward needs grad_offset when offset is given at %s:%d", __FILE__, __LINE__);
+        return diopiErrorOccurred;
+    }
+    if (grad_output.dtype() == diopi_dtype_float32) {
+        deformRoiPoolBackwardImpl(static_cast<const float*>(grad_output.data()),
+                                  static_cast<const float*>(input.data()),
+                                  static_cast<const float*>(rois.data()),
+                                  static_cast<const float*>(offset_data),
+                                  static_cast<float*>(grad_input.data()),
+                                  static_cast<float*>(grad_offset_data),
+                                  batch,
+                                  channels,
+                                  height,
+                                  width,
+                                  num_rois,
+                                  pooled_height,
+                                  pooled_width,
+                                  spatial_scale,
+                                  sampling_ratio,
+                                  gamma);
+    } else if (grad_output.dtype() == diopi_dtype_float64) {
+        deformRoiPoolBackwardImpl(static_cast<const double*>(grad_output.data()),
+                                  static_cast<const double*>(input.data()),
+                                  static_cast<const double*>(rois.data()),
+                                  static_cast<const double*>(offset_data),
+                                  static_cast<double*>(grad_input.data()),
+                                  static_cast<double*>(grad_offset_data),
+                                  batch,
+                                  channels,
+                                  height,
+                                  width,
+                                  num_rois,
+                                  pooled_height,
+                                  pooled_width,
+                                  static_cast<double>(spatial_scale),
+                                  sampling_ratio,
+                                  static_cast<double>(gamma));
+    } else {
+        set_last_error_string("deform roi pool backward on host does not support dtype %d at %s:%d", grad_output.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -30,12 +31,15 @@ inline __device__ void swap_int(int *x, int *y) {
     *y = tmp;
 }
 
+// equal distances are ordered by index, so the sorted neighbours do not depend on how ties entered the heap
+inline __device__ bool before(float dist_a, int idx_a, float dist_b, int idx_b) { return dist_a < dist_b || (dist_a == dist_b && idx_a < idx_b); }
+
 __device__ void reheap(float *dist, int *idx, int k) {
     int root = 0;
     int child = root * 2 + 1;
     while (child < k) {
-        if (child + 1 < k && dist[child + 1] > dist[child]) child++;
-        if (dist[root] > dist[child]) return;
+        if (child + 1 < k && before(dist[child], idx[child], dist[child + 1], idx[child + 1])) child++;
+        if (before(dist[child], idx[child], dist[root], idx[root])) return;
         swap_float(&dist[root], &dist[child]);
         swap_int(&idx[root], &idx[child]);
         root = child;
@@ -110,6 +114,14 @@ diopiError_t diopiKnn(diopiContextHandle_t ctx, diopiTensorHandle_t xyz_, diopiT
     auto new_xyz = impl::cuda::makeTensor(new_xyz_);
     auto idx = impl::cuda::makeTensor(idx_);
     auto dist2 = impl::cuda::makeTensor(dist2_);
+    if (xyz.device() == diopi_host) {
+        return impl::cuda::host::knn(xyz_, new_xyz_, idx_, dist2_, b, n, m, nsample);
+    }
+    // the kernel keeps its candidates in fixed stack arrays
+    if (nsample > 100) {
+        impl::cuda::set_last_error_string("knn on cuda supports nsample <= 100, got %ld at %s:%d", nsample, __FILE__, __LINE__);
+        return diopiErrorOccurred;
+    }
 
     // at::cuda::CUDAGuard device_guard(new_xyz.device());
     auto stream = impl::cuda::getStream(ctx);
@@ -0,0 +1,337 @@
+/**
+ * @file knn_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+// below this many points per batch, or when k is a large share of them, scanning all points beats the grid
+constexpr int64_t kKnnBruteForceMaxPoints = 4096;
+constexpr int64_t kKnnPointsPerCell = 4;
+
+// Bounded max-heap holding the k smallest (distance, index) pairs seen so far. Equal distances are ordered by index, as in
+// the CUDA kernel, so the result does not depend on the order points are visited in. Starts from the same (1e10, 0) slots
+// as the CUDA kernel, so a query with fewer than k candidates reports the same padding.
+template <typename T>
+class KnnHeap {
+public:
+    explicit KnnHeap(int64_t k) : dist_(k), idx_(k) {}
+
+    void reset() {
+        std::fill(dist_.begin(), dist_.end(), static_cast<T>(1e10));
+        std::fill(idx_.begin(), idx_.end(), 0);
+    }
+
+    T top() const { return dist_[0]; }
+
+    void push(T dist, int idx) {
+        if (!before(dist, idx, dist_[0], idx_[0])) return;
+        dist_[0] = dist;
+        idx_[0] = idx;
+        siftDown(static_cast<int64_t>(dist_.size()));
+    }
+
+    // ascending distances, equal ones by ascending index
+    void sortTo(int* idx, T* dist) {
+        for (int64_t end = static_cast<int64_t>(dist_.size()) - 1; end > 0; --end) {
+            std::swap(dist_[0], dist_[end]);
+            std::swap(idx_[0], idx_[end]);
+            siftDown(end);
+        }
+        std::copy(idx_.begin(), idx_.end(), idx);
+        std::copy(dist_.begin(), dist_.end(), dist);
+    }
+
+private:
+    static bool before(T distA, int idxA, T distB, int idxB) { return distA < distB || (distA == distB && idxA < idxB); }
+
+    void siftDown(int64_t size) {
+        int64_t root = 0;
+        int64_t child = 1;
+        while (child < size) {
+            if (child + 1 < size && before(dist_[child], idx_[child], dist_[child + 1], idx_[child + 1])) child++;
+            if (before(dist_[child], idx_[child], dist_[root], idx_[root])) return;
+            std::swap(dist_[root], dist_[child]);
+            std::swap(idx_[root], idx_[child]);
+            root = child;
+            child = root * 2 + 1;
+        }
+    }
+
+    std::vector<T> dist_;
+    std::vector<int> idx_;
+};
+
+// Points of one batch in SoA order, with the original index of each point.
+template <typename T>
+struct PointsSoA {
+    std::vector<T> x;
+    std::vector<T> y;
+    std::vector<T> z;
+    std::vector<int> index;
+
+    void resize(int64_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        index.resize(n);
+    }
+};
+
+// Distances of a tile of kLanes points are computed branch-free, the heap is only touched when the tile holds a candidate.
+template <typename T>
+void scanRange(const PointsSoA<T>& points, int64_t begin, int64_t end, const T* query, KnnHeap<T>& heap) {
+    const T qx = query[0];
+    const T qy = query[1];
+    const T qz = query[2];
+    const T* x = points.x.data();
+    const T* y = points.y.data();
+    const T* z = points.z.data();
+    int64_t i = begin;
+    for (; i + kLanes <= end; i += kLanes) {
+        T dist[kLanes];
+        for (int lane = 0; lane < kLanes; ++lane) {
+            const T dx = qx - x[i + lane];
+            const T dy = qy - y[i + lane];
+            const T dz = qz - z[i + lane];
+            dist[lane] = dx * dx + dy * dy + dz * dz;
+        }
+        T best = dist[0];
+        for (int lane = 1; lane < kLanes; ++lane) {
+            best = std::min(best, dist[lane]);
+        }
+        // a tie with the top may still win on its index
+        if (best > heap.top()) continue;
+        for (int lane = 0; lane < kLanes; ++lane) {
+            heap.push(dist[lane], points.index[i + lane]);
+        }
+    }
+    for (; i < end; ++i) {
+        const T dx = qx - x[i];
+        const T dy = qy - y[i];
+        const T dz = qz - z[i];
+        heap.push(dx * dx + dy * dy + dz * dz, points.index[i]);
+    }
+}
+
+// Uniform voxel grid over one batch. Points are stored sorted by cell, so every cell is a contiguous SoA range.
+template <typename T>
+class VoxelGrid {
+public:
+    void build(const T* xyz, int64_t n) {
+        T lo[3];
+        T hi[3];
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::numeric_limits<T>::max();
+            hi[a] = std::numeric_limits<T>::lowest();
+        }
+        for (int64_t i = 0; i < n; ++i) {
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = std::min(lo[a], xyz[i * 3 + a]);
+                hi[a] = std::max(hi[a], xyz[i * 3 + a]);
+            }
+        }
+
+        // size the cells for about kKnnPointsPerCell points each; clamping thin extents keeps flat clouds from exploding the cell count
+        const int64_t targetCells = std::max<int64_t>(n / kKnnPointsPerCell, 1);
+        const T maxExtent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+        T volume = 1;
+        for (int a = 0; a < 3; ++a) {
+            volume *= std::max(hi[a] - lo[a], maxExtent * static_cast<T>(1e-3));
+        }
+        cell_ = std::cbrt(volume / targetCells);
+        if (!(cell_ > 0)) cell_ = 1;
+        while (true) {
+            int64_t cells = 1;
+            for (int a = 0; a < 3; ++a) {
+                dims_[a] = static_cast<int64_t>((hi[a] - lo[a]) / cell_) + 1;
+                cells *= dims_[a];
+            }
+            if (cells <= 8 * n + 8) break;
+            cell_ *= static_cast<T>(1.26);
+        }
+        std::copy(lo, lo + 3, lo_);
+
+        const int64_t cells = dims_[0] * dims_[1] * dims_[2];
+        std::vector<int64_t> cellOf(n);
+        start_.assign(cells + 1, 0);
+        for (int64_t i = 0; i < n; ++i) {
+            int64_t c[3];
+            for (int a = 0; a < 3; ++a) {
+                c[a] = coord(xyz[i * 3 + a], a);
+            }
+            cellOf[i] = (c[2] * dims_[1] + c[1]) * dims_[0] + c[0];
+            start_[cellOf[i] + 1]++;
+        }
+        for (int64_t c = 0; c < cells; ++c) {
+            start_[c + 1] += start_[c];
+        }
+        std::vector<int64_t> fill(start_.begin(), start_.end() - 1);
+        points_.resize(n);
+        for (int64_t i = 0; i < n; ++i) {
+            const int64_t pos = fill[cellOf[i]]++;
+            points_.x[pos] = xyz[i * 3 + 0];
+            points_.y[pos] = xyz[i * 3 + 1];
+            points_.z[pos] = xyz[i * 3 + 2];
+            points_.index[pos] = static_cast<int>(i);
+        }
+    }
+
+    // visits shells of cells around the query until no unvisited cell can hold a point closer than the current k-th distance
+    void query(const T* q, KnnHeap<T>& heap) const {
+        int64_t qc[3];
+        T outside[3];
+        for (int a = 0; a < 3; ++a) {
+            qc[a] = coord(q[a], a);
+            outside[a] = std::max({lo_[a] - q[a], q[a] - (lo_[a] + dims_[a] * cell_), static_cast<T>(0)});
+        }
+        for (int64_t r = 0;; ++r) {
+            visitShell(qc, r, q, heap);
+
+            // unvisited points lie beyond one face of the visited block and inside the grid box
+            bool whole = true;
+            T bound = std::numeric_limits<T>::max();
+            for (int a = 0; a < 3; ++a) {
+                T others = 0;
+                for (int o = 0; o < 3; ++o) {
+                    if (o != a) others += outside[o] * outside[o];
+                }
+                if (qc[a] - r > 0) {
+                    whole = false;
+                    const T face = q[a] - (lo_[a] + (qc[a] - r) * cell_);
+                    bound = std::min(bound, face * face + others);
+                }
+                if (qc[a] + r < dims_[a] - 1) {
+                    whole = false;
+                    const T face = lo_[a] + (qc[a] + r + 1) * cell_ - q[a];
+                    bound = std::min(bound, face * face + others);
+                }
+            }
+            if (whole || heap.top() < bound) return;
+        }
+    }
+
+private:
+    int64_t coord(T v, int a) const {
+        const int64_t c = static_cast<int64_t>(std::floor((v - lo_[a]) / cell_));
+        return std::min(std::max<int64_t>(c, 0), dims_[a] - 1);
+    }
+
+    void visitCell(int64_t x, int64_t y, int64_t z, const T* q, KnnHeap<T>& heap) const {
+        const int64_t c = (z * dims_[1] + y) * dims_[0] + x;
+        if (start_[c] < start_[c + 1]) scanRange(points_, start_[c], start_[c + 1], q, heap);
+    }
+
+    // cells at Chebyshev distance exactly r from qc
+    void visitShell(const int64_t* qc, int64_t r, const T* q, KnnHeap<T>& heap) const {
+        const int64_t z0 = std::max<int64_t>(qc[2] - r, 0), z1 = std::min(qc[2] + r, dims_[2] - 1);
+        const int64_t y0 = std::max<int64_t>(qc[1] - r, 0), y1 = std::min(qc[1] + r, dims_[1] - 1);
+        const int64_t x0 = std::max<int64_t>(qc[0] - r, 0), x1 = std::min(qc[0] + r, dims_[0] - 1);
+        for (int64_t z = z0; z <= z1; ++z) {
+            for (int64_t y = y0; y <= y1; ++y) {
+                if (std::abs(z - qc[2]) == r || std::abs(y - qc[1]) == r) {
+                    for (int64_t x = x0; x <= x1; ++x) {
+                        visitCell(x, y, z, q, heap);
+                    }
+                } else {
+                    if (qc[0] - r >= 0) visitCell(qc[0] - r, y, z, q, heap);
+                    if (r > 0 && qc[0] + r < dims_[0]) visitCell(qc[0] + r, y, z, q, heap);
+                }
+            }
+        }
+    }
+
+    T lo_[3];
+    T cell_ = 1;
+    int64_t dims_[3] = {1, 1, 1};
+    std::vector<int64_t> start_;
+    PointsSoA<T> points_;
+};
+
+template <typename T>
+void knnKernel(int64_t b, int64_t n, int64_t m, int64_t nsample, const T* xyz, const T* newXyz, int* idx, T* dist2) {
+    const bool bruteForce = n <= kKnnBruteForceMaxPoints || nsample * 16 >= n;
+
+    std::vector<PointsSoA<T>> brute;
+    std::vector<VoxelGrid<T>> grids;
+    if (bruteForce) {
+        brute.resize(b);
+        parallelFor(0, b, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t bs = begin; bs < end; ++bs) {
+                const T* points = xyz + bs * n * 3;
+                brute[bs].resize(n);
+                for (int64_t i = 0; i < n; ++i) {
+                    brute[bs].x[i] = points[i * 3 + 0];
+                    brute[bs].y[i] = points[i * 3 + 1];
+                    brute[bs].z[i] = points[i * 3 + 2];
+                    brute[bs].index[i] = static_cast<int>(i);
+                }
+            }
+        });
+    } else {
+        grids.resize(b);
+        parallelFor(0, b, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t bs = begin; bs < end; ++bs) {
+                grids[bs].build(xyz + bs * n * 3, n);
+            }
+        });
+    }
+
+    parallelFor(0, b * m, 16, [&](int64_t begin, int64_t end) {
+        KnnHeap<T> heap(nsample);
+        for (int64_t q = begin; q < end; ++q) {
+            const int64_t bs = q / m;
+            heap.reset();
+            if (bruteForce) {
+                scanRange(brute[bs], 0, n, newXyz + q * 3, heap);
+            } else {
+                grids[bs].query(newXyz + q * 3, heap);
+            }
+            heap.sortTo(idx + q * nsample, dist2 + q * nsample);
+        }
+    });
+}
+
+}  // namespace
+
+diopiError_t knn(diopiTensorHandle_t xyz_, diopiTensorHandle_t new_xyz_, diopiTensorHandle_t idx_, diopiTensorHandle_t dist2_, int64_t b, int64_t n, int64_t m,
+                 int64_t nsample) {
+    auto xyz = makeTensor(xyz_);
+    auto new_xyz = makeTensor(new_xyz_);
+    auto idx = makeTensor(idx_);
+    auto dist2 = makeTensor(dist2_);
+    if (b * m == 0 || nsample <= 0) return diopiSuccess;
+
+    int* idxPtr = static_cast<int*>(idx.data());
+    if (new_xyz.scalar_type() == diopi_dtype_float32) {
+        knnKernel(b, n, m, nsample, static_cast<const float*>(xyz.data()), static_cast<const float*>(new_xyz.data()), idxPtr, static_cast<float*>(dist2.data()));
+    } else if (new_xyz.scalar_type() == diopi_dtype_float64) {
+        knnKernel(b, n, m, nsample, static_cast<const double*>(xyz.data()), static_cast<const double*>(new_xyz.data()), idxPtr, static_cast<double*>(dist2.data()));
+    } else {
+        set_last_error_string("knn on host does not support dtype %d at %s:%d", new_xyz.scalar_type(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -307,6 +308,9 @@ __global__ void min_area_polygons_cuda_kernel(const int ex_n_boxes, const void *
 diopiError_t diopiMinAreaPolygons(diopiContextHandle_t ctx, diopiConstTensorHandle_t pointsets_, diopiTensorHandle_t polygons_) {
     auto pointsets = impl::cuda::makeTensor(pointsets_);
     auto polygons = impl::cuda::makeTensor(polygons_);
+    if (pointsets.device() == diopi_host) {
+        return impl::cuda::host::minAreaPolygons(pointsets_, polygons_);
+    }
     int num_pointsets = pointsets.size(0);
     const int output_size = polygons.numel();
     // at::cuda::CUDAGuard device_guard(pointsets.device());
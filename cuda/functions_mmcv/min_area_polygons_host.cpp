@@ -0,0 +1,143 @@
+/**
+ * @file min_area_polygons_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <cmath>
+
+#include "../helper.hpp"
+#include "../host_geometry.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+constexpr int kPointsetSize = 9;
+// the constant the CUDA kernel folds edge angles with
+constexpr float kPi = 3.1415926f;
+// pointsets handed out per request of the work-stealing loop
+constexpr int64_t kMinAreaChunk = 64;
+
+inline double dot(const Vec2& a, const Vec2& b) { return a.x * b.x + a.y * b.y; }
+
+/**
+ * Rotating calipers over a counter-clockwise hull without collinear vertices: the rectangle flush with edge i is
+ * bounded by the vertices of largest and smallest projection on the edge and the vertex farthest from it, and all
+ * three only move forward as i goes around. Returns the edge of the smallest rectangle, the first one on ties.
+ */
+int minAreaEdge(const Vec2* hull, int n) {
+    auto at = [&](int i) -> const Vec2& { return hull[i % n]; };
+    int right = 1;
+    int top = 1;
+    int left = 1;
+    double best = 0;
+    int bestEdge = 0;
+    for (int i = 0; i < n; ++i) {
+        const Vec2 edge{at(i + 1).x - at(i).x, at(i + 1).y - at(i).y};
+        const double len = std::sqrt(dot(edge, edge));
+        const Vec2 u{edge.x / len, edge.y / len};
+        if (right < i + 1) right = i + 1;
+        while (right < i + n && dot(at(right + 1), u) > dot(at(right), u)) ++right;
+        if (top < right) top = right;
+        while (top < i + n && cross(at(i), at(i + 1), at(top + 1)) > cross(at(i), at(i + 1), at(top))) ++top;
+        if (i == 0) left = top;
+        while (left < i + n && dot(at(left + 1), u) < dot(at(left), u)) ++left;
+        const double area = (dot(at(right), u) - dot(at(left), u)) * cross(at(i), at(i + 1), at(top)) / len;
+        if (i == 0 || area < best) {
+            best = area;
+            bestEdge = i;
+        }
+    }
+    return bestEdge;
+}
+
+/**
+ * The rectangle is written the way the CUDA kernel writes it: the edge angle folded into [0, pi/2), the hull bounds in
+ * the frame rotated by that angle, and the four corners rotated back, all in float.
+ */
+template <typename T>
+void minAreaPolygon(const T* pointset, T* out) {
+    Vec2 points[kPointsetSize];
+    int tag[kPointsetSize];
+    for (int p = 0; p < kPointsetSize; ++p) {
+        points[p] = {static_cast<double>(static_cast<float>(pointset[p * 2])), static_cast<double>(static_cast<float>(pointset[p * 2 + 1]))};
+        tag[p] = p;
+    }
+    Vec2 hull[kPointsetSize];
+    int hullTag[kPointsetSize];
+    const int n = convexHull<kPointsetSize>(points, tag, hull, hullTag);
+    const int edge = n >= 3 ? minAreaEdge(hull, n) : 0;
+    const Vec2& a = hull[edge];
+    const Vec2& b = hull[(edge + 1) % n];
+
+    float angle = std::atan2(static_cast<double>(static_cast<float>(b.y - a.y)), static_cast<double>(static_cast<float>(b.x - a.x)));
+    if (angle >= 0) {
+        angle = std::fmod(static_cast<double>(angle), static_cast<double>(kPi / 2));
+    } else {
+        angle = angle - static_cast<int>(angle / (kPi / 2) - 1) * (kPi / 2);
+    }
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    float xmin = 1e12f;
+    float ymin = 1e12f;
+    float xmax = -1e12f;
+    float ymax = -1e12f;
+    for (int v = 0; v < n; ++v) {
+        const float x = static_cast<float>(hull[v].x);
+        const float y = static_cast<float>(hull[v].y);
+        const float rx = c * x + s * y;
+        const float ry = -s * x + c * y;
+        xmin = std::min(xmin, rx);
+        xmax = std::max(xmax, rx);
+        ymin = std::min(ymin, ry);
+        ymax = std::max(ymax, ry);
+    }
+    out[0] = static_cast<T>(xmax * c + ymin * -s);
+    out[1] = static_cast<T>(xmax * s + ymin * c);
+    out[2] = static_cast<T>(xmin * c + ymin * -s);
+    out[3] = static_cast<T>(xmin * s + ymin * c);
+    out[4] = static_cast<T>(xmin * c + ymax * -s);
+    out[5] = static_cast<T>(xmin * s + ymax * c);
+    out[6] = static_cast<T>(xmax * c + ymax * -s);
+    out[7] = static_cast<T>(xmax * s + ymax * c);
+}
+
+template <typename T>
+void minAreaPolygonsImpl(const T* pointsets, T* polygons, int64_t num) {
+    // hull sizes, and with them the caliper cost, differ per pointset, so idle workers steal the next chunk
+    parallelForDynamic(0, num, kMinAreaChunk, [&](int, int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            minAreaPolygon(pointsets + i * 2 * kPointsetSize, polygons + i * 8);
+        }
+    });
+}
+
+}  // namespace
+
+diopiError_t minAreaPolygons(diopiConstTensorHandle_t pointsets_, diopiTensorHandle_t polygons_) {
+    auto pointsets = makeTensor(pointsets_);
+    auto polygons = makeTensor(polygons_);
+    const int64_t num_pointsets = pointsets.size(0);
+    if (pointsets.dtype() == diopi_dtype_float32) {
+        minAreaPolygonsImpl(static_cast<const float*>(pointsets.data()), static_cast<float*>(polygons.data()), num_pointsets);
+    } else if (pointsets.dtype() == diopi_dtype_float64) {
+        minAreaPolygonsImpl(static_cast<const double*>(pointsets.data()), static_cast<double*>(polygons.data()), num_pointsets);
+    } else {
+        set_last_error_string("min area polygons on host does not support dtype %d at %s:%d", pointsets.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
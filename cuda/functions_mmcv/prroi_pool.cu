@@ -14,6 +14,7 @@
 
 #include "../cuda_helper.hpp"
 #include "../helper.hpp"
+#include "../host_kernels.hpp"
 
 namespace impl {
 
@@ -356,6 +357,9 @@ diopiError_t diopiPrroiPool(diopiContextHandle_t ctx, diopiTensorHandle_t input_
     auto input = impl::cuda::makeTensor(input_);
     auto rois = impl::cuda::makeTensor(rois_);
     auto output = impl::cuda::makeTensor(output_);
+    if (input.device() == diopi_host) {
+        return impl::cuda::host::prroiPool(input_, rois_, output_, pooled_height, pooled_width, spatial_scale);
+    }
 
     int output_size = output.numel();
     int channels = input.size(1);
@@ -374,6 +378,9 @@ diopiError_t diopiPrroiPoolbackward(diopiContextHandle_t ctx, diopiTensorHandle_
     auto grad_output = impl::cuda::makeTensor(grad_output_);
     auto rois = impl::cuda::makeTensor(rois_);
     auto grad_input = impl::cuda::makeTensor(grad_input_);
+    if (grad_output.device() == diopi_host) {
+        return impl::cuda::host::prroiPoolBackward(grad_output_, rois_, grad_input_, pooled_height, pooled_width, spatial_scale);
+    }
 
     int output_size = grad_output.numel();
     int channels = grad_input.size(1);
@@ -403,6 +410,9 @@ diopiError_t diopiPrroiPoolCoorBackward(diopiContextHandle_t ctx, diopiTensorHan
     auto input = impl::cuda::makeTensor(input_);
     auto rois = impl::cuda::makeTensor(rois_);
     auto grad_rois = impl::cuda::makeTensor(grad_rois_);
+    if (input.device() == diopi_host) {
+        return impl::cuda::host::prroiPoolCoorBackward(output_, grad_output_, input_, rois_, grad_rois_, pooled_height, pooled_width, spatial_scale);
+    }
 
     int output_size = grad_output.numel();
     int channels = input.size(1);
@@ -0,0 +1,352 @@
+/**
+ * @file prroi_pool_host.cpp
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../helper.hpp"
+#include "../host_helper.hpp"
+#include "../host_kernels.hpp"
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+// integral of the bilinear hat over [s, t] of a unit cell, seen from the corner at 0
+template <typename T>
+inline T hatIntegral(T s, T t) {
+    return t - T(0.5) * t * t - s + T(0.5) * s * s;
+}
+
+/**
+ * Integral weights of one axis for every (roi, bin). The exact bilinear integral over a bin is separable, so the
+ * weight of pixel (h, w) is y weight(h) * x weight(w). Pixels outside the feature map are left out of the tables,
+ * which is what the zero padding of the CUDA kernel amounts to. coord is 1 for x and 2 for y in the roi rows.
+ */
+template <typename T>
+struct PrroiAxis {
+    void build(const T* rois, int64_t numRois, int64_t pooled, int64_t size, T scale, int coord) {
+        const int64_t bins = numRois * pooled;
+        first.resize(bins);
+        count.resize(bins);
+        offset.resize(bins + 1);
+        lo.resize(bins);
+        hi.resize(bins);
+        offset[0] = 0;
+        for (int64_t r = 0; r < numRois; ++r) {
+            const T roiLo = rois[r * 5 + coord] * scale;
+            const T roiHi = rois[r * 5 + coord + 2] * scale;
+            const T binSize = std::max(roiHi - roiLo, T(0)) / static_cast<T>(pooled);
+            for (int64_t p = 0; p < pooled; ++p) {
+                const int64_t bin = r * pooled + p;
+                lo[bin] = roiLo + binSize * p;
+                hi[bin] = lo[bin] + binSize;
+                const int64_t begin = std::max<int64_t>(static_cast<int64_t>(std::floor(lo[bin])), 0);
+                const int64_t end = std::min<int64_t>(static_cast<int64_t>(std::ceil(hi[bin])), size - 1) + 1;
+                first[bin] = begin;
+                count[bin] = std::max<int64_t>(end - begin, 0);
+                offset[bin + 1] = offset[bin] + count[bin];
+            }
+        }
+        weight.assign(offset[bins], T(0));
+        parallelFor(0, bins, 256, [&](int64_t begin, int64_t end) {
+            for (int64_t bin = begin; bin < end; ++bin) {
+                T* w = weight.data() + offset[bin] - first[bin];
+                const int64_t pixelEnd = first[bin] + count[bin];
+                const int64_t cellEnd = static_cast<int64_t>(std::ceil(hi[bin]));
+                for (int64_t cell = static_cast<int64_t>(std::floor(lo[bin])); cell < cellEnd; ++cell) {
+                    const T x0 = std::max(lo[bin], T(cell)) - cell;
+                    const T x1 = std::min(hi[bin], T(cell + 1)) - cell;
+                    if (cell >= first[bin] && cell < pixelEnd) w[cell] += hatIntegral(x0, x1);
+                    if (cell + 1 >= first[bin] && cell + 1 < pixelEnd) w[cell + 1] += hatIntegral(1 - x1, 1 - x0);
+                }
+            }
+        });
+    }
+
+    std::vector<int64_t> first;
+    std::vector<int64_t> count;
+    std::vector<int64_t> offset;
+    std::vector<T> lo;
+    std::vector<T> hi;
+    std::vector<T> weight;
+};
+
+template <typename T>
+struct PrroiTables {
+    PrroiTables(const T* rois, int64_t numRois, int64_t pooledHeight, int64_t pooledWidth, int64_t height, int64_t width, T scale) {
+        x.build(rois, numRois, pooledWidth, width, scale, 1);
+        y.build(rois, numRois, pooledHeight, height, scale, 2);
+    }
+
+    T binSize(int64_t binY, int64_t binX) const { return std::max(T(0), (y.hi[binY] - y.lo[binY]) * (x.hi[binX] - x.lo[binX])); }
+
+    PrroiAxis<T> x;
+    PrroiAxis<T> y;
+};
+
+// acc[c] += weight * pixel[c]; a counted loop over restrict pointers, vectorized across channels
+template <typename T>
+inline void axpyChannels(T weight, const T* __restrict pixel, T* __restrict acc, int64_t channels) {
+    for (int64_t c = 0; c < channels; ++c) {
+        acc[c] += weight * pixel[c];
+    }
+}
+
+// roi indices grouped by batch image
+template <typename T>
+std::vector<std::vector<int64_t>> roisByImage(const T* rois, int64_t numRois, int64_t batch) {
+    std::vector<std::vector<int64_t>> groups(batch);
+    for (int64_t n = 0; n < numRois; ++n) {
+        const int64_t b = static_cast<int64_t>(rois[n * 5]);
+        if (b >= 0 && b < batch) groups[b].push_back(n);
+    }
+    return groups;
+}
+
+template <typename T>
+void prroiPoolImpl(const T* input, const T* rois, T* output, int64_t batch, int64_t channels, int64_t height, int64_t width, int64_t numRois,
+                   int64_t pooledHeight, int64_t pooledWidth, T scale) {
+    const PrroiTables<T> tables(rois, numRois, pooledHeight, pooledWidth, height, width, scale);
+    const std::vector<T> nhwc = toChannelsLast(input, batch, channels, height, width);
+    const int64_t bins = pooledHeight * pooledWidth;
+    // roi sizes differ a lot, so rois are handed out on demand
+    parallelForDynamic(0, numRois, 1, [&](int, int64_t begin, int64_t end) {
+        std::vector<T> acc(channels);
+        for (int64_t n = begin; n < end; ++n) {
+            const T* image = nhwc.data() + static_cast<int64_t>(rois[n * 5]) * height * width * channels;
+            for (int64_t ph = 0; ph < pooledHeight; ++ph) {
+                const int64_t binY = n * pooledHeight + ph;
+                const T* wy = tables.y.weight.data() + tables.y.offset[binY];
+                for (int64_t pw = 0; pw < pooledWidth; ++pw) {
+                    const int64_t binX = n * pooledWidth + pw;
+                    const T* wx = tables.x.weight.data() + tables.x.offset[binX];
+                    const T binSize = tables.binSize(binY, binX);
+                    std::fill(acc.begin(), acc.end(), T(0));
+                    if (binSize != 0) {
+                        for (int64_t i = 0; i < tables.y.count[binY]; ++i) {
+                            const T* row = image + (tables.y.first[binY] + i) * width * channels;
+                            for (int64_t j = 0; j < tables.x.count[binX]; ++j) {
+                                axpyChannels(wy[i] * wx[j], row + (tables.x.first[binX] + j) * channels, acc.data(), channels);
+                            }
+                        }
+                    }
+                    T* out = output + n * channels * bins + ph * pooledWidth + pw;
+                    for (int64_t c = 0; c < channels; ++c) {
+                        out[c * bins] = binSize == 0 ? T(0) : acc[c] / binSize;
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename T>
+void prroiPoolBackwardImpl(const T* gradOutput, const T* rois, T* gradInput, int64_t batch, int64_t channels, int64_t height, int64_t width, int64_t numRois,
+                           int64_t pooledHeight, int64_t pooledWidth, T scale) {
+    const PrroiTables<T> tables(rois, numRois, pooledHeight, pooledWidth, height, width, scale);
+    const std::vector<std::vector<int64_t>> groups = roisByImage(rois, numRois, batch);
+    const int64_t bins = pooledHeight * pooledWidth;
+    // every worker owns whole (image, channel) planes of grad_input, so the scatter needs no atomics
+    parallelForDynamic(0, batch * channels, 1, [&](int, int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const int64_t b = plane / channels;
+            const int64_t c = plane % channels;
+            T* grad = gradInput + plane * height * width;
+            for (const int64_t n : groups[b]) {
+                for (int64_t ph = 0; ph < pooledHeight; ++ph) {
+                    const int64_t binY = n * pooledHeight + ph;
+                    const T* wy = tables.y.weight.data() + tables.y.offset[binY];
+                    for (int64_t pw = 0; pw < pooledWidth; ++pw) {
+                        const int64_t binX = n * pooledWidth + pw;
+                        const T binSize = tables.binSize(binY, binX);
+                        if (binSize == 0) continue;
+                        const T g = gradOutput[(n * channels + c) * bins + ph * pooledWidth + pw] / binSize;
+                        const T* __restrict wx = tables.x.weight.data() + tables.x.offset[binX];
+                        const int64_t cols = tables.x.count[binX];
+                        for (int64_t i = 0; i < tables.y.count[binY]; ++i) {
+                            const T gy = g * wy[i];
+                            T* __restrict row = grad + (tables.y.first[binY] + i) * width + tables.x.first[binX];
+                            for (int64_t j = 0; j < cols; ++j) {
+                                row[j] += gy * wx[j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * acc[c] += sum over the table pixels along one axis of weight * the feature map interpolated at the fixed coordinate
+ * on the other axis. This is the integral along a bin edge the coordinate gradient needs, on the same tables.
+ */
+template <typename T>
+void edgeIntegral(const T* image, int64_t height, int64_t width, int64_t channels, const T* weight, int64_t first, int64_t count, T at, bool alongY,
+                  T* acc) {
+    const int64_t fixed0 = static_cast<int64_t>(std::floor(at));
+    const T frac = at - T(fixed0);
+    const int64_t fixedSize = alongY ? width : height;
+    for (int64_t k = 0; k < count; ++k) {
+        const int64_t moving = first + k;
+        for (int64_t f = 0; f < 2; ++f) {
+            const int64_t fixed = fixed0 + f;
+            if (fixed < 0 || fixed >= fixedSize) continue;
+            const T coeff = weight[k] * (f == 0 ? 1 - frac : frac);
+            const int64_t h = alongY ? moving : fixed;
+            const int64_t w = alongY ? fixed : moving;
+            axpyChannels(coeff, image + (h * width + w) * channels, acc, channels);
+        }
+    }
+}
+
+template <typename T>
+void prroiPoolCoorBackwardImpl(const T* output, const T* gradOutput, const T* input, const T* rois, T* gradRois, int64_t batch, int64_t channels,
+                               int64_t height, int64_t width, int64_t numRois, int64_t pooledHeight, int64_t pooledWidth, T scale) {
+    const PrroiTables<T> tables(rois, numRois, pooledHeight, pooledWidth, height, width, scale);
+    const std::vector<T> nhwc = toChannelsLast(input, batch, channels, height, width);
+    const int64_t bins = pooledHeight * pooledWidth;
+    // each roi is finished by one worker, so its four gradients are plain sums
+    parallelForDynamic(0, numRois, 1, [&](int, int64_t begin, int64_t end) {
+        std::vector<T> edges(4 * channels);
+        for (int64_t n = begin; n < end; ++n) {
+            const T* image = nhwc.data() + static_cast<int64_t>(rois[n * 5]) * height * width * channels;
+            T grad[4] = {0, 0, 0, 0};
+            for (int64_t ph = 0; ph < pooledHeight; ++ph) {
+                const int64_t binY = n * pooledHeight + ph;
+                const T* wy = tables.y.weight.data() + tables.y.offset[binY];
+                const T y1 = tables.y.lo[binY];
+                const T y2 = tables.y.hi[binY];
+                for (int64_t pw = 0; pw < pooledWidth; ++pw) {
+                    const int64_t binX = n * pooledWidth + pw;
+                    const T binSize = tables.binSize(binY, binX);
+                    if (binSize == 0) continue;
+                    const T* wx = tables.x.weight.data() + tables.x.offset[binX];
+                    const T x1 = tables.x.lo[binX];
+                    const T x2 = tables.x.hi[binX];
+                    std::fill(edges.begin(), edges.end(), T(0));
+                    T* gradX1 = edges.data();
+                    T* gradX2 = gradX1 + channels;
+                    T* gradY1 = gradX2 + channels;
+                    T* gradY2 = gradY1 + channels;
+                    edgeIntegral(image, height, width, channels, wy, tables.y.first[binY], tables.y.count[binY], x1, true, gradX1);
+                    edgeIntegral(image, height, width, channels, wy, tables.y.first[binY], tables.y.count[binY], x2, true, gradX2);
+                    edgeIntegral(image, height, width, channels, wx, tables.x.first[binX], tables.x.count[binX], y1, false, gradY1);
+                    edgeIntegral(image, height, width, channels, wx, tables.x.first[binX], tables.x.count[binX], y2, false, gradY2);
+                    const T wx1 = 1 - T(pw) / pooledWidth;
+                    const T wx2 = 1 - T(pw + 1) / pooledWidth;
+                    const T wy1 = 1 - T(ph) / pooledHeight;
+                    const T wy2 = 1 - T(ph + 1) / pooledHeight;
+                    for (int64_t c = 0; c < channels; ++c) {
+                        const int64_t index = (n * channels + c) * bins + ph * pooledWidth + pw;
+                        const T g = gradOutput[index];
+                        if (g == 0) continue;
+                        const T value = output[index];
+                        const T partialX1 = (-gradX1[c] + (y2 - y1) * value) / binSize * scale;
+                        const T partialY1 = (-gradY1[c] + (x2 - x1) * value) / binSize * scale;
+                        const T partialX2 = (gradX2[c] - (y2 - y1) * value) / binSize * scale;
+                        const T partialY2 = (gradY2[c] - (x2 - x1) * value) / binSize * scale;
+                        grad[0] += (partialX1 * wx1 + partialX2 * wx2) * g;
+                        grad[1] += (partialY1 * wy1 + partialY2 * wy2) * g;
+                        grad[2] += (partialX2 * (1 - wx2) + partialX1 * (1 - wx1)) * g;
+                        grad[3] += (partialY2 * (1 - wy2) + partialY1 * (1 - wy1)) * g;
+                    }
+                }
+            }
+            gradRois[n * 5] = 0;
+            for (int k = 0; k < 4; ++k) {
+                gradRois[n * 5 + 1 + k] += grad[k];
+            }
+        }
+    });
+}
+
+}  // namespace
+
+diopiError_t prroiPool(diopiTensorHandle_t input_, diopiTensorHandle_t rois_, diopiTensorHandle_t output_, int64_t pooled_height, int64_t pooled_width,
+                       float spatial_scale) {
+    auto input = makeTensor(input_);
+    auto rois = makeTensor(rois_);
+    auto output = makeTensor(output_);
+    const int64_t batch = input.size(0);
+    const int64_t channels = input.size(1);
+    const int64_t height = input.size(2);
+    const int64_t width = input.size(3);
+    const int64_t num_rois = rois.size(0);
+    if (input.dtype() == diopi_dtype_float32) {
+        prroiPoolImpl(static_cast<const float*>(input.data()), static_cast<const float*>(rois.data()), static_cast<float*>(output.data()), batch, channels,
+                      height, width, num_rois, pooled_height, pooled_width, spatial_scale);
+    } else if (input.dtype() == diopi_dtype_float64) {
+        prroiPoolImpl(static_cast<const double*>(input.data()), static_cast<const double*>(rois.data()), static_cast<double*>(output.data()), batch, channels,
+                      height, width, num_rois, pooled_height, pooled_width, static_cast<double>(spatial_scale));
+    } else {
+        set_last_error_string("prroi pool on host does not support dtype %d at %s:%d", input.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t prroiPoolBackward(diopiTensorHandle_t grad_output_, diopiTensorHandle_t rois_, diopiTensorHandle_t grad_input_, int64_t pooled_height,
+                               int64_t pooled_width, float spatial_scale) {
+    auto grad_output = makeTensor(grad_output_);
+    auto rois = makeTensor(rois_);
+    auto grad_input = makeTensor(grad_input_);
+    const int64_t batch = grad_input.size(0);
+    const int64_t channels = grad_input.size(1);
+    const int64_t height = grad_input.size(2);
+    const int64_t width = grad_input.size(3);
+    const int64_t num_rois = rois.size(0);
+    if (grad_input.dtype() == diopi_dtype_float32) {
+        prroiPoolBackwardImpl(static_cast<const float*>(grad_output.data()), static_cast<const float*>(rois.data()), static_cast<float*>(grad_input.data()),
+                              batch, channels, height, width, num_rois, pooled_height, pooled_width, spatial_scale);
+    } else if (grad_input.dtype() == diopi_dtype_float64) {
+        prroiPoolBackwardImpl(static_cast<const double*>(grad_output.data()), static_cast<const double*>(rois.data()), static_cast<double*>(grad_input.data()),
+                              batch, channels, height, width, num_rois, pooled_height, pooled_width, static_cast<double>(spatial_scale));
+    } else {
+        set_last_error_string("prroi pool backward on host does not support dtype %d at %s:%d", grad_input.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+diopiError_t prroiPoolCoorBackward(diopiTensorHandle_t output_, diopiTensorHandle_t grad_output_, diopiTensorHandle_t input_, diopiTensorHandle_t rois_,
+                                   diopiTensorHandle_t grad_rois_, int64_t pooled_height, int64_t pooled_width, float spatial_scale) {
+    auto output = makeTensor(output_);
+    auto grad_output = makeTensor(grad_output_);
+    auto input = makeTensor(input_);
+    auto rois = makeTensor(rois_);
+    auto grad_rois = makeTensor(grad_rois_);
+    const int64_t batch = input.size(0);
+    const int64_t channels = input.size(1);
+    const int64_t height = input.size(2);
+    const int64_t width = input.size(3);
+    const int64_t num_rois = rois.size(0);
+    if (input.dtype() == diopi_dtype_float32) {
+        prroiPoolCoorBackwardImpl(static_cast<const float*>(output.data()), static_cast<const float*>(grad_output.data()),
+                                  static_cast<const float*>(input.data()), static_cast<const float*>(rois.data()), static_cast<float*>(grad_rois.data()), batch,
+                                  channels, height, width, num_rois, pooled_height, pooled_width, spatial_scale);
+    } else if (input.dtype() == diopi_dtype_float64) {
+        prroiPoolCoorBackwardImpl(static_cast<const double*>(output.data()), static_cast<const double*>(grad_output.data()),
+                                  static_cast<const double*>(input.data()), static_cast<const double*>(rois.data()), static_cast<double*>(grad_rois.data()),
+                                  batch, channels, height, width, num_rois, pooled_height, pooled_width, static_cast<double>(spatial_scale));
+    } else {
+        set_last_error_string("prroi pool coor backward on host does not support dtype %d at %s:%d", input.dtype(), __FILE__, __LINE__);
+        return diopiDtypeNotSupported;
+    }
+    return diopiSuccess;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
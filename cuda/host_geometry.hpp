@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CUDA_HOST_GEOMETRY_HPP_
+#define IMPL_CUDA_HOST_GEOMETRY_HPP_
+
+#include <algorithm>
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+// 2-d helpers shared by the host polygon kernels, all in double like the CUDA kernels.
+
+struct Vec2 {
+    double x;
+    double y;
+};
+
+inline double cross(const Vec2& o, const Vec2& a, const Vec2& b) { return (a.x - o.x) * (b.y - o.y) - (b.x - o.x) * (a.y - o.y); }
+
+template <int N>
+double signedArea(const Vec2* p) {
+    double res = 0;
+    for (int i = 0; i < N; ++i) {
+        const int j = i + 1 == N ? 0 : i + 1;
+        res += p[i].x * p[j].y - p[i].y * p[j].x;
+    }
+    return res / 2;
+}
+
+inline double signedArea(const Vec2* p, int n) {
+    double res = 0;
+    for (int i = 0; i < n; ++i) {
+        const int j = i + 1 == n ? 0 : i + 1;
+        res += p[i].x * p[j].y - p[i].y * p[j].x;
+    }
+    return res / 2;
+}
+
+/**
+ * Counter-clockwise convex hull of N points without collinear vertices (monotone chain). tag[i] is carried along
+ * with each point and written to hullTag. Returns the number of hull vertices.
+ */
+template <int N>
+int convexHull(const Vec2* points, const int* tag, Vec2* hull, int* hullTag) {
+    int order[N];
+    for (int i = 0; i < N; ++i) order[i] = i;
+    std::sort(order, order + N, [&](int a, int b) {
+        return points[a].x < points[b].x || (points[a].x == points[b].x && (points[a].y < points[b].y || (points[a].y == points[b].y && a < b)));
+    });
+    int chain[2 * N];
+    int k = 0;
+    for (int i = 0; i < N; ++i) {
+        while (k >= 2 && cross(points[chain[k - 2]], points[chain[k - 1]], points[order[i]]) <= 0) --k;
+        chain[k++] = order[i];
+    }
+    for (int i = N - 2, lower = k + 1; i >= 0; --i) {
+        while (k >= lower && cross(points[chain[k - 2]], points[chain[k - 1]], points[order[i]]) <= 0) --k;
+        chain[k++] = order[i];
+    }
+    const int n = std::max(k - 1, 1);
+    for (int i = 0; i < n; ++i) {
+        hull[i] = points[chain[i]];
+        hullTag[i] = tag[chain[i]];
+    }
+    return n;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
+
+#endif  // IMPL_CUDA_HOST_GEOMETRY_HPP_
@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include "host_helper.hpp"
+
+#include <cstdlib>
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+namespace {
+
+thread_local bool tlsInParallelRegion = false;
+
+int defaultThreads() {
+    const char* env = std::getenv("DIOPI_HOST_NUM_THREADS");
+    int threads = env ? std::atoi(env) : static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(threads, 1);
+}
+
+}  // namespace
+
+HostThreadPool& HostThreadPool::instance() {
+    static HostThreadPool pool;
+    return pool;
+}
+
+bool HostThreadPool::inParallelRegion() { return tlsInParallelRegion; }
+
+HostThreadPool::HostThreadPool() {
+    const int threads = defaultThreads();
+    for (int worker = 1; worker < threads; ++worker) {
+        workers_.emplace_back(&HostThreadPool::loop, this, worker);
+    }
+}
+
+HostThreadPool::~HostThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void HostThreadPool::run(const std::function<void(int)>& task) {
+    // one region at a time, callers from other threads queue up here
+    std::lock_guard<std::mutex> runGuard(runMutex_);
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        task_ = &task;
+        pending_ = static_cast<int>(workers_.size());
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    tlsInParallelRegion = true;
+    task(0);
+    tlsInParallelRegion = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void HostThreadPool::loop(int worker) {
+    tlsInParallelRegion = true;
+    uint64_t seen = 0;
+    while (true) {
+        const std::function<void(int)>* task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+            task = task_;
+        }
+        (*task)(worker);
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            --pending_;
+        }
+        done_.notify_one();
+    }
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
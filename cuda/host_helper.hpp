@@ -0,0 +1,208 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CUDA_HOST_HELPER_HPP_
+#define IMPL_CUDA_HOST_HELPER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace impl {
+
+namespace cuda {
+
+namespace host {
+
+// Inner loops of the host kernels work on tiles of kLanes elements so that the compiler maps them to one SIMD register of floats.
+constexpr int kLanes = 8;
+
+/**
+ * Persistent worker threads shared by the host kernels. The calling thread takes part as worker 0.
+ * Parallel regions started from inside a region run inline on the calling worker.
+ */
+class HostThreadPool final {
+public:
+    static HostThreadPool& instance();
+
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // runs task(worker) once on every worker and returns when all are done
+    void run(const std::function<void(int)>& task);
+
+    static bool inParallelRegion();
+
+private:
+    HostThreadPool();
+    ~HostThreadPool();
+    HostThreadPool(const HostThreadPool&) = delete;
+    HostThreadPool& operator=(const HostThreadPool&) = delete;
+
+    void loop(int worker);
+
+    std::vector<std::thread> workers_;
+    std::mutex runMutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int)>* task_ = nullptr;
+    uint64_t generation_ = 0;
+    int pending_ = 0;
+    bool stop_ = false;
+};
+
+/**
+ * IEEE half bits of value, rounded to nearest even. Branch free, so loops over it vectorize; NaN payloads
+ * are not kept.
+ */
+inline uint16_t floatToHalfBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t abs = bits & 0x7fffffffu;
+    // subnormal halves: adding 0.5 lines the mantissa up with the low bits, the FPU does the rounding
+    float shifted;
+    std::memcpy(&shifted, &abs, sizeof(shifted));
+    shifted += 0.5f;
+    uint32_t subnormal;
+    std::memcpy(&subnormal, &shifted, sizeof(subnormal));
+    subnormal -= 0x3f000000u;
+    const uint32_t normal = (abs + 0xc8000fffu + ((abs >> 13) & 1u)) >> 13;
+    // masks instead of ternaries, which GCC keeps as branches
+    const uint32_t isSubnormal = 0u - static_cast<uint32_t>(abs < 0x38800000u);
+    const uint32_t isSpecial = 0u - static_cast<uint32_t>(abs >= 0x47800000u);
+    const uint32_t special = 0x7c00u | ((0u - static_cast<uint32_t>(abs > 0x7f800000u)) & 0x0200u);
+    const uint32_t finite = (subnormal & isSubnormal) | (normal & ~isSubnormal);
+    return static_cast<uint16_t>((special & isSpecial) | (finite & ~isSpecial) | sign);
+}
+
+inline int hostThreads() { return HostThreadPool::instance().size(); }
+
+/**
+ * Calls f(begin, end) on contiguous, equally sized sub-ranges of [begin, end), one per worker,
+ * none smaller than grain.
+ */
+template <typename F>
+void parallelFor(int64_t begin, int64_t end, int64_t grain, const F& f) {
+    const int64_t n = end - begin;
+    if (n <= 0) return;
+    grain = std::max<int64_t>(grain, 1);
+    const int64_t chunks = std::min<int64_t>(hostThreads(), (n + grain - 1) / grain);
+    if (chunks <= 1 || HostThreadPool::inParallelRegion()) {
+        f(begin, end);
+        return;
+    }
+    HostThreadPool::instance().run([&](int worker) {
+        if (worker >= chunks) return;
+        const int64_t lo = begin + n * worker / chunks;
+        const int64_t hi = begin + n * (worker + 1) / chunks;
+        if (lo < hi) f(lo, hi);
+    });
+}
+
+/**
+ * Calls f(worker, begin, end) on chunks of [begin, end) handed out on demand, so workers that finish
+ * early keep taking work. Use it when the cost per item varies. worker < hostThreads() indexes
+ * per-thread scratch or accumulators.
+ */
+template <typename F>
+void parallelForDynamic(int64_t begin, int64_t end, int64_t chunk, const F& f) {
+    const int64_t n = end - begin;
+    if (n <= 0) return;
+    chunk = std::max<int64_t>(chunk, 1);
+    if (n <= chunk || hostThreads() == 1 || HostThreadPool::inParallelRegion()) {
+        f(0, begin, end);
+        return;
+    }
+    std::atomic<int64_t> next(begin);
+    HostThreadPool::instance().run([&](int worker) {
+        for (int64_t lo = next.fetch_add(chunk); lo < end; lo = next.fetch_add(chunk)) {
+            f(worker, lo, std::min(lo + chunk, end));
+        }
+    });
+}
+
+// NCHW to NHWC, so that per-pixel work runs over contiguous channels
+template <typename T>
+std::vector<T> toChannelsLast(const T* input, int64_t batch, int64_t channels, int64_t height, int64_t width) {
+    std::vector<T> out(batch * channels * height * width);
+    parallelFor(0, batch * height, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t bh = begin; bh < end; ++bh) {
+            const int64_t b = bh / height;
+            const int64_t h = bh % height;
+            T* dst = out.data() + bh * width * channels;
+            const T* src = input + b * channels * height * width + h * width;
+            // blocks of channels, so every pixel gets a contiguous run written while the block's rows stay in cache
+            for (int64_t c0 = 0; c0 < channels; c0 += 2 * kLanes) {
+                const int64_t c1 = std::min(c0 + 2 * kLanes, channels);
+                for (int64_t w = 0; w < width; ++w) {
+                    for (int64_t c = c0; c < c1; ++c) {
+                        dst[w * channels + c] = src[c * height * width + w];
+                    }
+                }
+            }
+        }
+    });
+    return out;
+}
+
+/**
+ * The four taps of a bilinear sample, with the clamping of bilinear_interpolate in cuda_helper.hpp. Samples outside
+ * the feature map have all weights zero and all offsets 0, so they can be read or scattered without a check.
+ * offset is the pixel index h * width + w.
+ */
+template <typename T>
+struct BilinearPoint {
+    int64_t offset[4];
+    T weight[4];
+};
+
+template <typename T>
+inline BilinearPoint<T> bilinearPoint(int64_t height, int64_t width, T y, T x) {
+    BilinearPoint<T> p{{0, 0, 0, 0}, {0, 0, 0, 0}};
+    if (y < -1.0 || y > height || x < -1.0 || x > width) return p;
+    if (y <= 0) y = 0;
+    if (x <= 0) x = 0;
+    int64_t yLow = static_cast<int64_t>(y);
+    int64_t xLow = static_cast<int64_t>(x);
+    int64_t yHigh = yLow + 1;
+    int64_t xHigh = xLow + 1;
+    if (yLow >= height - 1) {
+        yHigh = yLow = height - 1;
+        y = static_cast<T>(yLow);
+    }
+    if (xLow >= width - 1) {
+        xHigh = xLow = width - 1;
+        x = static_cast<T>(xLow);
+    }
+    const T ly = y - yLow;
+    const T lx = x - xLow;
+    const T hy = 1 - ly;
+    const T hx = 1 - lx;
+    p.offset[0] = yLow * width + xLow;
+    p.offset[1] = yLow * width + xHigh;
+    p.offset[2] = yHigh * width + xLow;
+    p.offset[3] = yHigh * width + xHigh;
+    p.weight[0] = hy * hx;
+    p.weight[1] = hy * lx;
+    p.weight[2] = ly * hx;
+    p.weight[3] = ly * lx;
+    return p;
+}
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
+
+#endif  // IMPL_CUDA_HOST_HELPER_HPP_
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_CUDA_HOST_KERNELS_HPP_
+#define IMPL_CUDA_HOST_KERNELS_HPP_
+
+#include <diopi/diopirt.h>
+
+namespace impl {
+
+namespace cuda {
+
+/**
+ * Host implementations of the mmcv ops, used when the tensors live in host memory.
+ * They take the same arguments as the diopi functions they back.
+ */
+namespace host {
+
+diopiError_t knn(diopiTensorHandle_t xyz, diopiTensorHandle_t new_xyz, diopiTensorHandle_t idx, diopiTensorHandle_t dist2, int64_t b, int64_t n, int64_t m,
+                 int64_t nsample);
+
+diopiError_t chamferDistance(diopiConstTensorHandle_t xyz1_in, diopiConstTensorHandle_t xyz2_in, diopiTensorHandle_t dist1_out, diopiTensorHandle_t dist2_out,
+                             diopiTensorHandle_t idx1_out, diopiTensorHandle_t idx2_out);
+
+// grad_xyz1 and grad_xyz2 are overwritten, they do not need to be zeroed
+diopiError_t chamferDistanceBackward(diopiConstTensorHandle_t xyz1_in, diopiConstTensorHandle_t xyz2_in, diopiConstTensorHandle_t idx1_in,
+                                     diopiConstTensorHandle_t idx2_in, diopiConstTensorHandle_t grad_dist1_in, diopiConstTensorHandle_t grad_dist2_in,
+                                     diopiTensorHandle_t grad_xyz1_out, diopiTensorHandle_t grad_xyz2_out);
+
+// mode is 0 for iou, 1 for iof, 2 for giou; the CUDA kernel has no giou. ious may be float16 when the boxes are float32
+diopiError_t bboxOverlaps(diopiConstTensorHandle_t bboxes1_, diopiConstTensorHandle_t bboxes2_, diopiTensorHandle_t ious_, int64_t mode, bool aligned,
+                          int64_t offset);
+
+diopiError_t convexIou(diopiConstTensorHandle_t pointsets_, diopiConstTensorHandle_t polygons_, diopiTensorHandle_t ious_);
+
+diopiError_t convexGiou(diopiConstTensorHandle_t pointsets_, diopiConstTensorHandle_t polygons_, diopiTensorHandle_t output_);
+
+diopiError_t minAreaPolygons(diopiConstTensorHandle_t pointsets_, diopiTensorHandle_t polygons_);
+
+diopiError_t prroiPool(diopiTensorHandle_t input_, diopiTensorHandle_t rois_, diopiTensorHandle_t output_, int64_t pooled_height, int64_t pooled_width,
+                       float spatial_scale);
+
+// accumulates into grad_input like the CUDA kernel, so grad_input is expected to be zeroed
+diopiError_t prroiPoolBackward(diopiTensorHandle_t grad_output_, diopiTensorHandle_t rois_, diopiTensorHandle_t grad_input_, int64_t pooled_height,
+                               int64_t pooled_width, float spatial_scale);
+
+// accumulates into grad_rois[:, 1:] like the CUDA kernel, so grad_rois is expected to be zeroed
+diopiError_t prroiPoolCoorBackward(diopiTensorHandle_t output_, diopiTensorHandle_t grad_output_, diopiTensorHandle_t input_, diopiTensorHandle_t rois_,
+                                   diopiTensorHandle_t grad_rois_, int64_t pooled_height, int64_t pooled_width, float spatial_scale);
+
+// argmax_idx may be int32 like on CUDA, or int16 to halve its memory when pool_size fits
+diopiError_t borderAlign(diopiConstTensorHandle_t input_, diopiConstTensorHandle_t boxes_, diopiTensorHandle_t output_, diopiTensorHandle_t argmax_idx_,
+                         const int64_t pool_size);
+
+// accumulates into grad_input like the CUDA kernel, so grad_input is expected to be zeroed
+diopiError_t borderAlignBackward(diopiConstTensorHandle_t grad_output_, diopiConstTensorHandle_t boxes_, diopiConstTensorHandle_t argmax_idx_,
+                                 diopiTensorHandle_t grad_input_, const int64_t pool_size);
+
+// offset_ may be null for plain roi align pooling
+diopiError_t deformRoiPool(diopiTensorHandle_t input_, diopiTensorHandle_t rois_, diopiTensorHandle_t offset_, diopiTensorHandle_t output_,
+                           int64_t pooled_height, int64_t pooled_width, float spatial_scale, int64_t sampling_ratio, float gamma);
+
+// accumulates into grad_input and grad_offset like the CUDA kernel, so both are expected to be zeroed
+diopiError_t deformRoiPoolBackward(diopiTensorHandle_t grad_output_, diopiTensorHandle_t input_, diopiTensorHandle_t rois_, diopiTensorHandle_t offset_,
+                                   diopiTensorHandle_t grad_input_, diopiTensorHandle_t grad_offset_, int64_t pooled_height, int64_t pooled_width,
+                                   float spatial_scale, int64_t sampling_ratio, float gamma);
+
+// the gather plans compiled from indices are cached, keyed by the table content
+diopiError_t activeRotatedFilter(diopiConstTensorHandle_t input_, diopiConstTensorHandle_t indices_, diopiTensorHandle_t output_);
+
+diopiError_t activeRotatedFilterBackward(diopiConstTensorHandle_t grad_out_, diopiConstTensorHandle_t indices_, diopiTensorHandle_t grad_in_);
+
+// accumulates into output like the CUDA kernel, so output is expected to be zeroed
+diopiError_t assignScoreWithk(diopiConstTensorHandle_t points_, diopiConstTensorHandle_t centers_, diopiConstTensorHandle_t scores_,
+                              diopiConstTensorHandle_t knn_idx_, diopiTensorHandle_t output_, int64_t B, int64_t N0, int64_t N1, int64_t M, int64_t K,
+                              int64_t O);
+
+// accumulates into grad_points, grad_centers and grad_scores like the CUDA kernels, so all three are expected to be zeroed
+diopiError_t assignScoreWithkBackward(diopiConstTensorHandle_t grad_out_, diopiConstTensorHandle_t points_, diopiConstTensorHandle_t centers_,
+                                      diopiConstTensorHandle_t scores_, diopiConstTensorHandle_t knn_idx_, diopiTensorHandle_t grad_points_,
+                                      diopiTensorHandle_t grad_centers_, diopiTensorHandle_t grad_scores_, int64_t B, int64_t N0, int64_t N1, int64_t M,
+                                      int64_t K, int64_t O);
+
+}  // namespace host
+
+}  // namespace cuda
+
+}  // namespace impl
+
+#endif  // IMPL_CUDA_HOST_KERNELS_HPP_
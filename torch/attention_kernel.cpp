@@ -0,0 +1,388 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/ExpandUtils.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// queries and keys of a tile; a score tile of kQueryTile x kKeyTile floats stays in L1
+constexpr int64_t kQueryTile = 32;
+constexpr int64_t kKeyTile = 64;
+
+constexpr float kNegInf = -std::numeric_limits<float>::infinity();
+
+// (batch * heads, queries or keys, dim) operands, all contiguous
+struct AttentionShape {
+    int64_t batchHeads;
+    int64_t heads;
+    int64_t queries;
+    int64_t keys;
+    int64_t dim;
+    int64_t valueDim;
+};
+
+// additive mask element (b, h, i, j) at b * sb + h * sh + i * sq + j * sk, any of them 0 when broadcast; null for none
+struct AttentionMask {
+    const float* data;
+    int64_t sb;
+    int64_t sh;
+    int64_t sq;
+    int64_t sk;
+
+    const float* head(int64_t bh, int64_t heads) const { return data == nullptr ? nullptr : data + bh / heads * sb + bh % heads * sh; }
+};
+
+// keys a query row attends to stop here; causal attention is aligned to the top left, query i sees keys 0 .. i
+inline int64_t keyEnd(const AttentionShape& s, bool causal, int64_t lastQuery) { return causal ? std::min(s.keys, lastQuery + 1) : s.keys; }
+
+// partial sums of a dot product: the compiler may not reorder a float reduction, but it vectorizes across the lanes
+constexpr int64_t kLanes = 16;
+
+inline float dot(const float* __restrict a, const float* __restrict b, int64_t n) {
+    float lanes[kLanes] = {};
+    const int64_t whole = n - n % kLanes;
+    for (int64_t d = 0; d < whole; d += kLanes) {
+        for (int64_t l = 0; l < kLanes; ++l) lanes[l] += a[d + l] * b[d + l];
+    }
+    float sum = 0.f;
+    for (int64_t d = whole; d < n; ++d) sum += a[d] * b[d];
+    for (int64_t l = 0; l < kLanes; ++l) sum += lanes[l];
+    return sum;
+}
+
+/**
+ * Scores of query row i against keys k0 .. k0 + cols of k (keys, dim): q_i . k_j plus the mask, -inf past the causal
+ * limit. qs is the query row already multiplied by the scale.
+ */
+void scoreRow(const float* qs, const float* k, int64_t dim, const float* maskRow, int64_t maskStep, bool causal, int64_t i, int64_t k0, int64_t cols,
+              float* s) {
+    for (int64_t c = 0; c < cols; ++c) s[c] = dot(qs, k + (k0 + c) * dim, dim);
+    if (maskRow != nullptr) {
+        for (int64_t c = 0; c < cols; ++c) s[c] += maskRow[(k0 + c) * maskStep];
+    }
+    if (causal) {
+        for (int64_t c = std::max<int64_t>(i + 1 - k0, 0); c < cols; ++c) s[c] = kNegInf;
+    }
+}
+
+/**
+ * Forward over one query tile of one head, with the softmax kept online: every key tile updates a running maximum and
+ * sum per row and rescales the accumulated P x V rows by exp(old max - new max), so a score tile is all that is ever
+ * held. lse receives max + log(sum) per row for the backward. A row with every key masked out ends as NaN, as a
+ * softmax over -inf alone does.
+ */
+void attentionTile(const AttentionShape& s, const float* q, const float* k, const float* v, const float* mask, const AttentionMask& strides, float scale,
+                   bool causal, int64_t q0, float* out, float* lse, std::vector<float>& buffer) {
+    const int64_t rows = std::min(kQueryTile, s.queries - q0);
+    buffer.resize(rows * s.dim + kKeyTile + rows * s.valueDim + 2 * rows);
+    float* qs = buffer.data();
+    float* score = qs + rows * s.dim;
+    float* acc = score + kKeyTile;
+    float* rowMax = acc + rows * s.valueDim;
+    float* rowSum = rowMax + rows;
+    for (int64_t r = 0; r < rows * s.dim; ++r) qs[r] = scale * q[q0 * s.dim + r];
+    std::fill(acc, acc + rows * s.valueDim, 0.f);
+    std::fill(rowMax, rowMax + rows, kNegInf);
+    std::fill(rowSum, rowSum + rows, 0.f);
+    const int64_t end = keyEnd(s, causal, q0 + rows - 1);
+    for (int64_t k0 = 0; k0 < end; k0 += kKeyTile) {
+        const int64_t cols = std::min(kKeyTile, end - k0);
+        for (int64_t r = 0; r < rows; ++r) {
+            const int64_t i = q0 + r;
+            scoreRow(qs + r * s.dim, k, s.dim, mask == nullptr ? nullptr : mask + i * strides.sq, strides.sk, causal, i, k0, cols, score);
+            float tileMax = kNegInf;
+            for (int64_t c = 0; c < cols; ++c) tileMax = std::max(tileMax, score[c]);
+            const float newMax = std::max(rowMax[r], tileMax);
+            // nothing of this tile is visible to the row, and neither was anything before it
+            if (newMax == kNegInf) continue;
+            const float correction = std::exp(rowMax[r] - newMax);
+            float sum = 0.f;
+            for (int64_t c = 0; c < cols; ++c) {
+                score[c] = std::exp(score[c] - newMax);
+                sum += score[c];
+            }
+            rowMax[r] = newMax;
+            rowSum[r] = rowSum[r] * correction + sum;
+            float* a = acc + r * s.valueDim;
+            if (correction != 1.f) {
+                for (int64_t d = 0; d < s.valueDim; ++d) a[d] *= correction;
+            }
+            for (int64_t c = 0; c < cols; ++c) {
+                const float p = score[c];
+                if (p == 0.f) continue;
+                const float* __restrict vr = v + (k0 + c) * s.valueDim;
+                for (int64_t d = 0; d < s.valueDim; ++d) a[d] += p * vr[d];
+            }
+        }
+    }
+    for (int64_t r = 0; r < rows; ++r) {
+        const float inverse = 1.f / rowSum[r];
+        const float* a = acc + r * s.valueDim;
+        float* o = out + (q0 + r) * s.valueDim;
+        for (int64_t d = 0; d < s.valueDim; ++d) o[d] = rowSum[r] == 0.f ? std::numeric_limits<float>::quiet_NaN() : a[d] * inverse;
+        lse[q0 + r] = rowMax[r] + std::log(rowSum[r]);
+    }
+}
+
+void attentionForward(const AttentionShape& s, const float* q, const float* k, const float* v, const AttentionMask& mask, float scale, bool causal,
+                      float* out, float* lse) {
+    const int64_t tiles = (s.queries + kQueryTile - 1) / kQueryTile;
+    at::parallel_for(0, s.batchHeads * tiles, 1, [&](int64_t begin, int64_t end) {
+        std::vector<float> buffer;
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t bh = task / tiles;
+            attentionTile(s,
+                          q + bh * s.queries * s.dim,
+                          k + bh * s.keys * s.dim,
+                          v + bh * s.keys * s.valueDim,
+                          mask.head(bh, s.heads),
+                          mask,
+                          scale,
+                          causal,
+                          task % tiles * kQueryTile,
+                          out + bh * s.queries * s.valueDim,
+                          lse + bh * s.queries,
+                          buffer);
+        }
+    });
+}
+
+/**
+ * One block of the backward with the probabilities recomputed from the scores and lse rather than stored: for query
+ * row i and the keys of a tile, p = exp(score - lse_i), dp = dO_i . v_j and ds = p * (dp - delta_i) with delta_i =
+ * dO_i . O_i. The callback gets the row's p and ds.
+ */
+template <typename F>
+void recomputeRow(const AttentionShape& s, const float* qs, const float* k, const float* v, const float* gradOut, const float* maskRow, int64_t maskStep,
+                  bool causal, int64_t i, float rowLse, float delta, int64_t k0, int64_t cols, float* p, float* ds, const F& f) {
+    // lse is -inf exactly when the row saw no key, and it then has no gradient
+    if (rowLse == kNegInf) return;
+    scoreRow(qs, k, s.dim, maskRow, maskStep, causal, i, k0, cols, p);
+    for (int64_t c = 0; c < cols; ++c) {
+        p[c] = std::exp(p[c] - rowLse);
+        ds[c] = p[c] == 0.f ? 0.f : p[c] * (dot(gradOut, v + (k0 + c) * s.valueDim, s.valueDim) - delta);
+    }
+    f(p, ds);
+}
+
+/**
+ * Gradients of one head in two passes that each own what they write, so nothing is accumulated across threads: tasks
+ * over key tiles sum dK and dV over every query, then tasks over query tiles sum dQ over every key.
+ */
+void attentionBackward(const AttentionShape& s, const float* q, const float* k, const float* v, const float* out, const float* gradOut, const float* lse,
+                       const AttentionMask& mask, float scale, bool causal, float* gradQ, float* gradK, float* gradV) {
+    std::vector<float> delta(s.batchHeads * s.queries);
+    at::parallel_for(0, s.batchHeads * s.queries, 64, [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+            float sum = 0.f;
+            for (int64_t d = 0; d < s.valueDim; ++d) sum += gradOut[row * s.valueDim + d] * out[row * s.valueDim + d];
+            delta[row] = sum;
+        }
+    });
+    const int64_t keyTiles = (s.keys + kKeyTile - 1) / kKeyTile;
+    at::parallel_for(0, s.batchHeads * keyTiles, 1, [&](int64_t begin, int64_t end) {
+        std::vector<float> qs(s.dim), p(kKeyTile), ds(kKeyTile);
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t bh = task / keyTiles;
+            const int64_t k0 = task % keyTiles * kKeyTile;
+            const int64_t cols = std::min(kKeyTile, s.keys - k0);
+            const float* qh = q + bh * s.queries * s.dim;
+            const float* gh = gradOut + bh * s.queries * s.valueDim;
+            const float* mh = mask.head(bh, s.heads);
+            float* dk = gradK + (bh * s.keys + k0) * s.dim;
+            float* dv = gradV + (bh * s.keys + k0) * s.valueDim;
+            std::fill(dk, dk + cols * s.dim, 0.f);
+            std::fill(dv, dv + cols * s.valueDim, 0.f);
+            // under the causal mask the queries before k0 see none of these keys
+            for (int64_t i = causal ? k0 : 0; i < s.queries; ++i) {
+                for (int64_t d = 0; d < s.dim; ++d) qs[d] = scale * qh[i * s.dim + d];
+                const float* g = gh + i * s.valueDim;
+                recomputeRow(s,
+                             qs.data(),
+                             k + bh * s.keys * s.dim,
+                             v + bh * s.keys * s.valueDim,
+                             g,
+                             mh == nullptr ? nullptr : mh + i * mask.sq,
+                             mask.sk,
+                             causal,
+                             i,
+                             lse[bh * s.queries + i],
+                             delta[bh * s.queries + i],
+                             k0,
+                             cols,
+                             p.data(),
+                             ds.data(),
+                             [&](const float* pr, const float* dsr) {
+                                 for (int64_t c = 0; c < cols; ++c) {
+                                     float* dvr = dv + c * s.valueDim;
+                                     float* dkr = dk + c * s.dim;
+                                     const float a = pr[c], b = scale * dsr[c];
+                                     for (int64_t d = 0; d < s.valueDim; ++d) dvr[d] += a * g[d];
+                                     for (int64_t d = 0; d < s.dim; ++d) dkr[d] += b * qh[i * s.dim + d];
+                                 }
+                             });
+            }
+        }
+    });
+    const int64_t queryTiles = (s.queries + kQueryTile - 1) / kQueryTile;
+    at::parallel_for(0, s.batchHeads * queryTiles, 1, [&](int64_t begin, int64_t end) {
+        std::vector<float> qs(kQueryTile * s.dim), p(kKeyTile), ds(kKeyTile);
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t bh = task / queryTiles;
+            const int64_t q0 = task % queryTiles * kQueryTile;
+            const int64_t rows = std::min(kQueryTile, s.queries - q0);
+            const float* kh = k + bh * s.keys * s.dim;
+            const float* mh = mask.head(bh, s.heads);
+            float* dq = gradQ + (bh * s.queries + q0) * s.dim;
+            std::fill(dq, dq + rows * s.dim, 0.f);
+            for (int64_t r = 0; r < rows * s.dim; ++r) qs[r] = scale * q[(bh * s.queries + q0) * s.dim + r];
+            const int64_t end = keyEnd(s, causal, q0 + rows - 1);
+            for (int64_t k0 = 0; k0 < end; k0 += kKeyTile) {
+                const int64_t cols = std::min(kKeyTile, end - k0);
+                for (int64_t r = 0; r < rows; ++r) {
+                    const int64_t i = q0 + r;
+                    float* dqr = dq + r * s.dim;
+                    recomputeRow(s,
+                                 qs.data() + r * s.dim,
+                                 kh,
+                                 v + bh * s.keys * s.valueDim,
+                                 gradOut + (bh * s.queries + i) * s.valueDim,
+                                 mh == nullptr ? nullptr : mh + i * mask.sq,
+                                 mask.sk,
+                                 causal,
+                                 i,
+                                 lse[bh * s.queries + i],
+                                 delta[bh * s.queries + i],
+                                 k0,
+                                 cols,
+                                 p.data(),
+                                 ds.data(),
+                                 [&](const float*, const float* dsr) {
+                                     for (int64_t c = 0; c < cols; ++c) {
+                                         const float b = scale * dsr[c];
+                                         if (b == 0.f) continue;
+                                         const float* __restrict kr = kh + (k0 + c) * s.dim;
+                                         for (int64_t d = 0; d < s.dim; ++d) dqr[d] += b * kr[d];
+                                     }
+                                 });
+                }
+            }
+        }
+    });
+}
+
+bool isHostFloat(const at::Tensor& t) { return !t.defined() || (t.is_cpu() && t.scalar_type() == at::kFloat); }
+
+// the fused kernels take (B, H, L, D) operands and an additive fp32 mask broadcastable to (B, H, Lq, Lk)
+bool fusedAttentionSupported(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value, const at::Tensor& mask) {
+    if (!query.defined() || !isHostFloat(query) || !isHostFloat(key) || !isHostFloat(value) || !isHostFloat(mask)) return false;
+    if (query.dim() != 4 || key.dim() != 4 || value.dim() != 4) return false;
+    if (query.size(0) != key.size(0) || query.size(1) != key.size(1) || query.size(3) != key.size(3)) return false;
+    if (value.size(0) != key.size(0) || value.size(1) != key.size(1) || value.size(2) != key.size(2)) return false;
+    return !mask.defined() || at::is_expandable_to(mask.sizes(), {query.size(0), query.size(1), query.size(2), key.size(2)});
+}
+
+AttentionShape attentionShape(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value) {
+    return AttentionShape{query.size(0) * query.size(1), query.size(1), query.size(2), key.size(2), query.size(3), value.size(3)};
+}
+
+AttentionMask attentionMask(const at::Tensor& mask) {
+    if (!mask.defined()) return AttentionMask{nullptr, 0, 0, 0, 0};
+    return AttentionMask{mask.data_ptr<float>(), mask.stride(0), mask.stride(1), mask.stride(2), mask.stride(3)};
+}
+
+// scores with the mask, the causal one included, for the unfused path
+at::Tensor maskedScores(const at::Tensor& query, const at::Tensor& key, const at::Tensor& mask, double scale, bool causal) {
+    auto scores = at::matmul(query, key.transpose(-2, -1)) * scale;
+    if (mask.defined()) scores = scores + mask;
+    if (causal) {
+        auto visible = at::ones({query.size(-2), key.size(-2)}, query.options().dtype(at::kBool)).tril();
+        scores = scores.masked_fill(visible.logical_not(), -std::numeric_limits<double>::infinity());
+    }
+    return scores;
+}
+
+}  // namespace
+
+std::tuple<at::Tensor, at::Tensor> scaledDotProductAttention(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value, const at::Tensor& mask,
+        double scale, bool causal) {
+    if (!fusedAttentionSupported(query, key, value, mask)) {
+        auto scores = maskedScores(query, key, mask, scale, causal);
+        auto lse = at::logsumexp(scores, -1);
+        return std::make_tuple(at::matmul(at::exp(scores - lse.unsqueeze(-1)), value), lse);
+    }
+    auto q = query.contiguous();
+    auto k = key.contiguous();
+    auto v = value.contiguous();
+    // expanding only sets the strides of broadcast dimensions to 0
+    auto m = mask.defined() ? mask.expand({q.size(0), q.size(1), q.size(2), k.size(2)}) : at::Tensor();
+    const AttentionShape shape = attentionShape(q, k, v);
+    auto out = at::empty({q.size(0), q.size(1), q.size(2), v.size(3)}, q.options());
+    auto lse = at::empty({q.size(0), q.size(1), q.size(2)}, q.options());
+    attentionForward(shape,
+                     q.data_ptr<float>(),
+                     k.data_ptr<float>(),
+                     v.data_ptr<float>(),
+                     attentionMask(m),
+                     static_cast<float>(scale),
+                     causal,
+                     out.data_ptr<float>(),
+                     lse.data_ptr<float>());
+    return std::make_tuple(out, lse);
+}
+
+std::tuple<at::Tensor, at::Tensor, at::Tensor> scaledDotProductAttentionBackward(const at::Tensor& gradOut, const at::Tensor& query, const at::Tensor& key,
+        const at::Tensor& value, const at::Tensor& out, const at::Tensor& lse, const at::Tensor& mask, double scale, bool causal) {
+    if (!fusedAttentionSupported(query, key, value, mask) || !isHostFloat(gradOut) || !isHostFloat(out) || !isHostFloat(lse)) {
+        // a row that saw no key has lse -inf and no gradient, as in the fused path, instead of exp(-inf - -inf) = NaN
+        auto hidden = (lse == -std::numeric_limits<double>::infinity()).unsqueeze(-1);
+        auto p = at::exp(maskedScores(query, key, mask, scale, causal) - lse.unsqueeze(-1)).masked_fill(hidden, 0);
+        auto delta = (gradOut * out).sum(-1, true);
+        auto ds = (p * (at::matmul(gradOut, value.transpose(-2, -1)) - delta) * scale).masked_fill(hidden, 0);
+        return std::make_tuple(at::matmul(ds, key), at::matmul(ds.transpose(-2, -1), query), at::matmul(p.transpose(-2, -1), gradOut));
+    }
+    auto q = query.contiguous();
+    auto k = key.contiguous();
+    auto v = value.contiguous();
+    auto o = out.contiguous();
+    auto g = gradOut.contiguous();
+    auto l = lse.contiguous();
+    auto m = mask.defined() ? mask.expand({q.size(0), q.size(1), q.size(2), k.size(2)}) : at::Tensor();
+    auto gradQ = at::empty_like(q);
+    auto gradK = at::empty_like(k);
+    auto gradV = at::empty_like(v);
+    attentionBackward(attentionShape(q, k, v),
+                      q.data_ptr<float>(),
+                      k.data_ptr<float>(),
+                      v.data_ptr<float>(),
+                      o.data_ptr<float>(),
+                      g.data_ptr<float>(),
+                      l.data_ptr<float>(),
+                      attentionMask(m),
+                      static_cast<float>(scale),
+                      causal,
+                      gradQ.data_ptr<float>(),
+                      gradK.data_ptr<float>(),
+                      gradV.data_ptr<float>());
+    return std::make_tuple(gradQ, gradK, gradV);
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
@@ -0,0 +1,397 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/ATen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// timed runs per candidate after one warm-up run; the best one counts
+constexpr int kTuningRuns = 3;
+// bytes of transformed Winograd filters a process keeps, enough for every 3x3 layer of a ResNet-50 at F(4, 3)
+constexpr size_t kMaxWinogradFilterBytes = size_t(256) << 20;
+
+struct ConvProblem {
+    const at::Tensor& input;
+    const at::Tensor& weight;
+    const at::Tensor& bias;
+    at::IntArrayRef stride;
+    at::IntArrayRef padding;
+    at::IntArrayRef dilation;
+    int64_t groups;
+
+    int64_t spatialDims() const { return input.dim() - 2; }
+};
+
+struct ConvAlgorithmName {
+    ConvAlgorithm algorithm;
+    const char* name;
+};
+
+const ConvAlgorithmName kConvAlgorithms[] = {
+    {ConvAlgorithm::Aten, "aten"},
+    {ConvAlgorithm::Im2colGemm, "im2col_gemm"},
+    {ConvAlgorithm::PointwiseGemm, "pointwise_gemm"},
+    {ConvAlgorithm::WinogradF2x3, "winograd_f2x3"},
+    {ConvAlgorithm::WinogradF4x3, "winograd_f4x3"},
+};
+
+std::string convKey(const ConvProblem& p) {
+    std::ostringstream key;
+    auto dims = [&key](const char* tag, at::IntArrayRef values) {
+        key << tag;
+        for (size_t i = 0; i < values.size(); ++i) {
+            key << (i == 0 ? "" : "x") << values[i];
+        }
+    };
+    key << c10::toString(p.input.scalar_type());
+    dims(":i", p.input.sizes());
+    dims(":w", p.weight.sizes());
+    dims(":s", p.stride);
+    dims(":p", p.padding);
+    dims(":d", p.dilation);
+    key << ":g" << p.groups << ":b" << p.bias.defined();
+    // a channels last or strided operand is timed with the copies its candidates make of it
+    auto layout = [&key](const char* tag, const at::Tensor& t) {
+        const auto format = t.suggest_memory_format();
+        key << tag << format << (t.is_contiguous(format) ? "" : "Strided");
+    };
+    layout(":mi", p.input);
+    layout(":mw", p.weight);
+    return key.str();
+}
+
+at::Tensor addBias(at::Tensor out, const at::Tensor& bias) {
+    if (bias.defined()) {
+        std::vector<int64_t> shape(out.dim(), 1);
+        shape[1] = bias.numel();
+        out.add_(bias.reshape(shape));
+    }
+    return out;
+}
+
+// a single value applies to every spatial dim, as in at::convolution
+inline int64_t pick(at::IntArrayRef values, int64_t i) { return values[values.size() == 1 ? 0 : i]; }
+
+std::vector<int64_t> expandParam(at::IntArrayRef values, int64_t spatialDims) {
+    std::vector<int64_t> expanded(spatialDims);
+    for (int64_t i = 0; i < spatialDims; ++i) {
+        expanded[i] = pick(values, i);
+    }
+    return expanded;
+}
+
+/**
+ * The checks of at::native::check_shape_forward. A candidate that goes through ATen throws on a malformed problem and
+ * drops out of the race, but the Winograd kernels trust the shapes, so the problem is checked before any of them runs.
+ */
+void checkShapeForward(const ConvProblem& p) {
+    const auto& input = p.input;
+    const auto& weight = p.weight;
+    TORCH_CHECK(weight.dim() == input.dim(), "Expected ", weight.dim(), "-dimensional input for ", weight.dim(), "-dimensional weight ", weight.sizes(),
+                ", but got ", input.dim(), "-dimensional input of size ", input.sizes(), " instead");
+    for (int64_t i = 0; i < p.spatialDims(); ++i) {
+        TORCH_CHECK(p.padding[i] >= 0, "negative padding is not supported");
+        TORCH_CHECK(p.stride[i] > 0, "non-positive stride is not supported");
+        TORCH_CHECK(p.dilation[i] > 0, "dilation should be greater than zero");
+    }
+    TORCH_CHECK(p.groups > 0, "non-positive groups is not supported");
+    TORCH_CHECK(weight.size(0) >= p.groups, "Given groups=", p.groups, ", expected weight to be at least ", p.groups,
+                " at dimension 0, but got weight of size ", weight.sizes(), " instead");
+    TORCH_CHECK(weight.size(0) % p.groups == 0, "Given groups=", p.groups, ", expected weight to be divisible by ", p.groups,
+                " at dimension 0, but got weight of size ", weight.sizes(), " instead");
+    TORCH_CHECK(input.size(1) == weight.size(1) * p.groups, "Given groups=", p.groups, ", weight of size ", weight.sizes(), ", expected input",
+                input.sizes(), " to have ", weight.size(1) * p.groups, " channels, but got ", input.size(1), " channels instead");
+    TORCH_CHECK(!p.bias.defined() || (p.bias.dim() == 1 && p.bias.size(0) == weight.size(0)), "Given weight of size ", weight.sizes(),
+                ", expected bias to be 1-dimensional with ", weight.size(0), " elements, but got bias of size ", p.bias.sizes(), " instead");
+    for (int64_t i = 0; i < p.spatialDims(); ++i) {
+        const int64_t padded = input.size(i + 2) + 2 * p.padding[i];
+        const int64_t extent = p.dilation[i] * (weight.size(i + 2) - 1) + 1;
+        TORCH_CHECK(padded >= extent, "Calculated padded input size per channel: ", padded, " at dimension ", i + 2, ". Kernel size: ", extent,
+                    ". Kernel size can't be greater than actual input size");
+    }
+}
+
+std::vector<int64_t> outputSizes(const ConvProblem& p) {
+    std::vector<int64_t> sizes = {p.input.size(0), p.weight.size(0)};
+    for (int64_t i = 0; i < p.spatialDims(); ++i) {
+        const int64_t extent = p.dilation[i] * (p.weight.size(i + 2) - 1) + 1;
+        sizes.push_back((p.input.size(i + 2) + 2 * p.padding[i] - extent) / p.stride[i] + 1);
+    }
+    return sizes;
+}
+
+bool isPointwise(const ConvProblem& p) {
+    for (int64_t i = 0; i < p.spatialDims(); ++i) {
+        if (p.weight.size(i + 2) != 1 || p.stride[i] != 1 || p.padding[i] != 0) return false;
+    }
+    return true;
+}
+
+// the Winograd transforms change the rounding against ATen, so they only join the race when asked for
+bool winogradEnabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("DIOPI_TORCH_CONV_WINOGRAD");
+        return env != nullptr && std::string(env) == "1";
+    }();
+    return enabled;
+}
+
+bool isWinograd(const ConvProblem& p) {
+    if (p.spatialDims() != 2 || p.input.scalar_type() != at::kFloat || p.weight.scalar_type() != at::kFloat) return false;
+    if (p.bias.defined() && p.bias.scalar_type() != at::kFloat) return false;
+    return p.weight.size(2) == 3 && p.weight.size(3) == 3 && p.stride[0] == 1 && p.stride[1] == 1 && p.dilation[0] == 1 && p.dilation[1] == 1;
+}
+
+bool supports(ConvAlgorithm algorithm, const ConvProblem& p) {
+    switch (algorithm) {
+        case ConvAlgorithm::Aten:
+            return true;
+        case ConvAlgorithm::Im2colGemm:
+            return p.spatialDims() == 2;
+        case ConvAlgorithm::PointwiseGemm:
+            return isPointwise(p);
+        case ConvAlgorithm::WinogradF2x3:
+        case ConvAlgorithm::WinogradF4x3:
+            return winogradEnabled() && isWinograd(p);
+    }
+    return false;
+}
+
+// a 1x1 convolution with unit stride is, per group, weight (O/g, C/g) times the input viewed as (C/g, spatial)
+at::Tensor pointwiseGemm(const ConvProblem& p) {
+    const int64_t n = p.input.size(0);
+    const int64_t g = p.groups;
+    auto columns = p.input.reshape({n, g, p.input.size(1) / g, -1});
+    auto out = at::matmul(p.weight.reshape({g, p.weight.size(0) / g, -1}), columns);
+    return addBias(out.reshape(outputSizes(p)), p.bias);
+}
+
+// columns (N, C * kH * kW, L) keep the channels of a group together, so every group is one batched product
+at::Tensor im2colGemm(const ConvProblem& p) {
+    const int64_t n = p.input.size(0);
+    const int64_t g = p.groups;
+    auto columns = im2colSupported(p.input) ? host::im2col(p.input, {p.weight.size(2), p.weight.size(3)}, p.dilation, p.padding, p.stride)
+                                            : at::im2col(p.input.contiguous(), {p.weight.size(2), p.weight.size(3)}, p.dilation, p.padding, p.stride);
+    auto out = at::matmul(p.weight.reshape({g, p.weight.size(0) / g, -1}), columns.view({n, g, -1, columns.size(2)}));
+    return addBias(out.reshape(outputSizes(p)), p.bias);
+}
+
+/**
+ * Winograd filters by weight address, shape and tile, least recently used dropped first once they take more than
+ * kMaxWinogradFilterBytes. buildATen wraps the same memory in a fresh tensor on every call, so the version counter can't
+ * see an optimizer step; as in the packed GEMM weight cache, contentChecksum of the weights decides whether an entry is
+ * still valid, and a stale entry is rebuilt.
+ */
+class WinogradFilterCache {
+public:
+    static WinogradFilterCache& instance() {
+        static WinogradFilterCache cache;
+        return cache;
+    }
+
+    at::Tensor get(const at::Tensor& weight, int64_t tile) {
+        auto source = weight.contiguous();
+        const uint64_t checksum = contentChecksum(source);
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->data != weight.data_ptr() || it->tile != tile || at::IntArrayRef(it->sizes) != weight.sizes()) continue;
+            if (it->checksum == checksum) {
+                entries_.splice(entries_.begin(), entries_, it);
+                return it->transformed;
+            }
+            bytes_ -= it->transformed.nbytes();
+            entries_.erase(it);
+            break;
+        }
+        auto transformed = at::empty({winogradFilterNumel(tile, weight.size(0), weight.size(1))}, weight.options());
+        winogradTransformFilter(tile, source.data_ptr<float>(), weight.size(0), weight.size(1), transformed.data_ptr<float>());
+        if (transformed.nbytes() > kMaxWinogradFilterBytes) return transformed;
+        while (bytes_ + transformed.nbytes() > kMaxWinogradFilterBytes) {
+            bytes_ -= entries_.back().transformed.nbytes();
+            entries_.pop_back();
+        }
+        bytes_ += transformed.nbytes();
+        entries_.push_front(Entry{weight.data_ptr(), tile, weight.sizes().vec(), checksum, transformed});
+        return transformed;
+    }
+
+private:
+    struct Entry {
+        const void* data;
+        int64_t tile;
+        std::vector<int64_t> sizes;
+        uint64_t checksum;
+        at::Tensor transformed;
+    };
+
+    std::mutex mutex_;
+    // most recently used first
+    std::list<Entry> entries_;
+    size_t bytes_ = 0;
+};
+
+// the bias add is part of the output transform
+at::Tensor winograd(const ConvProblem& p, int64_t tile) {
+    auto input = p.input.contiguous();
+    auto filter = WinogradFilterCache::instance().get(p.weight, tile);
+    auto bias = p.bias.defined() ? p.bias.contiguous() : at::Tensor();
+    auto out = at::empty(outputSizes(p), input.options());
+    winogradConvolution(tile,
+                        input.data_ptr<float>(),
+                        filter.data_ptr<float>(),
+                        bias.defined() ? bias.data_ptr<float>() : nullptr,
+                        out.data_ptr<float>(),
+                        input.size(0),
+                        input.size(1),
+                        input.size(2),
+                        input.size(3),
+                        p.weight.size(0),
+                        p.groups,
+                        p.padding[0],
+                        p.padding[1]);
+    return out;
+}
+
+at::Tensor run(ConvAlgorithm algorithm, const ConvProblem& p) {
+    switch (algorithm) {
+        case ConvAlgorithm::Im2colGemm:
+            return im2colGemm(p);
+        case ConvAlgorithm::PointwiseGemm:
+            return pointwiseGemm(p);
+        case ConvAlgorithm::WinogradF2x3:
+            return winograd(p, 2);
+        case ConvAlgorithm::WinogradF4x3:
+            return winograd(p, 4);
+        case ConvAlgorithm::Aten:
+        default:
+            return at::convolution(p.input, p.weight, p.bias, p.stride, p.padding, p.dilation, false, at::IntArrayRef(0), p.groups);
+    }
+}
+
+double timeAlgorithm(ConvAlgorithm algorithm, const ConvProblem& p) {
+    try {
+        run(algorithm, p);
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < kTuningRuns; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            run(algorithm, p);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    } catch (const c10::Error&) {
+        // a candidate ATen rejects for this problem just drops out of the race
+        return std::numeric_limits<double>::infinity();
+    }
+}
+
+/**
+ * Tuning decisions by key. The file is line based, "<key> <algorithm name>", and only ever appended to, so a later line
+ * for the same key wins and several processes sharing the file at worst tune a key twice.
+ */
+class ConvTuningCache {
+public:
+    static ConvTuningCache& instance() {
+        static ConvTuningCache cache;
+        return cache;
+    }
+
+    bool find(const std::string& key, ConvAlgorithm* algorithm) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return false;
+        *algorithm = it->second;
+        return true;
+    }
+
+    void insert(const std::string& key, ConvAlgorithm algorithm) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        entries_[key] = algorithm;
+        if (path_.empty()) return;
+        std::ofstream file(path_, std::ios::app);
+        for (const auto& entry : kConvAlgorithms) {
+            if (entry.algorithm == algorithm) file << key << ' ' << entry.name << '\n';
+        }
+    }
+
+private:
+    ConvTuningCache() {
+        const char* env = std::getenv("DIOPI_TORCH_CONV_TUNING_CACHE");
+        if (env == nullptr) return;
+        path_ = env;
+        std::ifstream file(path_);
+        std::string key, name;
+        while (file >> key >> name) {
+            for (const auto& entry : kConvAlgorithms) {
+                if (name == entry.name) entries_[key] = entry.algorithm;
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, ConvAlgorithm> entries_;
+    std::string path_;
+};
+
+}  // namespace
+
+at::Tensor convolution(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride,
+        at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups) {
+    const int64_t spatialDims = input.dim() - 2;
+    auto expandable = [spatialDims](at::IntArrayRef values) { return values.size() == 1 || static_cast<int64_t>(values.size()) == spatialDims; };
+    if (spatialDims < 1 || !expandable(stride) || !expandable(padding) || !expandable(dilation)) {
+        // ATen reports the malformed arguments
+        return at::convolution(input, weight, bias, stride, padding, dilation, false, at::IntArrayRef(0), groups);
+    }
+    // the algorithms and the tuning key see one value per spatial dim
+    const std::vector<int64_t> strides = expandParam(stride, spatialDims);
+    const std::vector<int64_t> paddings = expandParam(padding, spatialDims);
+    const std::vector<int64_t> dilations = expandParam(dilation, spatialDims);
+    const ConvProblem problem{input, weight, bias, strides, paddings, dilations, groups};
+    checkShapeForward(problem);
+    const std::string key = convKey(problem);
+    auto& cache = ConvTuningCache::instance();
+    ConvAlgorithm algorithm = ConvAlgorithm::Aten;
+    // a cache file is plain text and may be edited by hand, so a cached choice is still checked against the problem
+    if (cache.find(key, &algorithm) && supports(algorithm, problem)) {
+        return run(algorithm, problem);
+    }
+    double best = std::numeric_limits<double>::infinity();
+    algorithm = ConvAlgorithm::Aten;
+    for (const auto& entry : kConvAlgorithms) {
+        if (!supports(entry.algorithm, problem)) continue;
+        const double seconds = timeAlgorithm(entry.algorithm, problem);
+        if (seconds < best) {
+            best = seconds;
+            algorithm = entry.algorithm;
+        }
+    }
+    // with every candidate rejected there is nothing to remember; ATen reports the error
+    if (std::isfinite(best)) cache.insert(key, algorithm);
+    return run(algorithm, problem);
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
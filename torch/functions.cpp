@@ -21,6 +21,8 @@
 static thread_local diopiContextHandle_t context = nullptr;
 #include "helper.hpp"
 #include "vision_kernel.h"
+#include "host_kernel.h"
+#include "functions_ext.h"
 
 extern "C" {
 
@@ -98,8 +100,13 @@ diopiError_t diopiMaxPool2d(diopiContextHandle_t ctx, diopiTensorHandle_t out,
     at::IntArrayRef atPadding = impl::aten::buildAtIntArray(padding);
     at::IntArrayRef atDilation = impl::aten::buildAtIntArray(dilation);
     bool atCeilMode = ceil_mode;
-    impl::aten::invokeATenFuncRet(ctx, at::max_pool2d, out,
-        atInput, atKernelSize, atStride, atPadding, atDilation, atCeilMode);
+    if (impl::aten::host::hostPoolSupported(atInput) && atInput.is_contiguous(at::MemoryFormat::ChannelsLast)) {
+        auto atOuts = impl::aten::host::maxPool2dNhwc(atInput, atKernelSize, atStride, atPadding, atDilation, atCeilMode, false, at::kLong);
+        impl::aten::updateATen2Tensor(ctx, std::get<0>(atOuts), out);
+    } else {
+        impl::aten::invokeATenFuncRet(ctx, at::max_pool2d, out,
+            atInput, atKernelSize, atStride, atPadding, atDilation, atCeilMode);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -116,7 +123,19 @@ diopiError_t diopiMaxPool2dWithIndices(diopiContextHandle_t ctx, diopiTensorHand
     at::Tensor atOut = impl::aten::buildATen(out);
     at::Tensor atIndices = impl::aten::buildATen(indices);
     bool atCeilMode = ceil_mode;
-    at::max_pool2d_with_indices_out(atOut, atIndices, atInput, atKernelSize, atStride, atPadding, atDilation, atCeilMode);
+    // int8 indices ask for the window-local form, which only the host kernel writes
+    const bool localIndices = atIndices.scalar_type() == at::kChar;
+    if (localIndices) {
+        DIOPI_CHECK(impl::aten::host::hostPoolSupported(atInput), "int8 pooling indices need a 4-D fp32 or fp64 host input");
+        DIOPI_CHECK(impl::aten::host::poolWindowTaps(atKernelSize) <= 128, "int8 pooling indices need at most 128 taps per window");
+    }
+    if (localIndices || (impl::aten::host::hostPoolSupported(atInput) && atInput.is_contiguous(at::MemoryFormat::ChannelsLast))) {
+        auto atOuts = impl::aten::host::maxPool2dNhwc(atInput, atKernelSize, atStride, atPadding, atDilation, atCeilMode, true, atIndices.scalar_type());
+        diopi_tensor_list vecOut = {out, indices};
+        impl::aten::updateATen2Tensor(ctx, atOuts, vecOut);
+    } else {
+        at::max_pool2d_with_indices_out(atOut, atIndices, atInput, atKernelSize, atStride, atPadding, atDilation, atCeilMode);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -193,8 +212,13 @@ diopiError_t diopiConvolution2d(diopiContextHandle_t ctx, diopiTensorHandle_t ou
     auto atStride = impl::aten::buildAtIntArray(stride);
     auto atPadding = impl::aten::buildAtIntArray(padding);
     auto atDilation = impl::aten::buildAtIntArray(dilation);
-    impl::aten::invokeATenFuncRet(ctx, at::convolution, out,
-        atInput, atWeight, atBias, atStride, atPadding, atDilation, false, at::IntArrayRef(0), groups);
+    if (atInput.is_cpu()) {
+        auto atOut = impl::aten::host::convolution(atInput, atWeight, atBias, atStride, atPadding, atDilation, groups);
+        impl::aten::updateATen2Tensor(ctx, atOut, out);
+    } else {
+        impl::aten::invokeATenFuncRet(ctx, at::convolution, out,
+            atInput, atWeight, atBias, atStride, atPadding, atDilation, false, at::IntArrayRef(0), groups);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -232,7 +256,11 @@ diopiError_t diopiBmm(diopiContextHandle_t ctx, diopiTensorHandle_t out,
     auto atInput = impl::aten::buildATen(input);
     auto atMat2 = impl::aten::buildATen(mat2);
     auto atOut = impl::aten::buildATen(out);
-    at::bmm_out(atOut, atInput, atMat2);
+    if (impl::aten::host::smallBmmSupported(atOut, at::Tensor(), atInput, atMat2)) {
+        impl::aten::host::bmm(atOut, atInput, atMat2);
+    } else {
+        at::bmm_out(atOut, atInput, atMat2);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -244,7 +272,11 @@ diopiError_t diopiBaddbmm(diopiContextHandle_t ctx, diopiTensorHandle_t out, dio
     auto atOut = impl::aten::buildATen(out);
     auto atBatch1 = impl::aten::buildATen(batch1);
     auto atBatch2 = impl::aten::buildATen(batch2);
-    at::baddbmm_out(atOut, atInput, atBatch1, atBatch2, beta, alpha);
+    if (impl::aten::host::smallBmmSupported(atOut, atInput, atBatch1, atBatch2)) {
+        impl::aten::host::baddbmm(atOut, atInput, atBatch1, atBatch2, beta, alpha);
+    } else {
+        at::baddbmm_out(atOut, atInput, atBatch1, atBatch2, beta, alpha);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -255,7 +287,11 @@ diopiError_t diopiBaddbmmInp(diopiContextHandle_t ctx, diopiTensorHandle_t input
     auto atInput = impl::aten::buildATen(input);
     auto atBatch1 = impl::aten::buildATen(batch1);
     auto atBatch2 = impl::aten::buildATen(batch2);
-    atInput.baddbmm_(atBatch1, atBatch2, beta, alpha);
+    if (impl::aten::host::smallBmmSupported(atInput, atInput, atBatch1, atBatch2)) {
+        impl::aten::host::baddbmm(atInput, atInput, atBatch1, atBatch2, beta, alpha);
+    } else {
+        atInput.baddbmm_(atBatch1, atBatch2, beta, alpha);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -289,9 +325,14 @@ diopiError_t diopiMatmul(diopiContextHandle_t ctx, diopiTensorHandle_t out,
     impl::aten::setCurCtx(ctx);
     auto atInput = impl::aten::buildATen(input);
     auto atOther = impl::aten::buildATen(other);
-    // Note(huqingqing): pytorch optimize the bmm case by folding the batch into the first dimension.
-    // It changes the shape of output and causes warnning when using matmul_out.
-    impl::aten::invokeATenFuncRet(ctx, at::matmul, out, atInput, atOther);
+    auto atOut = impl::aten::buildATen(out);
+    if (impl::aten::host::broadcastMatmulSupported(atOut, atInput, atOther)) {
+        impl::aten::host::broadcastMatmul(atOut, atInput, atOther);
+    } else {
+        // Note(huqingqing): pytorch optimize the bmm case by folding the batch into the first dimension.
+        // It changes the shape of output and causes warnning when using matmul_out.
+        impl::aten::invokeATenFuncRet(ctx, at::matmul, out, atInput, atOther);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -332,7 +373,11 @@ diopiError_t diopiAddmm(diopiContextHandle_t ctx, diopiTensorHandle_t out,
     auto atBeta = impl::aten::buildAtScalar(beta);
     auto atAlpha = impl::aten::buildAtScalar(alpha);
     auto atOut = impl::aten::buildATen(out);
-    at::addmm_out(atOut, atInput, atMax1, atMax2, atBeta, atAlpha);
+    if (impl::aten::host::packedAddmmSupported(atOut, atInput, atMax1, atMax2)) {
+        impl::aten::host::addmm(atOut, atInput, atMax1, atMax2, atBeta.toDouble(), atAlpha.toDouble());
+    } else {
+        at::addmm_out(atOut, atInput, atMax1, atMax2, atBeta, atAlpha);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -548,7 +593,12 @@ diopiError_t diopiLinear(diopiContextHandle_t ctx, diopiTensorHandle_t out, diop
     auto atInput = impl::aten::buildATen(input);
     auto atWeight = impl::aten::buildATen(weight);
     auto atBias = impl::aten::buildATen(bias);
-    impl::aten::invokeATenFuncRet(ctx, at::linear, out, atInput, atWeight, atBias);
+    auto atOut = impl::aten::buildATen(out);
+    if (impl::aten::host::packedLinearSupported(atOut, atInput, atWeight, atBias)) {
+        impl::aten::host::linear(atOut, atInput, atWeight, atBias, impl::aten::host::GemmActivation::None);
+    } else {
+        impl::aten::invokeATenFuncRet(ctx, at::linear, out, atInput, atWeight, atBias);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -1833,8 +1883,15 @@ diopiError_t diopiAvgPool2d(diopiContextHandle_t ctx, diopiTensorHandle_t out, d
     at::IntArrayRef atPadding = impl::aten::buildAtIntArray(padding);
     c10::optional<int64_t> atDivisorOverride = divisor_override ? c10::optional<int64_t>(*divisor_override) : c10::nullopt;
     at::Tensor atOut = impl::aten::buildATen(out);
-    at::avg_pool2d_out(atOut, atInput, atKernelSize, atStride, atPadding,
-                       ceil_mode, count_include_pad, atDivisorOverride);
+    if (impl::aten::host::hostPoolSupported(atInput) && atInput.is_contiguous(at::MemoryFormat::ChannelsLast)) {
+        auto atResult = impl::aten::host::avgPool2dNhwc(atInput, atKernelSize, atStride, atPadding, ceil_mode, count_include_pad, atDivisorOverride);
+        atOut.copy_(atResult);
+    } else if (impl::aten::host::separableAvgPoolSupported(atInput, 2, atKernelSize)) {
+        atOut.copy_(impl::aten::host::avgPoolSeparable(atInput, 2, atKernelSize, atStride, atPadding, ceil_mode, count_include_pad, atDivisorOverride));
+    } else {
+        at::avg_pool2d_out(atOut, atInput, atKernelSize, atStride, atPadding,
+                           ceil_mode, count_include_pad, atDivisorOverride);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -2286,8 +2343,16 @@ diopiError_t diopiAvgPool2dBackward(diopiContextHandle_t ctx, diopiTensorHandle_
     at::IntArrayRef atPadding = impl::aten::buildAtIntArray(padding);
     c10::optional<int64_t> atDivisorOverride = divisor_override ? c10::optional<int64_t>(*divisor_override) : c10::nullopt;
     auto atGradInput = impl::aten::buildATen(grad_input);
-    at::avg_pool2d_backward_out(atGradInput, atGradOutput, atInput, atKernelSize, atStride, atPadding,
-                                ceil_mode, count_include_pad, atDivisorOverride);
+    if (impl::aten::host::hostPoolSupported(atInput) && atInput.is_contiguous(at::MemoryFormat::ChannelsLast)) {
+        atGradInput.copy_(impl::aten::host::avgPool2dBackwardNhwc(atGradOutput, atInput, atKernelSize, atStride, atPadding, ceil_mode,
+            count_include_pad, atDivisorOverride));
+    } else if (impl::aten::host::separableAvgPoolSupported(atInput, 2, atKernelSize)) {
+        atGradInput.copy_(impl::aten::host::avgPoolSeparableBackward(atGradOutput, atInput, 2, atKernelSize, atStride, atPadding, ceil_mode,
+            count_include_pad, atDivisorOverride));
+    } else {
+        at::avg_pool2d_backward_out(atGradInput, atGradOutput, atInput, atKernelSize, atStride, atPadding,
+                                    ceil_mode, count_include_pad, atDivisorOverride);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -2425,8 +2490,17 @@ diopiError_t diopiMaxPool2dBackward(diopiContextHandle_t ctx, diopiTensorHandle_
     at::IntArrayRef atDilation = impl::aten::buildAtIntArray(dilation);
     auto atIndices = impl::aten::buildATen(indices);
     auto atGradInput = impl::aten::buildATen(grad_input);
-    at::max_pool2d_with_indices_backward_out(atGradInput, atGradOutput, atInput, atKernelSize,
-                                             atStride, atPadding, atDilation, ceil_mode, atIndices);
+    if (atIndices.scalar_type() == at::kChar) {
+        DIOPI_CHECK(impl::aten::host::hostPoolSupported(atInput), "int8 pooling indices need a 4-D fp32 or fp64 host input");
+    }
+    if (atIndices.scalar_type() == at::kChar ||
+            (impl::aten::host::hostPoolSupported(atInput) && atInput.is_contiguous(at::MemoryFormat::ChannelsLast))) {
+        atGradInput.copy_(impl::aten::host::maxPool2dBackwardNhwc(atGradOutput, atInput, atKernelSize, atStride, atPadding, atDilation,
+            ceil_mode, atIndices));
+    } else {
+        at::max_pool2d_with_indices_backward_out(atGradInput, atGradOutput, atInput, atKernelSize,
+                                                 atStride, atPadding, atDilation, ceil_mode, atIndices);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -2930,7 +3004,11 @@ diopiError_t diopiMm(diopiContextHandle_t ctx, diopiTensorHandle_t out,
     auto atInput = impl::aten::buildATen(input);
     auto atMat2 = impl::aten::buildATen(mat2);
     auto atOut = impl::aten::buildATen(out);
-    at::mm_out(atOut, atInput, atMat2);
+    if (impl::aten::host::packedGemmSupported(atOut, atInput, atMat2)) {
+        impl::aten::host::mm(atOut, atInput, atMat2);
+    } else {
+        at::mm_out(atOut, atInput, atMat2);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -2945,8 +3023,13 @@ diopiError_t diopiConvolution3d(diopiContextHandle_t ctx, diopiTensorHandle_t ou
     auto atStride = impl::aten::buildAtIntArray(stride);
     auto atPadding = impl::aten::buildAtIntArray(padding);
     auto atDilation = impl::aten::buildAtIntArray(dilation);
-    impl::aten::invokeATenFuncRet(ctx, at::convolution, out,
-        atInput, atWeight, atBias, atStride, atPadding, atDilation, false, at::IntArrayRef(0), groups);
+    if (atInput.is_cpu()) {
+        auto atOut = impl::aten::host::convolution(atInput, atWeight, atBias, atStride, atPadding, atDilation, groups);
+        impl::aten::updateATen2Tensor(ctx, atOut, out);
+    } else {
+        impl::aten::invokeATenFuncRet(ctx, at::convolution, out,
+            atInput, atWeight, atBias, atStride, atPadding, atDilation, false, at::IntArrayRef(0), groups);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -3006,7 +3089,8 @@ diopiError_t diopiUnfold(diopiContextHandle_t ctx, diopiTensorHandle_t out, diop
     impl::aten::setCurCtx(ctx);
     auto atInput = impl::aten::buildATen(input);
     // must use contiguous rather than clone in this case
-    auto atOut = at::native::unfold(atInput, dim, size, step).contiguous();
+    auto atOut = impl::aten::host::im2colSupported(atInput) && atInput.dim() > 0 ? impl::aten::host::unfold(atInput, dim, size, step)
+                                                                                 : at::native::unfold(atInput, dim, size, step).contiguous();
     impl::aten::updateATen2Tensor(ctx, atOut, out);
     impl::aten::unsetCurCtx();
     return diopiSuccess;
@@ -3017,7 +3101,12 @@ diopiError_t diopiUnfoldBackward(diopiContextHandle_t ctx, diopiTensorHandle_t g
     impl::aten::setCurCtx(ctx);
     auto atGrad = impl::aten::buildATen(grad_output);
     auto atInputSize = impl::aten::buildAtIntArray(input_sizes);
-    impl::aten::invokeATenFuncRet(ctx, at::unfold_backward, grad_input, atGrad, atInputSize, dim, size, step);
+    if (impl::aten::host::im2colSupported(atGrad) && atInputSize.size() > 0) {
+        auto atGradInput = impl::aten::host::unfoldBackward(atGrad, atInputSize, dim, size, step);
+        impl::aten::updateATen2Tensor(ctx, atGradInput, grad_input);
+    } else {
+        impl::aten::invokeATenFuncRet(ctx, at::unfold_backward, grad_input, atGrad, atInputSize, dim, size, step);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -3257,7 +3346,11 @@ diopiError_t diopiAdaptiveAvgPool3d(diopiContextHandle_t ctx, diopiTensorHandle_
     at::Tensor atInput = impl::aten::buildATen(input);
     auto atOutSize = impl::aten::buildAtIntArray(output_size);
     auto atOut = impl::aten::buildATen(out);
-    at::adaptive_avg_pool3d_out(atOut, atInput, atOutSize);
+    if (impl::aten::host::separableAvgPoolSupported(atInput, 3, at::IntArrayRef())) {
+        atOut.copy_(impl::aten::host::adaptiveAvgPoolSeparable(atInput, 3, atOutSize));
+    } else {
+        at::adaptive_avg_pool3d_out(atOut, atInput, atOutSize);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -3268,7 +3361,11 @@ diopiError_t diopiAdaptiveAvgPool3dBackward(diopiContextHandle_t ctx, diopiTenso
     auto atGradOutput  = impl::aten::buildATen(grad_output);
     auto atInput = impl::aten::buildATen(input);
     auto atGradInput = impl::aten::buildATen(grad_input);
-    at::adaptive_avg_pool3d_backward_out(atGradInput, atGradOutput, atInput);
+    if (impl::aten::host::separableAvgPoolSupported(atInput, 3, at::IntArrayRef())) {
+        atGradInput.copy_(impl::aten::host::adaptiveAvgPoolSeparableBackward(atGradOutput, atInput, 3));
+    } else {
+        at::adaptive_avg_pool3d_backward_out(atGradInput, atGradOutput, atInput);
+    }
     impl::aten::unsetCurCtx();
     return diopiSuccess;
 }
@@ -3616,7 +3713,9 @@ diopiError_t diopiUpsampleNearest(diopiContextHandle_t ctx, diopiTensorHandle_t
     at::Tensor atInput = impl::aten::buildATen(input);
     at::Tensor atOut = impl::aten::buildATen(out);
     at::IntArrayRef atSize = impl::aten::buildAtIntArray(size);
-    if (atInput.dim() == 3) {
+    if (impl::aten::host::upsampleSupported(atInput) && static_cast<int64_t>(atSize.size()) + 2 == atInput.dim()) {
+        atOut.copy_(impl::aten::host::upsample(atInput, atSize, impl::aten::host::UpsampleMode::Nearest, false));
+    } else if (atInput.dim() == 3) {
         at::upsample_nearest1d_out(atOut, atInput, atSize);
     } else if (atInput.dim() == 4) {
         at::upsample_nearest2d_out(atOut, atInput, atSize);
@@ -3637,7 +3736,9 @@ diopiError_t diopiUpsampleNearestBackward(diopiContextHandle_t ctx, diopiTensorH
     at::Tensor atGradInput = impl::aten::buildATen(grad_input);
     at::IntArrayRef atOutSize = impl::aten::buildAtIntArray(out_size);
     at::IntArrayRef atInSize = impl::aten::buildAtIntArray(in_size);
-    if (atGradInput.dim() == 3) {
+    if (impl::aten::host::upsampleSupported(atGradOut) && atGradInput.dim() == atGradOut.dim()) {
+        atGradInput.copy_(impl::aten::host::upsampleBackward(atGradOut, atGradInput.sizes(), impl::aten::host::UpsampleMode::Nearest, false));
+    } else if (atGradInput.dim() == 3) {
         at::upsample_nearest1d_backward_out(atGradInput, atGradOut, atOutSize, atInSize);
     } else if (atGradInput.dim() == 4) {
         at::upsample_nearest2d_backward_out(atGradInput, atGradOut, atOutSize, atInSize);
@@ -3667,13 +3768,19 @@ diopiError_t diopiUpsampleNearestExact(diopiContextHandle_t ctx, diopiTensorHand
     return diopiSuccess;
 }
 
+// the linear mode that matches an input of 3, 4 or 5 dimensions
+static const char* const kLinearModes[] = {"linear", "bilinear", "trilinear"};
+
 diopiError_t diopiUpsampleLinear(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiConstTensorHandle_t input, diopiSize_t size,
         bool align_corners, const char* mode) {
     impl::aten::setCurCtx(ctx);
     at::Tensor atInput = impl::aten::buildATen(input);
     at::Tensor atOut = impl::aten::buildATen(out);
     at::IntArrayRef atSize = impl::aten::buildAtIntArray(size);
-    if ( 3 == atInput.dim() && 0 == strcmp(mode, "linear") ) {
+    if (impl::aten::host::upsampleSupported(atInput) && static_cast<int64_t>(atSize.size()) + 2 == atInput.dim() &&
+        0 == strcmp(mode, kLinearModes[atInput.dim() - 3])) {
+        atOut.copy_(impl::aten::host::upsample(atInput, atSize, impl::aten::host::UpsampleMode::Linear, align_corners));
+    } else if ( 3 == atInput.dim() && 0 == strcmp(mode, "linear") ) {
         at::upsample_linear1d_out(atOut, atInput, atSize, align_corners);
     } else if ( 4 == atInput.dim() ) {
         if (0 == strcmp(mode, "bilinear")) {
@@ -3701,7 +3808,9 @@ diopiError_t diopiUpsampleLinearBackward(diopiContextHandle_t ctx,  diopiTensorH
     at::Tensor atGradInput = impl::aten::buildATen(grad_input);
     at::IntArrayRef atOutSize = impl::aten::buildAtIntArray(out_size);
     at::IntArrayRef atInSize = impl::aten::buildAtIntArray(in_size);
-    if ( 3 == atGradInput.dim() && 0 == strcmp(mode, "linear") ) {
+    if (impl::aten::host::upsampleSupported(atGradOut) && atGradInput.dim() == atGradOut.dim() && 0 == strcmp(mode, kLinearModes[atGradOut.dim() - 3])) {
+        atGradInput.copy_(impl::aten::host::upsampleBackward(atGradOut, atGradInput.sizes(), impl::aten::host::UpsampleMode::Linear, align_corners));
+    } else if ( 3 == atGradInput.dim() && 0 == strcmp(mode, "linear") ) {
         at::upsample_linear1d_backward_out(atGradInput, atGradOut, atOutSize, atInSize, align_corners);
     } else if ( 4 == atGradInput.dim() ) {
         if (0 == strcmp(mode, "bilinear")) {
@@ -3800,7 +3909,7 @@ diopiError_t diopiLinearBackward(diopiContextHandle_t ctx, diopiTensorHandle_t g
     auto atGradOutput = impl::aten::buildATen(grad_output);
     auto atInput = impl::aten::buildATen(input);
     auto atWeight = impl::aten::buildATen(weight);
-    auto atGradInput = at::matmul(atGradOutput, atWeight);
+    auto atGradInput = atGradOutput.is_cpu() ? impl::aten::host::linearBackwardInput(atGradOutput, atWeight) : at::matmul(atGradOutput, atWeight);
     impl::aten::updateATen2Tensor(ctx, atGradInput, grad_input);
 
     int64_t dims = atInput.dim();
@@ -3888,7 +3997,11 @@ diopiError_t diopiIm2Col(diopiContextHandle_t ctx, diopiTensorHandle_t out, diop
     at::IntArrayRef atPadding = impl::aten::buildAtIntArray(padding);
     at::IntArrayRef atStride = impl::aten::buildAtIntArray(stride);
 
-    at::im2col_out(atOut, atInput, atKernelSize, atDilation, atPadding, atStride);
+    if (impl::aten::host::im2colSupported(atInput) && (atInput.dim() == 3 || atInput.dim() == 4)) {
+        atOut.copy_(impl::aten::host::im2col(atInput, atKernelSize, atDilation, atPadding, atStride));
+    } else {
+        at::im2col_out(atOut, atInput, atKernelSize, atDilation, atPadding, atStride);
+    }
 
     impl::aten::unsetCurCtx();
     return diopiSuccess;
@@ -3905,7 +4018,11 @@ diopiError_t diopiCol2Im(diopiContextHandle_t ctx, diopiTensorHandle_t out, diop
     at::IntArrayRef atPadding = impl::aten::buildAtIntArray(padding);
     at::IntArrayRef atStride = impl::aten::buildAtIntArray(stride);
 
-    at::col2im_out(atOut, atInput, atOutSize, atKernelSize, atDilation, atPadding, atStride);
+    if (impl::aten::host::im2colSupported(atInput) && (atInput.dim() == 2 || atInput.dim() == 3)) {
+        atOut.copy_(impl::aten::host::col2im(atInput, atOutSize, atKernelSize, atDilation, atPadding, atStride));
+    } else {
+        at::col2im_out(atOut, atInput, atOutSize, atKernelSize, atDilation, atPadding, atStride);
+    }
 
     impl::aten::unsetCurCtx();
     return diopiSuccess;
@@ -4053,4 +4170,39 @@ diopiError_t diopiCastDtype(diopiContextHandle_t ctx, diopiTensorHandle_t out, d
     return diopiSuccess;
 }
 
+diopiError_t diopiScaledDotProductAttention(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiTensorHandle_t softmax_lse,
+        diopiConstTensorHandle_t query, diopiConstTensorHandle_t key, diopiConstTensorHandle_t value,
+        diopiConstTensorHandle_t attn_mask, double scale, bool is_causal) {
+    impl::aten::setCurCtx(ctx);
+    DIOPI_CHECK_PTR(softmax_lse);
+    auto atQuery = impl::aten::buildATen(query);
+    auto atKey = impl::aten::buildATen(key);
+    auto atValue = impl::aten::buildATen(value);
+    auto atMask = impl::aten::buildATen(attn_mask);
+    auto atOuts = impl::aten::host::scaledDotProductAttention(atQuery, atKey, atValue, atMask, scale, is_causal);
+    diopi_tensor_list vecOut = {out, softmax_lse};
+    impl::aten::updateATen2Tensor(ctx, atOuts, vecOut);
+    impl::aten::unsetCurCtx();
+    return diopiSuccess;
+}
+
+diopiError_t diopiScaledDotProductAttentionBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_query, diopiTensorHandle_t grad_key,
+        diopiTensorHandle_t grad_value, diopiConstTensorHandle_t grad_output, diopiConstTensorHandle_t query,
+        diopiConstTensorHandle_t key, diopiConstTensorHandle_t value, diopiConstTensorHandle_t out,
+        diopiConstTensorHandle_t softmax_lse, diopiConstTensorHandle_t attn_mask, double scale, bool is_causal) {
+    impl::aten::setCurCtx(ctx);
+    auto atGradOutput = impl::aten::buildATen(grad_output);
+    auto atQuery = impl::aten::buildATen(query);
+    auto atKey = impl::aten::buildATen(key);
+    auto atValue = impl::aten::buildATen(value);
+    auto atOut = impl::aten::buildATen(out);
+    auto atLse = impl::aten::buildATen(softmax_lse);
+    auto atMask = impl::aten::buildATen(attn_mask);
+    auto atGrads = impl::aten::host::scaledDotProductAttentionBackward(atGradOutput, atQuery, atKey, atValue, atOut, atLse, atMask, scale, is_causal);
+    diopi_tensor_list vecOut = {grad_query, grad_key, grad_value};
+    impl::aten::updateATen2Tensor(ctx, atGrads, vecOut);
+    impl::aten::unsetCurCtx();
+    return diopiSuccess;
+}
+
 }  // extern "C"
@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#ifndef IMPL_TORCH_FUNCTIONS_EXT_H_
+#define IMPL_TORCH_FUNCTIONS_EXT_H_
+
+#include <diopi/diopirt.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Scaled dot product attention, out = softmax(query x key^T * scale + attn_mask) x value, fused so that the
+ * (B, H, Lq, Lk) score matrix is never materialized.
+ * @param[in] query, key, value (B, H, Lq, D), (B, H, Lk, D) and (B, H, Lk, Dv).
+ * @param[in] attn_mask additive mask broadcastable to (B, H, Lq, Lk), may be nullptr.
+ * @param[in] is_causal hide key j from query i for j > i.
+ * @param[out] out (B, H, Lq, Dv).
+ * @param[out] softmax_lse (B, H, Lq), logsumexp of every score row, kept for the backward.
+ */
+DIOPI_API diopiError_t diopiScaledDotProductAttention(diopiContextHandle_t ctx, diopiTensorHandle_t out, diopiTensorHandle_t softmax_lse,
+                                                      diopiConstTensorHandle_t query, diopiConstTensorHandle_t key, diopiConstTensorHandle_t value,
+                                                      diopiConstTensorHandle_t attn_mask, double scale, bool is_causal);
+
+/**
+ * @brief Backward of diopiScaledDotProductAttention. The attention probabilities are recomputed from softmax_lse
+ * rather than stored by the forward.
+ */
+DIOPI_API diopiError_t diopiScaledDotProductAttentionBackward(diopiContextHandle_t ctx, diopiTensorHandle_t grad_query, diopiTensorHandle_t grad_key,
+                                                              diopiTensorHandle_t grad_value, diopiConstTensorHandle_t grad_output,
+                                                              diopiConstTensorHandle_t query, diopiConstTensorHandle_t key, diopiConstTensorHandle_t value,
+                                                              diopiConstTensorHandle_t out, diopiConstTensorHandle_t softmax_lse,
+                                                              diopiConstTensorHandle_t attn_mask, double scale, bool is_causal);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  // IMPL_TORCH_FUNCTIONS_EXT_H_
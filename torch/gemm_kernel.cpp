@@ -0,0 +1,695 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/ExpandUtils.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// columns of a packed panel, the width of the micro-kernel
+constexpr int64_t kGemmPanel = 16;
+// rows of the micro-kernel
+constexpr int64_t kGemmRows = 4;
+// depth of a k block; a panel slice of kGemmDepth x kGemmPanel floats stays in L1 across a row block
+constexpr int64_t kGemmDepth = 256;
+// rows a task walks per panel group, and panels per group
+constexpr int64_t kGemmRowBlock = 64;
+constexpr int64_t kGemmPanelGroup = 4;
+// bytes of packed linear weights a process keeps, enough for every linear layer of a BERT-base
+constexpr size_t kMaxPackedBytes = size_t(512) << 20;
+// bytes a task of contentChecksum hashes; the blocks are fixed so the checksum does not depend on the thread count
+constexpr int64_t kChecksumBlock = 1 << 18;
+// largest M * N * K and largest single extent a batched product takes the small matrix path for
+constexpr int64_t kSmallGemmWork = 128 * 128 * 128;
+constexpr int64_t kSmallGemmExtent = 512;
+// multiply-adds a task of the batched path gets at least
+constexpr int64_t kSmallGemmGrain = 1 << 16;
+
+struct GemmEpilogue {
+    float alpha;
+    float beta;
+    const float* bias;    // per column, may be null
+    const float* addend;  // (M, N) with row stride ldAddend, may be null
+    int64_t ldAddend;
+    GemmActivation activation;
+};
+
+// b (K, N) with element strides (sk, sn) into panels (N / kGemmPanel, K, kGemmPanel), the last panel zero padded
+void packPanels(const float* b, int64_t depth, int64_t cols, int64_t sk, int64_t sn, float* packed) {
+    const int64_t panels = (cols + kGemmPanel - 1) / kGemmPanel;
+    at::parallel_for(0, panels, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t j = begin; j < end; ++j) {
+            const int64_t width = std::min(kGemmPanel, cols - j * kGemmPanel);
+            float* panel = packed + j * depth * kGemmPanel;
+            for (int64_t k = 0; k < depth; ++k) {
+                const float* src = b + k * sk + j * kGemmPanel * sn;
+                float* dst = panel + k * kGemmPanel;
+                for (int64_t p = 0; p < width; ++p) dst[p] = src[p * sn];
+                for (int64_t p = width; p < kGemmPanel; ++p) dst[p] = 0.f;
+            }
+        }
+    });
+}
+
+// epilogue of rows x cols of c, in place
+void applyEpilogue(float* c, int64_t ldc, int64_t row0, int64_t col0, int64_t rows, int64_t cols, const GemmEpilogue& epilogue) {
+    for (int64_t r = 0; r < rows; ++r) {
+        float* out = c + r * ldc;
+        const float* bias = epilogue.bias != nullptr ? epilogue.bias + col0 : nullptr;
+        const float* addend = epilogue.addend != nullptr ? epilogue.addend + (row0 + r) * epilogue.ldAddend + col0 : nullptr;
+        for (int64_t p = 0; p < cols; ++p) {
+            float v = epilogue.alpha * out[p];
+            if (bias != nullptr) v += epilogue.beta * bias[p];
+            if (addend != nullptr) v += epilogue.beta * addend[p];
+            if (epilogue.activation == GemmActivation::Relu) v = std::max(v, 0.f);
+            out[p] = v;
+        }
+    }
+}
+
+/**
+ * Rows x kGemmPanel block of c over one k block. The accumulators start from zero on the first block and from c
+ * otherwise; the epilogue is applied on the last one. The rows are spelled out rather than looped over, and the
+ * accumulators are only ever indexed by constant-trip loops: either way round the compiler gives up on keeping them in
+ * registers. A partial panel goes through a stack tile so the loads and stores of full panels stay unconditional. A
+ * non-zero Depth fixes the depth at compile time for the small matrices of batched products.
+ */
+template <int64_t Rows, int64_t Depth>
+void gemmBlock(const float* a, int64_t lda, const float* panel, int64_t depth, float* c, int64_t ldc, int64_t row0, int64_t col0, int64_t cols, bool first,
+               const GemmEpilogue* epilogue) {
+    float tile[kGemmRows * kGemmPanel];
+    float* dst = c;
+    int64_t ldd = ldc;
+    if (cols < kGemmPanel) {
+        dst = tile;
+        ldd = kGemmPanel;
+        for (int64_t r = 0; r < Rows; ++r) {
+            std::fill(tile + r * kGemmPanel, tile + (r + 1) * kGemmPanel, 0.f);
+            if (!first) std::copy(c + r * ldc, c + r * ldc + cols, tile + r * kGemmPanel);
+        }
+    }
+    const float* a0 = a;
+    const float* a1 = a + (Rows > 1 ? lda : 0);
+    const float* a2 = a + (Rows > 2 ? 2 * lda : 0);
+    const float* a3 = a + (Rows > 3 ? 3 * lda : 0);
+    float c0[kGemmPanel], c1[kGemmPanel], c2[kGemmPanel], c3[kGemmPanel];
+    const bool load = !first || dst == tile;
+    for (int64_t p = 0; p < kGemmPanel; ++p) {
+        c0[p] = load ? dst[p] : 0.f;
+        c1[p] = load && Rows > 1 ? dst[ldd + p] : 0.f;
+        c2[p] = load && Rows > 2 ? dst[2 * ldd + p] : 0.f;
+        c3[p] = load && Rows > 3 ? dst[3 * ldd + p] : 0.f;
+    }
+    const int64_t kc = Depth > 0 ? Depth : depth;
+    for (int64_t k = 0; k < kc; ++k) {
+        const float* __restrict b = panel + k * kGemmPanel;
+        const float x0 = a0[k], x1 = a1[k], x2 = a2[k], x3 = a3[k];
+        for (int64_t p = 0; p < kGemmPanel; ++p) {
+            c0[p] += x0 * b[p];
+            if (Rows > 1) c1[p] += x1 * b[p];
+            if (Rows > 2) c2[p] += x2 * b[p];
+            if (Rows > 3) c3[p] += x3 * b[p];
+        }
+    }
+    for (int64_t p = 0; p < kGemmPanel; ++p) {
+        dst[p] = c0[p];
+        if (Rows > 1) dst[ldd + p] = c1[p];
+        if (Rows > 2) dst[2 * ldd + p] = c2[p];
+        if (Rows > 3) dst[3 * ldd + p] = c3[p];
+    }
+    if (dst == tile) {
+        for (int64_t r = 0; r < Rows; ++r) std::copy(tile + r * kGemmPanel, tile + r * kGemmPanel + cols, c + r * ldc);
+    }
+    if (epilogue != nullptr) applyEpilogue(c, ldc, row0, col0, Rows, cols, *epilogue);
+}
+
+using GemmBlockFn = void (*)(const float*, int64_t, const float*, int64_t, float*, int64_t, int64_t, int64_t, int64_t, bool, const GemmEpilogue*);
+
+template <int64_t Depth>
+struct GemmBlocks {
+    static constexpr GemmBlockFn fns[kGemmRows + 1] = {nullptr, gemmBlock<1, Depth>, gemmBlock<2, Depth>, gemmBlock<3, Depth>, gemmBlock<4, Depth>};
+};
+
+template <int64_t Depth>
+constexpr GemmBlockFn GemmBlocks<Depth>::fns[kGemmRows + 1];
+
+const GemmBlockFn* const kGemmBlocks = GemmBlocks<0>::fns;
+
+// block kernels by depth; the depths of per-head projections and attention get their own
+const GemmBlockFn* smallGemmBlocks(int64_t depth) {
+    switch (depth) {
+        case 16:
+            return GemmBlocks<16>::fns;
+        case 32:
+            return GemmBlocks<32>::fns;
+        case 64:
+            return GemmBlocks<64>::fns;
+        case 128:
+            return GemmBlocks<128>::fns;
+        default:
+            return GemmBlocks<0>::fns;
+    }
+}
+
+// c (M, N) = epilogue(a (M, K) x packed), a and c row major
+void gemmPacked(const float* a, int64_t lda, const float* packed, float* c, int64_t ldc, int64_t rows, int64_t depth, int64_t cols, const GemmEpilogue& epilogue) {
+    const int64_t panels = (cols + kGemmPanel - 1) / kGemmPanel;
+    const int64_t groups = (panels + kGemmPanelGroup - 1) / kGemmPanelGroup;
+    const int64_t rowBlocks = (rows + kGemmRowBlock - 1) / kGemmRowBlock;
+    at::parallel_for(0, rowBlocks * groups, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t m0 = task / groups * kGemmRowBlock;
+            const int64_t m1 = std::min(m0 + kGemmRowBlock, rows);
+            const int64_t j0 = task % groups * kGemmPanelGroup;
+            const int64_t j1 = std::min(j0 + kGemmPanelGroup, panels);
+            for (int64_t k0 = 0; k0 < depth; k0 += kGemmDepth) {
+                const int64_t kc = std::min(kGemmDepth, depth - k0);
+                const GemmEpilogue* last = k0 + kc == depth ? &epilogue : nullptr;
+                for (int64_t j = j0; j < j1; ++j) {
+                    const float* panel = packed + (j * depth + k0) * kGemmPanel;
+                    const int64_t width = std::min(kGemmPanel, cols - j * kGemmPanel);
+                    for (int64_t m = m0; m < m1; m += kGemmRows) {
+                        const int64_t height = std::min(kGemmRows, m1 - m);
+                        kGemmBlocks[height](a + m * lda + k0, lda, panel, kc, c + m * ldc + j * kGemmPanel, ldc, m, j * kGemmPanel, width, k0 == 0, last);
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * c (M, K) = g (M, N) x b^T for b (K, N) held as panels, i.e. the product with the transpose of the packed matrix. Each
+ * output is a dot product along the columns of a panel, accumulated lane-wise and reduced once at the end. Tasks own
+ * ranges of k, so the panel rows of a k pair are read once from memory and then from cache for every row block.
+ */
+void gemmPackedTransposed(const float* g, int64_t rows, const float* packed, int64_t depth, int64_t cols, float* c) {
+    const int64_t panels = (cols + kGemmPanel - 1) / kGemmPanel;
+    const int64_t padded = panels * kGemmPanel;
+    // g with rows padded to whole panels, so every panel reads full lanes
+    std::vector<float> gp(rows * padded, 0.f);
+    for (int64_t m = 0; m < rows; ++m) std::copy(g + m * cols, g + (m + 1) * cols, gp.data() + m * padded);
+    at::parallel_for(0, (depth + 1) / 2, 8, [&](int64_t begin, int64_t end) {
+        for (int64_t pair = begin; pair < end; ++pair) {
+            const int64_t k = pair * 2;
+            const bool two = k + 1 < depth;
+            for (int64_t m = 0; m < rows; ++m) {
+                const float* __restrict x = gp.data() + m * padded;
+                float s0[kGemmPanel] = {}, s1[kGemmPanel] = {};
+                for (int64_t j = 0; j < panels; ++j) {
+                    const float* __restrict b0 = packed + (j * depth + k) * kGemmPanel;
+                    const float* __restrict b1 = two ? b0 + kGemmPanel : b0;
+                    const float* __restrict xj = x + j * kGemmPanel;
+                    for (int64_t p = 0; p < kGemmPanel; ++p) {
+                        s0[p] += xj[p] * b0[p];
+                        s1[p] += xj[p] * b1[p];
+                    }
+                }
+                float sum0 = 0.f, sum1 = 0.f;
+                for (int64_t p = 0; p < kGemmPanel; ++p) {
+                    sum0 += s0[p];
+                    sum1 += s1[p];
+                }
+                c[m * depth + k] = sum0;
+                if (two) c[m * depth + k + 1] = sum1;
+            }
+        }
+    });
+}
+
+// matrix b of a batch at data + offsets[b], or data + b * sb without offsets; element (i, j) at i * sr + j * sc
+struct BatchedMatrix {
+    const float* data;
+    const int64_t* offsets;
+    int64_t sb;
+    int64_t sr;
+    int64_t sc;
+
+    const float* matrix(int64_t b) const { return data + (offsets != nullptr ? offsets[b] : b * sb); }
+};
+
+/**
+ * Batched products of small matrices, c[b] = beta * addend[b] + alpha * a[b] x b[b], any strides, a stride-0 batch
+ * dimension included. Tasks own whole matrices of the batch: a task packs a[b] into rows and b[b] into panels in its
+ * own buffers, runs the block kernels over a padded tile and writes the tile out through the epilogue. addend may have
+ * a null data pointer, and is not read when beta is 0.
+ */
+void gemmSmallBatched(const BatchedMatrix& a, const BatchedMatrix& b, const BatchedMatrix& addend, float* c, int64_t scb, int64_t scr, int64_t scc,
+                      int64_t batch, int64_t rows, int64_t depth, int64_t cols, float alpha, float beta) {
+    const int64_t panels = (cols + kGemmPanel - 1) / kGemmPanel;
+    const int64_t padded = panels * kGemmPanel;
+    const GemmBlockFn* blocks = smallGemmBlocks(depth);
+    const int64_t grain = std::max<int64_t>(1, kSmallGemmGrain / std::max<int64_t>(1, rows * depth * cols));
+    at::parallel_for(0, batch, grain, [&](int64_t begin, int64_t end) {
+        std::vector<float> rowsA(rows * depth), packed(panels * depth * kGemmPanel), tile(rows * padded);
+        for (int64_t i = begin; i < end; ++i) {
+            const float* am = a.matrix(i);
+            for (int64_t m = 0; m < rows; ++m) {
+                for (int64_t k = 0; k < depth; ++k) rowsA[m * depth + k] = am[m * a.sr + k * a.sc];
+            }
+            const float* bm = b.matrix(i);
+            for (int64_t j = 0; j < panels; ++j) {
+                const int64_t width = std::min(kGemmPanel, cols - j * kGemmPanel);
+                for (int64_t k = 0; k < depth; ++k) {
+                    float* dst = packed.data() + (j * depth + k) * kGemmPanel;
+                    for (int64_t p = 0; p < width; ++p) dst[p] = bm[k * b.sr + (j * kGemmPanel + p) * b.sc];
+                    for (int64_t p = width; p < kGemmPanel; ++p) dst[p] = 0.f;
+                }
+            }
+            for (int64_t j = 0; j < panels; ++j) {
+                for (int64_t m = 0; m < rows; m += kGemmRows) {
+                    const int64_t height = std::min(kGemmRows, rows - m);
+                    blocks[height](rowsA.data() + m * depth,
+                                   depth,
+                                   packed.data() + j * depth * kGemmPanel,
+                                   depth,
+                                   tile.data() + m * padded + j * kGemmPanel,
+                                   padded,
+                                   m,
+                                   j * kGemmPanel,
+                                   kGemmPanel,
+                                   true,
+                                   nullptr);
+                }
+            }
+            float* cm = c + i * scb;
+            const float* dm = beta != 0.f && addend.data != nullptr ? addend.matrix(i) : nullptr;
+            for (int64_t m = 0; m < rows; ++m) {
+                const float* t = tile.data() + m * padded;
+                for (int64_t n = 0; n < cols; ++n) {
+                    const float v = alpha * t[n];
+                    cm[m * scr + n * scc] = dm != nullptr ? v + beta * dm[m * addend.sr + n * addend.sc] : v;
+                }
+            }
+        }
+    });
+}
+
+/**
+ * The same products for matrices past the small matrix path, one matrix of the batch after the other, each with the
+ * parallel packed GEMM. Matrices of b are packed once per distinct address, so a b broadcast across the batch is packed
+ * once however often it is used, and a packed matrix is released after its last use: only those of b that repeat
+ * further on are held at a time. c is contiguous.
+ */
+void gemmLargeBatched(const BatchedMatrix& a, const BatchedMatrix& b, float* c, int64_t batch, int64_t rows, int64_t depth, int64_t cols) {
+    const int64_t panels = (cols + kGemmPanel - 1) / kGemmPanel;
+    std::unordered_map<const float*, int64_t> lastUse;
+    for (int64_t i = 0; i < batch; ++i) lastUse[b.matrix(i)] = i;
+    std::unordered_map<const float*, std::vector<float>> packed;
+    // the buffer of the last released pack, reused for the next one
+    std::vector<float> spare;
+    std::vector<float> rowsA;
+    const GemmEpilogue epilogue{1.f, 0.f, nullptr, nullptr, 0, GemmActivation::None};
+    for (int64_t i = 0; i < batch; ++i) {
+        const float* bm = b.matrix(i);
+        auto it = packed.find(bm);
+        if (it == packed.end()) {
+            spare.resize(panels * depth * kGemmPanel);
+            it = packed.emplace(bm, std::move(spare)).first;
+            spare.clear();
+            packPanels(bm, depth, cols, b.sr, b.sc, it->second.data());
+        }
+        // a is read in place when its rows are contiguous
+        const float* am = a.matrix(i);
+        int64_t lda = a.sr;
+        if (a.sc != 1) {
+            rowsA.resize(rows * depth);
+            for (int64_t m = 0; m < rows; ++m) {
+                for (int64_t k = 0; k < depth; ++k) rowsA[m * depth + k] = am[m * a.sr + k * a.sc];
+            }
+            am = rowsA.data();
+            lda = depth;
+        }
+        gemmPacked(am, lda, it->second.data(), c + i * rows * cols, cols, rows, depth, cols, epilogue);
+        if (lastUse[bm] == i) {
+            spare = std::move(it->second);
+            packed.erase(it);
+        }
+    }
+}
+
+// element offsets of the matrices of t, for its leading batchDims dimensions flattened in row major order
+std::vector<int64_t> batchOffsets(const at::Tensor& t, int64_t batchDims) {
+    int64_t batch = 1;
+    for (int64_t d = 0; d < batchDims; ++d) batch *= t.size(d);
+    std::vector<int64_t> offsets(batch);
+    std::vector<int64_t> index(batchDims, 0);
+    int64_t offset = 0;
+    for (int64_t i = 0; i < batch; ++i) {
+        offsets[i] = offset;
+        for (int64_t d = batchDims - 1; d >= 0; --d) {
+            offset += t.stride(d);
+            if (++index[d] < t.size(d)) break;
+            offset -= t.stride(d) * t.size(d);
+            index[d] = 0;
+        }
+    }
+    return offsets;
+}
+
+// sizes of at::matmul(input, other) with the dimensions of vector operands kept as 1
+std::vector<int64_t> matmulSizes(const at::Tensor& input, const at::Tensor& other) {
+    const int64_t rows = input.dim() == 1 ? 1 : input.size(-2);
+    const int64_t cols = other.dim() == 1 ? 1 : other.size(-1);
+    auto batchInput = input.sizes().slice(0, std::max<int64_t>(input.dim() - 2, 0));
+    auto batchOther = other.sizes().slice(0, std::max<int64_t>(other.dim() - 2, 0));
+    std::vector<int64_t> sizes = at::infer_size(batchInput, batchOther);
+    sizes.push_back(rows);
+    sizes.push_back(cols);
+    return sizes;
+}
+
+// the finalizer of MurmurHash3
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * Four interleaved lanes of multiply and xorshift over 64-bit words. Every step is a bijection of the lane, so two
+ * contents that differ in any word only hash alike if a later word happens to cancel the difference exactly.
+ */
+uint64_t checksumBlock(const unsigned char* data, int64_t bytes, uint64_t seed) {
+    constexpr uint64_t kPrime = 0x9e3779b97f4a7c15ULL;
+    uint64_t lanes[4] = {mix64(seed), mix64(seed + 1), mix64(seed + 2), mix64(seed + 3)};
+    int64_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * kPrime;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+    for (; i < bytes; i += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, std::min<int64_t>(bytes - i, sizeof(word)));
+        lanes[0] = mix64(lanes[0] ^ word);
+    }
+    uint64_t h = lanes[0];
+    for (int lane = 1; lane < 4; ++lane) h = mix64(h ^ lanes[lane]);
+    return h;
+}
+
+bool packedCacheEnabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("DIOPI_TORCH_PACKED_WEIGHTS");
+        return env == nullptr || std::string(env) != "0";
+    }();
+    return enabled;
+}
+
+// panels of b (K, N) in the layout gemmPacked reads
+at::Tensor packMatrix(const at::Tensor& b) {
+    const int64_t panels = (b.size(1) + kGemmPanel - 1) / kGemmPanel;
+    auto packed = at::empty({panels * b.size(0) * kGemmPanel}, b.options());
+    packPanels(b.data_ptr<float>(), b.size(0), b.size(1), b.stride(0), b.stride(1), packed.data_ptr<float>());
+    return packed;
+}
+
+/**
+ * Packed linear weights by address, shape and strides, least recently used dropped first once they take more than
+ * kMaxPackedBytes. mm and addmm pack per call: their right-hand matrix is as often an activation as a weight. buildATen
+ * wraps the same memory in a fresh tensor on every call, so there is no version counter to key on; an entry is
+ * revalidated against a checksum of every element instead, a read-only pass that is cheaper than packing again.
+ * DIOPI_TORCH_PACKED_WEIGHTS=0 packs on every call instead.
+ */
+class PackedMatrixCache {
+public:
+    static PackedMatrixCache& instance() {
+        static PackedMatrixCache cache;
+        return cache;
+    }
+
+    // packed panels of b (K, N), packing it if no valid entry exists
+    at::Tensor get(const at::Tensor& b) {
+        if (!packedCacheEnabled()) return packMatrix(b);
+        const Key key{b.data_ptr(), b.size(0), b.size(1), b.stride(0), b.stride(1)};
+        const uint64_t checksum = contentChecksum(b);
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (!(it->key == key)) continue;
+            if (it->checksum == checksum) {
+                entries_.splice(entries_.begin(), entries_, it);
+                return it->packed;
+            }
+            bytes_ -= it->packed.nbytes();
+            entries_.erase(it);
+            break;
+        }
+        auto packed = packMatrix(b);
+        if (packed.nbytes() > kMaxPackedBytes) return packed;
+        while (bytes_ + packed.nbytes() > kMaxPackedBytes) {
+            bytes_ -= entries_.back().packed.nbytes();
+            entries_.pop_back();
+        }
+        bytes_ += packed.nbytes();
+        entries_.push_front(Entry{key, checksum, packed});
+        return packed;
+    }
+
+    // packed panels of b if a valid entry exists, an undefined tensor otherwise
+    at::Tensor find(const at::Tensor& b) {
+        if (!packedCacheEnabled()) return at::Tensor();
+        const Key key{b.data_ptr(), b.size(0), b.size(1), b.stride(0), b.stride(1)};
+        {
+            // most lookups miss on the address alone and need no checksum
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (std::none_of(entries_.begin(), entries_.end(), [&key](const Entry& entry) { return entry.key == key; })) return at::Tensor();
+        }
+        const uint64_t checksum = contentChecksum(b);
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (const auto& entry : entries_) {
+            if (entry.key == key && entry.checksum == checksum) return entry.packed;
+        }
+        return at::Tensor();
+    }
+
+private:
+    struct Key {
+        const void* data;
+        int64_t depth;
+        int64_t cols;
+        int64_t sk;
+        int64_t sn;
+        bool operator==(const Key& other) const {
+            return data == other.data && depth == other.depth && cols == other.cols && sk == other.sk && sn == other.sn;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t checksum;
+        at::Tensor packed;
+    };
+
+    std::mutex mutex_;
+    // most recently used first
+    std::list<Entry> entries_;
+    size_t bytes_ = 0;
+};
+
+bool isHostFloat(const at::Tensor& t) { return !t.defined() || (t.is_cpu() && t.scalar_type() == at::kFloat); }
+
+// out (M, N) = epilogue(mat1 (M, K) x mat2 (K, N)); out must be contiguous. Only a linear weight is worth caching packed.
+void addmmImpl(at::Tensor& out, const at::Tensor& mat1, const at::Tensor& mat2, GemmEpilogue epilogue, bool cacheMat2) {
+    auto a = mat1.contiguous();
+    auto packed = cacheMat2 ? PackedMatrixCache::instance().get(mat2) : packMatrix(mat2);
+    gemmPacked(a.data_ptr<float>(), a.size(1), packed.data_ptr<float>(), out.data_ptr<float>(), out.size(1), a.size(0), a.size(1), mat2.size(1), epilogue);
+}
+
+}  // namespace
+
+uint64_t contentChecksum(const at::Tensor& t) {
+    // a dense tensor of any strides covers one run of memory from its first element
+    auto dense = t.is_non_overlapping_and_dense() ? t : t.contiguous();
+    const auto* data = static_cast<const unsigned char*>(dense.data_ptr());
+    const int64_t bytes = dense.numel() * dense.element_size();
+    const int64_t blocks = (bytes + kChecksumBlock - 1) / kChecksumBlock;
+    std::vector<uint64_t> partial(blocks);
+    at::parallel_for(0, blocks, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t b = begin; b < end; ++b) {
+            partial[b] = checksumBlock(data + b * kChecksumBlock, std::min(kChecksumBlock, bytes - b * kChecksumBlock), 4 * b);
+        }
+    });
+    uint64_t h = mix64(bytes);
+    for (uint64_t p : partial) h = mix64(h ^ p);
+    return h;
+}
+
+bool packedGemmSupported(const at::Tensor& out, const at::Tensor& mat1, const at::Tensor& mat2) {
+    if (!isHostFloat(out) || !isHostFloat(mat1) || !isHostFloat(mat2) || !out.is_contiguous()) return false;
+    if (mat1.dim() != 2 || mat2.dim() != 2 || mat2.numel() == 0 || mat1.size(1) != mat2.size(0)) return false;
+    return out.dim() == 2 && out.size(0) == mat1.size(0) && out.size(1) == mat2.size(1);
+}
+
+bool packedLinearSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias) {
+    if (!isHostFloat(out) || !isHostFloat(input) || !isHostFloat(weight) || !isHostFloat(bias) || !out.is_contiguous()) return false;
+    if (input.dim() < 1 || weight.dim() != 2 || weight.numel() == 0 || input.size(-1) != weight.size(1)) return false;
+    if (bias.defined() && bias.numel() != weight.size(0)) return false;
+    return out.numel() == input.numel() / weight.size(1) * weight.size(0);
+}
+
+bool packedAddmmSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& mat1, const at::Tensor& mat2) {
+    if (!packedGemmSupported(out, mat1, mat2) || !isHostFloat(input)) return false;
+    // out is written a k block at a time, before the epilogue reads input
+    if (input.defined() && input.data_ptr() == out.data_ptr()) return false;
+    const int64_t cols = mat2.size(1);
+    const bool row = input.numel() == cols && (input.dim() == 1 || (input.dim() == 2 && input.size(0) == 1));
+    const bool full = input.dim() == 2 && input.size(0) == mat1.size(0) && input.size(1) == cols;
+    return row || full;
+}
+
+void linear(at::Tensor& out, const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, GemmActivation activation) {
+    const int64_t depth = weight.size(1);
+    auto a = input.reshape({-1, depth});
+    auto c = out.view({-1, weight.size(0)});
+    auto b = bias.defined() ? bias.contiguous() : at::Tensor();
+    const GemmEpilogue epilogue{1.f, 1.f, b.defined() ? b.data_ptr<float>() : nullptr, nullptr, 0, activation};
+    addmmImpl(c, a, weight.t(), epilogue, true);
+}
+
+void addmm(at::Tensor& out, const at::Tensor& input, const at::Tensor& mat1, const at::Tensor& mat2, double beta, double alpha) {
+    GemmEpilogue epilogue{static_cast<float>(alpha), static_cast<float>(beta), nullptr, nullptr, 0, GemmActivation::None};
+    // beta == 0 ignores input altogether, NaN and inf included, as ATen does
+    auto addend = beta == 0 ? at::Tensor() : input.contiguous();
+    if (addend.defined() && addend.numel() == mat2.size(1)) {
+        epilogue.bias = addend.data_ptr<float>();
+    } else if (addend.defined()) {
+        epilogue.addend = addend.data_ptr<float>();
+        epilogue.ldAddend = addend.size(1);
+    }
+    addmmImpl(out, mat1, mat2, epilogue, false);
+}
+
+void mm(at::Tensor& out, const at::Tensor& mat1, const at::Tensor& mat2) {
+    addmmImpl(out, mat1, mat2, GemmEpilogue{1.f, 0.f, nullptr, nullptr, 0, GemmActivation::None}, false);
+}
+
+bool smallBmmSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& batch1, const at::Tensor& batch2) {
+    if (!isHostFloat(out) || !isHostFloat(input) || !isHostFloat(batch1) || !isHostFloat(batch2)) return false;
+    if (batch1.dim() != 3 || batch2.dim() != 3 || batch1.size(0) != batch2.size(0) || batch1.size(2) != batch2.size(1)) return false;
+    const int64_t rows = batch1.size(1), depth = batch1.size(2), cols = batch2.size(2);
+    if (out.dim() != 3 || out.size(0) != batch1.size(0) || out.size(1) != rows || out.size(2) != cols) return false;
+    if (input.defined() && !at::is_expandable_to(input.sizes(), out.sizes())) return false;
+    // above the threshold the per-matrix overhead of the large path no longer matters
+    return std::max({rows, depth, cols}) <= kSmallGemmExtent && rows * depth * cols <= kSmallGemmWork;
+}
+
+void baddbmm(at::Tensor& out, const at::Tensor& input, const at::Tensor& batch1, const at::Tensor& batch2, double beta, double alpha) {
+    const int64_t batch = batch1.size(0), rows = batch1.size(1), depth = batch1.size(2), cols = batch2.size(2);
+    if (out.numel() == 0) return;
+    if (depth == 0) {
+        // an empty product, only the scaled input is left
+        if (beta == 0 || !input.defined()) {
+            out.zero_();
+        } else {
+            out.copy_(input.expand(out.sizes()) * beta);
+        }
+        return;
+    }
+    const at::Tensor addend = beta != 0 && input.defined() ? input.expand(out.sizes()) : at::Tensor();
+    const BatchedMatrix a{batch1.data_ptr<float>(), nullptr, batch1.stride(0), batch1.stride(1), batch1.stride(2)};
+    const BatchedMatrix b{batch2.data_ptr<float>(), nullptr, batch2.stride(0), batch2.stride(1), batch2.stride(2)};
+    const BatchedMatrix d = addend.defined() ? BatchedMatrix{addend.data_ptr<float>(), nullptr, addend.stride(0), addend.stride(1), addend.stride(2)}
+                                             : BatchedMatrix{nullptr, nullptr, 0, 0, 0};
+    gemmSmallBatched(a,
+                     b,
+                     d,
+                     out.data_ptr<float>(),
+                     out.stride(0),
+                     out.stride(1),
+                     out.stride(2),
+                     batch,
+                     rows,
+                     depth,
+                     cols,
+                     static_cast<float>(alpha),
+                     static_cast<float>(beta));
+}
+
+void bmm(at::Tensor& out, const at::Tensor& batch1, const at::Tensor& batch2) { baddbmm(out, at::Tensor(), batch1, batch2, 0.0, 1.0); }
+
+bool broadcastMatmulSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& other) {
+    if (!isHostFloat(out) || !isHostFloat(input) || !isHostFloat(other) || !out.defined() || !out.is_contiguous()) return false;
+    if (input.dim() < 1 || other.dim() < 1 || (input.dim() <= 2 && other.dim() <= 2)) return false;
+    const int64_t depth = input.size(-1);
+    if (depth == 0 || depth != (other.dim() == 1 ? other.size(0) : other.size(-2))) return false;
+    auto batchInput = input.sizes().slice(0, std::max<int64_t>(input.dim() - 2, 0));
+    auto batchOther = other.sizes().slice(0, std::max<int64_t>(other.dim() - 2, 0));
+    for (int64_t i = 1; i <= static_cast<int64_t>(std::min(batchInput.size(), batchOther.size())); ++i) {
+        const int64_t x = batchInput[batchInput.size() - i], y = batchOther[batchOther.size() - i];
+        if (x != y && x != 1 && y != 1) return false;
+    }
+    int64_t numel = 1;
+    for (int64_t size : matmulSizes(input, other)) numel *= size;
+    return out.numel() == numel;
+}
+
+void broadcastMatmul(at::Tensor& out, const at::Tensor& input, const at::Tensor& other) {
+    if (out.numel() == 0) return;
+    // vectors become single row or column matrices, views both
+    const at::Tensor mat1 = input.dim() == 1 ? input.unsqueeze(0) : input;
+    const at::Tensor mat2 = other.dim() == 1 ? other.unsqueeze(-1) : other;
+    std::vector<int64_t> sizes = matmulSizes(input, other);
+    const int64_t batchDims = static_cast<int64_t>(sizes.size()) - 2;
+    const int64_t rows = sizes[batchDims], depth = mat1.size(-1), cols = sizes[batchDims + 1];
+    // the batch dimensions broadcast by expanding, which only sets strides to 0
+    std::vector<int64_t> sizes1(sizes.begin(), sizes.begin() + batchDims), sizes2(sizes1);
+    sizes1.insert(sizes1.end(), {rows, depth});
+    sizes2.insert(sizes2.end(), {depth, cols});
+    const at::Tensor a = mat1.expand(sizes1);
+    const at::Tensor b = mat2.expand(sizes2);
+    const std::vector<int64_t> offsetsA = batchOffsets(a, batchDims);
+    const std::vector<int64_t> offsetsB = batchOffsets(b, batchDims);
+    const int64_t batch = static_cast<int64_t>(offsetsA.size());
+    const BatchedMatrix ma{a.data_ptr<float>(), offsetsA.data(), 0, a.stride(-2), a.stride(-1)};
+    const BatchedMatrix mb{b.data_ptr<float>(), offsetsB.data(), 0, b.stride(-2), b.stride(-1)};
+    if (std::max({rows, depth, cols}) <= kSmallGemmExtent && rows * depth * cols <= kSmallGemmWork) {
+        const BatchedMatrix none{nullptr, nullptr, 0, 0, 0};
+        gemmSmallBatched(ma, mb, none, out.data_ptr<float>(), rows * cols, cols, 1, batch, rows, depth, cols, 1.f, 0.f);
+    } else {
+        gemmLargeBatched(ma, mb, out.data_ptr<float>(), batch, rows, depth, cols);
+    }
+}
+
+at::Tensor linearBackwardInput(const at::Tensor& gradOutput, const at::Tensor& weight) {
+    if (!isHostFloat(gradOutput) || !isHostFloat(weight) || weight.dim() != 2 || weight.numel() == 0) return at::matmul(gradOutput, weight);
+    auto packed = PackedMatrixCache::instance().find(weight.t());
+    if (!packed.defined()) return at::matmul(gradOutput, weight);
+    const int64_t cols = weight.size(0);
+    const int64_t depth = weight.size(1);
+    auto g = gradOutput.reshape({-1, cols}).contiguous();
+    std::vector<int64_t> sizes = gradOutput.sizes().vec();
+    sizes.back() = depth;
+    auto gradInput = at::empty(sizes, gradOutput.options());
+    gemmPackedTransposed(g.data_ptr<float>(), g.size(0), packed.data_ptr<float>(), depth, cols, gradInput.data_ptr<float>());
+    return gradInput;
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
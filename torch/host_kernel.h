@@ -0,0 +1,189 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <tuple>
+
+namespace impl {
+namespace aten {
+namespace host {
+
+// Algorithms the host convolution tuner picks from; the values are only used in memory, the cache file stores names.
+enum class ConvAlgorithm : int32_t {
+    Aten = 0,
+    Im2colGemm,
+    PointwiseGemm,
+    WinogradF2x3,
+    WinogradF4x3,
+};
+
+/**
+ * Convolution of CPU tensors, shapes checked as in ATen. The first call for a (shapes, memory formats, stride, padding,
+ * dilation, groups, dtype) key times every algorithm that supports it and keeps the fastest; later calls with that key go
+ * straight to it. Only a key some algorithm ran for is remembered. If DIOPI_TORCH_CONV_TUNING_CACHE names a file,
+ * decisions are appended to it and read back on the first call of a process.
+ */
+at::Tensor convolution(const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, at::IntArrayRef stride,
+        at::IntArrayRef padding, at::IntArrayRef dilation, int64_t groups);
+
+/**
+ * Winograd F(tile x tile, 3 x 3), tile 2 or 4, for fp32 3x3 convolutions with unit stride and dilation. The tuner only
+ * offers it for such layers when DIOPI_TORCH_CONV_WINOGRAD is 1.
+ *
+ * The transforms trade accuracy for multiplications. Measured against a double precision direct convolution on uniform
+ * [-1, 1] data with 64 to 256 input channels, the largest error relative to the largest output is about 1e-6 for F(2, 3),
+ * on par with a direct fp32 convolution, and about 1e-5 for F(4, 3).
+ */
+int64_t winogradFilterNumel(int64_t tile, int64_t outChannels, int64_t channels);
+
+// weight (outChannels, channels per group, 3, 3) into the (Alpha^2, outChannels, channels per group) Winograd domain
+void winogradTransformFilter(int64_t tile, const float* weight, int64_t outChannels, int64_t channels, float* transformed);
+
+// NCHW input and output; bias may be null
+void winogradConvolution(int64_t tile, const float* input, const float* transformed, const float* bias, float* output, int64_t batch, int64_t channels,
+        int64_t height, int64_t width, int64_t outChannels, int64_t groups, int64_t padH, int64_t padW);
+
+/**
+ * 64-bit checksum of every byte of a CPU tensor, in parallel over fixed blocks. The host weight caches key on the address
+ * of a weight and revalidate an entry with it, since buildATen gives them no version counter to go by.
+ */
+uint64_t contentChecksum(const at::Tensor& t);
+
+// activation fused into the epilogue of the packed GEMM
+enum class GemmActivation : int32_t {
+    None = 0,
+    Relu,
+};
+
+/**
+ * fp32 products of CPU tensors against a right-hand matrix packed in the panel layout of the micro-kernel. linear keeps
+ * its packed weights cached by address, shape and strides and revalidated against contentChecksum, so a weight passed
+ * again unchanged is not packed again; DIOPI_TORCH_PACKED_WEIGHTS=0 turns the cache off. mm and addmm pack on every call.
+ * out must be contiguous.
+ */
+bool packedGemmSupported(const at::Tensor& out, const at::Tensor& mat1, const at::Tensor& mat2);
+bool packedAddmmSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& mat1, const at::Tensor& mat2);
+bool packedLinearSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias);
+
+// out (..., O) = activation(input (..., I) x weight (O, I)^T + bias), bias may be undefined
+void linear(at::Tensor& out, const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias, GemmActivation activation);
+
+// out = beta * input + alpha * mat1 x mat2, input either a row of N or (M, N)
+void addmm(at::Tensor& out, const at::Tensor& input, const at::Tensor& mat1, const at::Tensor& mat2, double beta, double alpha);
+
+void mm(at::Tensor& out, const at::Tensor& mat1, const at::Tensor& mat2);
+
+/**
+ * fp32 batched products of small CPU matrices, parallel over the batch with block kernels specialized for the common
+ * depths. Larger products, where the overhead per matrix of the usual path stops mattering, are not supported. Any
+ * strides; input may be undefined and only has to broadcast to out.
+ */
+bool smallBmmSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& batch1, const at::Tensor& batch2);
+
+// out = beta * input + alpha * batch1 x batch2
+void baddbmm(at::Tensor& out, const at::Tensor& input, const at::Tensor& batch1, const at::Tensor& batch2, double beta, double alpha);
+
+void bmm(at::Tensor& out, const at::Tensor& batch1, const at::Tensor& batch2);
+
+/**
+ * at::matmul of fp32 CPU tensors with at least one operand past two dimensions. Broadcast batch dimensions are walked
+ * with stride 0 instead of being expanded into copies, and a matrix shared across the batch is packed once. out must be
+ * contiguous with as many elements as the result.
+ */
+bool broadcastMatmulSupported(const at::Tensor& out, const at::Tensor& input, const at::Tensor& other);
+void broadcastMatmul(at::Tensor& out, const at::Tensor& input, const at::Tensor& other);
+
+// gradOutput (..., O) x weight (O, I), read from the packed weight when linear() left one in the cache
+at::Tensor linearBackwardInput(const at::Tensor& gradOutput, const at::Tensor& weight);
+
+/**
+ * Attention softmax(query x key^T * scale + mask) x value over (B, H, L, D) operands, returning the output and the
+ * logsumexp of every score row, (B, H, Lq). mask is additive and broadcasts to (B, H, Lq, Lk); causal hides key j from
+ * query i for j > i. For fp32 CPU tensors it is fused: query tiles run through the keys with an online softmax, so no
+ * score matrix is ever allocated, in parallel over batch, heads and query tiles. Anything else goes through ATen.
+ */
+std::tuple<at::Tensor, at::Tensor> scaledDotProductAttention(const at::Tensor& query, const at::Tensor& key, const at::Tensor& value, const at::Tensor& mask,
+        double scale, bool causal);
+
+// gradients of query, key and value, with the probabilities recomputed from the scores and the logsumexp of the forward
+std::tuple<at::Tensor, at::Tensor, at::Tensor> scaledDotProductAttentionBackward(const at::Tensor& gradOut, const at::Tensor& query, const at::Tensor& key,
+        const at::Tensor& value, const at::Tensor& out, const at::Tensor& lse, const at::Tensor& mask, double scale, bool causal);
+
+/**
+ * 2-D pooling of 4-D fp32/fp64 CPU tensors in NHWC. Every tap of a window handles a whole contiguous channel row. An
+ * NCHW input is converted first, so callers take this path for channels-last inputs, or when they want local indices.
+ */
+bool hostPoolSupported(const at::Tensor& input);
+
+// taps of a window; local indices are int8, so they need at most 128
+int64_t poolWindowTaps(at::IntArrayRef kernel);
+
+/**
+ * Max pooling returning (out, indices), both channels last. With indexType kLong the indices are h * W + w as in ATen.
+ * With kChar they are the tap within the window, i * kW + j, an eighth of the memory. The backward takes either form.
+ */
+std::tuple<at::Tensor, at::Tensor> maxPool2dNhwc(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding,
+        at::IntArrayRef dilation, bool ceilMode, bool withIndices, at::ScalarType indexType);
+at::Tensor maxPool2dBackwardNhwc(const at::Tensor& gradOutput, const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride,
+        at::IntArrayRef padding, at::IntArrayRef dilation, bool ceilMode, const at::Tensor& indices);
+
+at::Tensor avgPool2dNhwc(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding, bool ceilMode,
+        bool countIncludePad, c10::optional<int64_t> divisorOverride);
+at::Tensor avgPool2dBackwardNhwc(const at::Tensor& gradOutput, const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride,
+        at::IntArrayRef padding, bool ceilMode, bool countIncludePad, c10::optional<int64_t> divisorOverride);
+
+/**
+ * Average pools over spatialDims trailing dimensions of (N, C, ...) or (C, ...) fp32/fp64 CPU tensors, summed one axis
+ * at a time as differences of running sums, so the cost does not grow with the window. count_include_pad, ceil_mode and
+ * divisor_override follow ATen, and so do the adaptive windows. The sums are kept in double, so the results can differ
+ * from ATen's in the last place; separableAvgPoolSupported says no unless DIOPI_TORCH_SEPARABLE_AVG_POOL is 1. For
+ * fixed windows the separable form pays off from 16 taps on, and it says no below that too.
+ */
+bool separableAvgPoolSupported(const at::Tensor& input, int64_t spatialDims, at::IntArrayRef kernel);
+at::Tensor avgPoolSeparable(const at::Tensor& input, int64_t spatialDims, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding,
+        bool ceilMode, bool countIncludePad, c10::optional<int64_t> divisorOverride);
+at::Tensor avgPoolSeparableBackward(const at::Tensor& gradOutput, const at::Tensor& input, int64_t spatialDims, at::IntArrayRef kernel,
+        at::IntArrayRef stride, at::IntArrayRef padding, bool ceilMode, bool countIncludePad, c10::optional<int64_t> divisorOverride);
+at::Tensor adaptiveAvgPoolSeparable(const at::Tensor& input, int64_t spatialDims, at::IntArrayRef outputSize);
+at::Tensor adaptiveAvgPoolSeparableBackward(const at::Tensor& gradOutput, const at::Tensor& input, int64_t spatialDims);
+
+enum class UpsampleMode : int32_t {
+    Nearest = 0,
+    // linear, bilinear or trilinear after the number of spatial dimensions
+    Linear,
+};
+
+/**
+ * Nearest and linear upsampling of contiguous (N, C, ...) fp32/fp64 CPU tensors with one to three spatial dimensions,
+ * indices and weights as in ATen. The source indices and weights of an axis are computed once per (in, out,
+ * align_corners, mode) and cached; the axes then run one after the other, each a gather or a blend of whole rows. The
+ * backward gathers every input from the outputs it feeds in a fixed order, so it is deterministic and needs no atomics.
+ */
+bool upsampleSupported(const at::Tensor& input);
+at::Tensor upsample(const at::Tensor& input, at::IntArrayRef outputSize, UpsampleMode mode, bool alignCorners);
+at::Tensor upsampleBackward(const at::Tensor& gradOutput, at::IntArrayRef inputSize, UpsampleMode mode, bool alignCorners);
+
+/**
+ * im2col and col2im of (N, C, H, W) or (C, H, W) CPU floating point tensors, in parallel over channel planes. A column
+ * row of a tap is a run of one input row: with unit stride it is one memcpy, otherwise a strided gather, and only the
+ * part of it in the padding is zero filled. col2im gives every task whole output planes, so it needs no atomics and
+ * sums in a fixed order. The sizes may hold one value for both dimensions.
+ */
+bool im2colSupported(const at::Tensor& input);
+at::Tensor im2col(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef dilation, at::IntArrayRef padding, at::IntArrayRef stride);
+at::Tensor col2im(const at::Tensor& columns, at::IntArrayRef outputSize, at::IntArrayRef kernel, at::IntArrayRef dilation, at::IntArrayRef padding,
+        at::IntArrayRef stride);
+
+// Tensor.unfold into a contiguous result, and its backward as a gather over the windows that cover each element
+at::Tensor unfold(const at::Tensor& input, int64_t dim, int64_t size, int64_t step);
+at::Tensor unfoldBackward(const at::Tensor& gradOutput, at::IntArrayRef inputSizes, int64_t dim, int64_t size, int64_t step);
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
@@ -0,0 +1,293 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+#include <ATen/WrapDimUtils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// elements a parallel task should at least touch
+constexpr int64_t kIm2colGrain = 32768;
+
+struct Im2colGeometry {
+    int64_t planes;
+    int64_t height;
+    int64_t width;
+    int64_t outHeight;
+    int64_t outWidth;
+    int64_t kh;
+    int64_t kw;
+    int64_t dh;
+    int64_t dw;
+    int64_t ph;
+    int64_t pw;
+    int64_t sh;
+    int64_t sw;
+
+    int64_t taps() const { return kh * kw; }
+    int64_t columns() const { return outHeight * outWidth; }
+};
+
+// the DIOPI sizes may hold one value for both dimensions
+inline int64_t pick(at::IntArrayRef values, int64_t i) { return values[values.size() == 1 ? 0 : i]; }
+
+// floor division as at::native::div_rtn, the spans below turn negative when the kernel outgrows the padded input
+inline int64_t floorDiv(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+// the argument checks of at::native::im2col_shape_check and col2im_shape_check, the planes are left to the caller
+Im2colGeometry im2colGeometry(int64_t height, int64_t width, at::IntArrayRef kernel, at::IntArrayRef dilation, at::IntArrayRef padding,
+                              at::IntArrayRef stride) {
+    for (auto values : {kernel, dilation, padding, stride}) {
+        TORCH_CHECK(values.size() == 1 || values.size() == 2, "kernel_size, dilation, padding and stride are expected to hold 1 or 2 values, but got ",
+                    values.size());
+    }
+    Im2colGeometry g;
+    g.planes = 0;
+    g.height = height;
+    g.width = width;
+    g.kh = pick(kernel, 0);
+    g.kw = pick(kernel, 1);
+    g.dh = pick(dilation, 0);
+    g.dw = pick(dilation, 1);
+    g.ph = pick(padding, 0);
+    g.pw = pick(padding, 1);
+    g.sh = pick(stride, 0);
+    g.sw = pick(stride, 1);
+    TORCH_CHECK(g.kh > 0 && g.kw > 0, "kernel size should be greater than zero, but got kernel_height: ", g.kh, " kernel_width: ", g.kw);
+    TORCH_CHECK(g.dh > 0 && g.dw > 0, "dilation should be greater than zero, but got dilation_height: ", g.dh, " dilation_width: ", g.dw);
+    TORCH_CHECK(g.ph >= 0 && g.pw >= 0, "padding should be non-negative, but got pad_height: ", g.ph, " pad_width: ", g.pw);
+    TORCH_CHECK(g.sh > 0 && g.sw > 0, "stride should be greater than zero, but got stride_height: ", g.sh, " stride_width: ", g.sw);
+    g.outHeight = floorDiv(height + 2 * g.ph - (g.dh * (g.kh - 1) + 1), g.sh) + 1;
+    g.outWidth = floorDiv(width + 2 * g.pw - (g.dw * (g.kw - 1) + 1), g.sw) + 1;
+    TORCH_CHECK(g.outHeight >= 1 && g.outWidth >= 1, "Given spatial size (", height, ", ", width, "), kernel_size=(", g.kh, ", ", g.kw, "), dilation=(", g.dh,
+                ", ", g.dw, "), padding=(", g.ph, ", ", g.pw, "), calculated shape of the array of sliding blocks as (", g.outHeight, ", ", g.outWidth,
+                "), but its components must be at least one.");
+    return g;
+}
+
+// outputs [begin, end) whose input q * stride + offset lies in [0, size)
+inline void validOutputs(int64_t offset, int64_t stride, int64_t size, int64_t outSize, int64_t* begin, int64_t* end) {
+    *end = size - offset <= 0 ? 0 : std::min(outSize, (size - offset - 1) / stride + 1);
+    *begin = std::min(*end, offset >= 0 ? 0 : (-offset + stride - 1) / stride);
+}
+
+/**
+ * Columns of one input plane, (kh * kw, outHeight * outWidth). Every column row of a tap is an input row segment: with
+ * unit stride it is copied whole, otherwise gathered with the stride. Only the padding is zero filled.
+ */
+template <typename scalar_t>
+void im2colPlane(const scalar_t* input, const Im2colGeometry& g, scalar_t* columns) {
+    for (int64_t i = 0; i < g.kh; ++i) {
+        for (int64_t j = 0; j < g.kw; ++j) {
+            scalar_t* rows = columns + (i * g.kw + j) * g.columns();
+            const int64_t offset = j * g.dw - g.pw;
+            int64_t begin, end;
+            validOutputs(offset, g.sw, g.width, g.outWidth, &begin, &end);
+            for (int64_t oh = 0; oh < g.outHeight; ++oh) {
+                scalar_t* r = rows + oh * g.outWidth;
+                const int64_t ih = oh * g.sh - g.ph + i * g.dh;
+                if (ih < 0 || ih >= g.height) {
+                    std::fill(r, r + g.outWidth, scalar_t(0));
+                    continue;
+                }
+                std::fill(r, r + begin, scalar_t(0));
+                std::fill(r + end, r + g.outWidth, scalar_t(0));
+                const scalar_t* s = input + ih * g.width + begin * g.sw + offset;
+                if (g.sw == 1) {
+                    std::memcpy(r + begin, s, (end - begin) * sizeof(scalar_t));
+                } else {
+                    for (int64_t ow = begin; ow < end; ++ow) r[ow] = s[(ow - begin) * g.sw];
+                }
+            }
+        }
+    }
+}
+
+// the transpose of im2colPlane: the column rows of a plane summed back into it, taps in a fixed order
+template <typename scalar_t>
+void col2imPlane(const scalar_t* columns, const Im2colGeometry& g, scalar_t* out) {
+    std::fill(out, out + g.height * g.width, scalar_t(0));
+    for (int64_t i = 0; i < g.kh; ++i) {
+        for (int64_t j = 0; j < g.kw; ++j) {
+            const scalar_t* rows = columns + (i * g.kw + j) * g.columns();
+            const int64_t offset = j * g.dw - g.pw;
+            int64_t begin, end;
+            validOutputs(offset, g.sw, g.width, g.outWidth, &begin, &end);
+            for (int64_t oh = 0; oh < g.outHeight; ++oh) {
+                const int64_t ih = oh * g.sh - g.ph + i * g.dh;
+                if (ih < 0 || ih >= g.height) continue;
+                const scalar_t* __restrict r = rows + oh * g.outWidth;
+                scalar_t* __restrict d = out + ih * g.width + begin * g.sw + offset;
+                if (g.sw == 1) {
+                    for (int64_t ow = begin; ow < end; ++ow) d[ow - begin] += r[ow];
+                } else {
+                    for (int64_t ow = begin; ow < end; ++ow) d[(ow - begin) * g.sw] += r[ow];
+                }
+            }
+        }
+    }
+}
+
+// a task owns whole planes of the image, and with them their column rows, so no two tasks write the same element
+template <typename F>
+void forEachPlane(const Im2colGeometry& g, const F& f) {
+    const int64_t work = std::max<int64_t>(1, g.taps() * g.columns());
+    at::parallel_for(0, g.planes, std::max<int64_t>(1, kIm2colGrain / work), [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) f(plane);
+    });
+}
+
+// extents of a tensor around dim: (outer, dim, inner)
+void splitAt(at::IntArrayRef sizes, int64_t dim, int64_t* outer, int64_t* inner) {
+    *outer = 1;
+    *inner = 1;
+    for (int64_t d = 0; d < dim; ++d) *outer *= sizes[d];
+    for (int64_t d = dim + 1; d < static_cast<int64_t>(sizes.size()); ++d) *inner *= sizes[d];
+}
+
+/**
+ * input (outer, len, inner) into windows (outer, windows, inner, size), window k being input[k * step, k * step + size)
+ * along the middle axis. With inner 1 a window is one contiguous copy.
+ */
+template <typename scalar_t>
+void unfoldWindows(const scalar_t* input, int64_t outer, int64_t len, int64_t inner, int64_t size, int64_t step, int64_t windows, scalar_t* out) {
+    const int64_t grain = std::max<int64_t>(1, kIm2colGrain / std::max<int64_t>(1, inner * size));
+    at::parallel_for(0, outer * windows, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t o = task / windows;
+            const int64_t k = task % windows;
+            const scalar_t* s = input + (o * len + k * step) * inner;
+            scalar_t* d = out + task * inner * size;
+            if (inner == 1) {
+                std::memcpy(d, s, size * sizeof(scalar_t));
+                continue;
+            }
+            for (int64_t e = 0; e < size; ++e) {
+                for (int64_t t = 0; t < inner; ++t) d[t * size + e] = s[e * inner + t];
+            }
+        }
+    });
+}
+
+// the transpose of unfoldWindows: element l gathers the windows k with k * step <= l < k * step + size, in order
+template <typename scalar_t>
+void foldWindows(const scalar_t* grad, int64_t outer, int64_t len, int64_t inner, int64_t size, int64_t step, int64_t windows, scalar_t* out) {
+    const int64_t grain = std::max<int64_t>(1, kIm2colGrain / std::max<int64_t>(1, inner * ((size + step - 1) / step)));
+    at::parallel_for(0, outer * len, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t o = task / len;
+            const int64_t l = task % len;
+            scalar_t* d = out + task * inner;
+            std::fill(d, d + inner, scalar_t(0));
+            const int64_t first = l < size ? 0 : (l - size) / step + 1;
+            const int64_t last = std::min(windows - 1, l / step);
+            for (int64_t k = first; k <= last; ++k) {
+                const scalar_t* s = grad + (o * windows + k) * inner * size + (l - k * step);
+                for (int64_t t = 0; t < inner; ++t) d[t] += s[t * size];
+            }
+        }
+    });
+}
+
+}  // namespace
+
+bool im2colSupported(const at::Tensor& input) {
+    const auto dtype = input.scalar_type();
+    return input.is_cpu() && (dtype == at::kFloat || dtype == at::kDouble || dtype == at::kHalf || dtype == at::kBFloat16);
+}
+
+at::Tensor im2col(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef dilation, at::IntArrayRef padding, at::IntArrayRef stride) {
+    auto x = input.contiguous();
+    TORCH_CHECK((x.dim() == 3 || x.dim() == 4) && x.size(-3) != 0 && x.size(-2) != 0 && x.size(-1) != 0,
+                "Expected 3D or 4D (batch mode) tensor with possibly 0 batch size and other non-zero dimensions for input, but got: ", x.sizes());
+    const bool batched = x.dim() == 4;
+    const int64_t batch = batched ? x.size(0) : 1;
+    const int64_t channels = x.size(-3);
+    auto g = im2colGeometry(x.size(-2), x.size(-1), kernel, dilation, padding, stride);
+    g.planes = batch * channels;
+    auto columns = at::empty({batch, channels * g.taps(), g.columns()}, x.options());
+    AT_DISPATCH_FLOATING_TYPES_AND2(at::kHalf, at::kBFloat16, x.scalar_type(), "im2col", [&] {
+        const scalar_t* in = x.data_ptr<scalar_t>();
+        scalar_t* col = columns.data_ptr<scalar_t>();
+        forEachPlane(g, [&](int64_t plane) { im2colPlane(in + plane * g.height * g.width, g, col + plane * g.taps() * g.columns()); });
+    });
+    return batched ? columns : columns.squeeze(0);
+}
+
+at::Tensor col2im(const at::Tensor& columns, at::IntArrayRef outputSize, at::IntArrayRef kernel, at::IntArrayRef dilation, at::IntArrayRef padding,
+        at::IntArrayRef stride) {
+    auto col = columns.contiguous();
+    TORCH_CHECK((col.dim() == 2 || col.dim() == 3) && col.size(-2) != 0 && col.size(-1) != 0,
+                "Expected 2D or 3D (batch mode) tensor for input with possibly 0 batch size and non-zero dimensions for input, but got: ", col.sizes());
+    TORCH_CHECK(outputSize.size() == 1 || outputSize.size() == 2, "output_size is expected to hold 1 or 2 values, but got ", outputSize.size());
+    const bool batched = col.dim() == 3;
+    const int64_t batch = batched ? col.size(0) : 1;
+    auto g = im2colGeometry(pick(outputSize, 0), pick(outputSize, 1), kernel, dilation, padding, stride);
+    TORCH_CHECK(col.size(-2) % g.taps() == 0, "Expected size of input's dimension 1 to be divisible by the product of kernel_size, but got input.size(1)=",
+                col.size(-2), " and kernel_size=(", g.kh, ", ", g.kw, ").");
+    TORCH_CHECK(col.size(-1) == g.columns(), "Expected size of input's dimension 2 to match the calculated number of sliding blocks ", g.outHeight, " * ",
+                g.outWidth, " = ", g.columns(), ", but got input.size(2)=", col.size(-1), ".");
+    const int64_t channels = col.size(-2) / g.taps();
+    g.planes = batch * channels;
+    auto out = at::empty({batch, channels, g.height, g.width}, col.options());
+    AT_DISPATCH_FLOATING_TYPES_AND2(at::kHalf, at::kBFloat16, col.scalar_type(), "col2im", [&] {
+        const scalar_t* c = col.data_ptr<scalar_t>();
+        scalar_t* o = out.data_ptr<scalar_t>();
+        forEachPlane(g, [&](int64_t plane) { col2imPlane(c + plane * g.taps() * g.columns(), g, o + plane * g.height * g.width); });
+    });
+    return batched ? out : out.squeeze(0);
+}
+
+at::Tensor unfold(const at::Tensor& input, int64_t dim, int64_t size, int64_t step) {
+    auto x = input.contiguous();
+    dim = at::maybe_wrap_dim(dim, x.dim());
+    TORCH_CHECK(size >= 0, "size is ", size, " but must be >= 0");
+    TORCH_CHECK(size <= x.size(dim), "maximum size for tensor at dimension ", dim, " is ", x.size(dim), " but size is ", size);
+    TORCH_CHECK(step > 0, "step is ", step, " but must be > 0");
+    int64_t outer, inner;
+    splitAt(x.sizes(), dim, &outer, &inner);
+    const int64_t windows = (x.size(dim) - size) / step + 1;
+    std::vector<int64_t> sizes(x.sizes().begin(), x.sizes().end());
+    sizes[dim] = windows;
+    sizes.push_back(size);
+    auto out = at::empty(sizes, x.options());
+    AT_DISPATCH_FLOATING_TYPES_AND2(at::kHalf, at::kBFloat16, x.scalar_type(), "unfold", [&] {
+        unfoldWindows(x.data_ptr<scalar_t>(), outer, x.size(dim), inner, size, step, windows, out.data_ptr<scalar_t>());
+    });
+    return out;
+}
+
+at::Tensor unfoldBackward(const at::Tensor& gradOutput, at::IntArrayRef inputSizes, int64_t dim, int64_t size, int64_t step) {
+    auto grad = gradOutput.contiguous();
+    dim = at::maybe_wrap_dim(dim, static_cast<int64_t>(inputSizes.size()));
+    TORCH_CHECK(size >= 0 && size <= inputSizes[dim], "maximum size for tensor at dimension ", dim, " is ", inputSizes[dim], " but size is ", size);
+    TORCH_CHECK(step > 0, "step is ", step, " but must be > 0");
+    const int64_t windows = (inputSizes[dim] - size) / step + 1;
+    TORCH_CHECK(grad.dim() == static_cast<int64_t>(inputSizes.size()) + 1 && grad.size(dim) == windows && grad.size(-1) == size,
+                "unfold_backward: grad_output of shape ", grad.sizes(), " does not match the unfolded input of shape ", inputSizes);
+    int64_t outer, inner;
+    splitAt(inputSizes, dim, &outer, &inner);
+    auto gradInput = at::empty(inputSizes, grad.options());
+    AT_DISPATCH_FLOATING_TYPES_AND2(at::kHalf, at::kBFloat16, grad.scalar_type(), "unfoldBackward", [&] {
+        foldWindows(grad.data_ptr<scalar_t>(), outer, inputSizes[dim], inner, size, step, windows, gradInput.data_ptr<scalar_t>());
+    });
+    return gradInput;
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
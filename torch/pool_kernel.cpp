@@ -0,0 +1,615 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// channels a backward task owns; the scatter of a window goes to disjoint channels, so tasks never collide
+constexpr int64_t kPoolChannelBlock = 16;
+// taps from which an average pool runs separably; smaller windows are summed directly as fast
+constexpr int64_t kSeparablePoolTaps = 16;
+
+// the separable sums are kept in double and round differently from ATen's, so they only replace it when asked for
+bool separableAvgPoolEnabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("DIOPI_TORCH_SEPARABLE_AVG_POOL");
+        return env != nullptr && std::string(env) == "1";
+    }();
+    return enabled;
+}
+
+struct PoolGeometry {
+    int64_t batch;
+    int64_t channels;
+    int64_t height;
+    int64_t width;
+    int64_t outHeight;
+    int64_t outWidth;
+    int64_t kh;
+    int64_t kw;
+    int64_t sh;
+    int64_t sw;
+    int64_t ph;
+    int64_t pw;
+    int64_t dh;
+    int64_t dw;
+};
+
+/**
+ * at::native::pooling_output_shape: floor division of a possibly negative span, and no window starting in the padding.
+ * The arguments are checked as pool2d_shape_check does, so that a window always holds an input element.
+ */
+int64_t poolOutputSize(int64_t in, int64_t kernel, int64_t pad, int64_t stride, int64_t dilation, bool ceilMode) {
+    TORCH_CHECK(kernel > 0, "kernel size should be greater than zero, but got ", kernel);
+    TORCH_CHECK(stride > 0, "stride should be greater than zero, but got ", stride);
+    TORCH_CHECK(dilation > 0, "dilation should be greater than zero, but got ", dilation);
+    TORCH_CHECK(pad >= 0 && pad <= kernel / 2, "pad should be smaller than or equal to half of kernel size, but got pad = ", pad, ", kernel = ", kernel);
+    TORCH_CHECK(in > 0, "Expected non-empty spatial dimensions for pooling, but got input size ", in);
+    const int64_t span = in + 2 * pad - dilation * (kernel - 1) - 1 + (ceilMode ? stride - 1 : 0);
+    int64_t out = (span >= 0 ? span / stride : -((-span + stride - 1) / stride)) + 1;
+    if (ceilMode && (out - 1) * stride >= in + pad) --out;
+    TORCH_CHECK(out >= 1, "Given input size ", in, ", calculated output size ", out, ". Output size is too small");
+    return out;
+}
+
+// the DIOPI sizes may hold one value for every dimension, and an empty stride means the kernel size
+inline int64_t pick(at::IntArrayRef values, int64_t i, int64_t fallback) { return values.empty() ? fallback : values[values.size() == 1 ? 0 : i]; }
+
+PoolGeometry poolGeometry(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation,
+                          bool ceilMode) {
+    PoolGeometry g;
+    g.batch = input.size(0);
+    g.channels = input.size(1);
+    g.height = input.size(2);
+    g.width = input.size(3);
+    g.kh = pick(kernel, 0, 1);
+    g.kw = pick(kernel, 1, 1);
+    g.sh = pick(stride, 0, g.kh);
+    g.sw = pick(stride, 1, g.kw);
+    g.ph = pick(padding, 0, 0);
+    g.pw = pick(padding, 1, 0);
+    g.dh = pick(dilation, 0, 1);
+    g.dw = pick(dilation, 1, 1);
+    g.outHeight = poolOutputSize(g.height, g.kh, g.ph, g.sh, g.dh, ceilMode);
+    g.outWidth = poolOutputSize(g.width, g.kw, g.pw, g.sw, g.dw, ceilMode);
+    return g;
+}
+
+// kernel taps [begin, end) of one axis that land inside the input
+inline void validTaps(int64_t start, int64_t kernel, int64_t dilation, int64_t size, int64_t* begin, int64_t* end) {
+    *begin = start < 0 ? (-start + dilation - 1) / dilation : 0;
+    *end = std::min(kernel, (size - start + dilation - 1) / dilation);
+}
+
+/**
+ * Max pooling of an NHWC tensor. The window of an output pixel is walked tap by tap, and every tap compares a whole
+ * channel row, so the inner loop is contiguous in channels for any kernel. The argmax is tracked as the tap within the
+ * window; Local writes it as is, otherwise it becomes the h * W + w index of ATen. NaN wins, as in ATen.
+ */
+template <typename scalar_t, typename index_t, bool Local>
+void maxPoolNhwc(const scalar_t* input, const PoolGeometry& g, scalar_t* out, index_t* indices) {
+    const int64_t c = g.channels;
+    at::parallel_for(0, g.batch * g.outHeight, 1, [&](int64_t begin, int64_t end) {
+        std::vector<scalar_t> best(c);
+        std::vector<int32_t> arg(c);
+        for (int64_t row = begin; row < end; ++row) {
+            const int64_t n = row / g.outHeight;
+            const int64_t oh = row % g.outHeight;
+            const int64_t hs = oh * g.sh - g.ph;
+            int64_t i0, i1;
+            validTaps(hs, g.kh, g.dh, g.height, &i0, &i1);
+            for (int64_t ow = 0; ow < g.outWidth; ++ow) {
+                const int64_t ws = ow * g.sw - g.pw;
+                int64_t j0, j1;
+                validTaps(ws, g.kw, g.dw, g.width, &j0, &j1);
+                std::fill(best.begin(), best.end(), -std::numeric_limits<scalar_t>::infinity());
+                std::fill(arg.begin(), arg.end(), static_cast<int32_t>(i0 * g.kw + j0));
+                for (int64_t i = i0; i < i1; ++i) {
+                    for (int64_t j = j0; j < j1; ++j) {
+                        const scalar_t* __restrict x = input + ((n * g.height + hs + i * g.dh) * g.width + ws + j * g.dw) * c;
+                        const int32_t tap = static_cast<int32_t>(i * g.kw + j);
+                        scalar_t* __restrict b = best.data();
+                        int32_t* __restrict a = arg.data();
+                        for (int64_t ch = 0; ch < c; ++ch) {
+                            const bool take = x[ch] > b[ch] || x[ch] != x[ch];
+                            b[ch] = take ? x[ch] : b[ch];
+                            a[ch] = take ? tap : a[ch];
+                        }
+                    }
+                }
+                const int64_t offset = ((n * g.outHeight + oh) * g.outWidth + ow) * c;
+                std::copy(best.begin(), best.end(), out + offset);
+                if (indices == nullptr) continue;
+                for (int64_t ch = 0; ch < c; ++ch) {
+                    if (Local) {
+                        indices[offset + ch] = static_cast<index_t>(arg[ch]);
+                    } else {
+                        indices[offset + ch] = (hs + arg[ch] / g.kw * g.dh) * g.width + ws + arg[ch] % g.kw * g.dw;
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * Backward of maxPoolNhwc from either form of the indices. Tasks own (image, channel block) pairs and scatter every
+ * output of their channels, so overlapping windows never write the same element from two threads and the sums are
+ * deterministic.
+ */
+template <typename scalar_t, typename index_t, bool Local>
+void maxPoolBackwardNhwc(const scalar_t* gradOut, const index_t* indices, const PoolGeometry& g, scalar_t* gradIn) {
+    const int64_t c = g.channels;
+    const int64_t blocks = (c + kPoolChannelBlock - 1) / kPoolChannelBlock;
+    at::parallel_for(0, g.batch * blocks, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / blocks;
+            const int64_t c0 = task % blocks * kPoolChannelBlock;
+            const int64_t c1 = std::min(c0 + kPoolChannelBlock, c);
+            scalar_t* image = gradIn + n * g.height * g.width * c;
+            for (int64_t p = 0; p < g.height * g.width; ++p) std::fill(image + p * c + c0, image + p * c + c1, scalar_t(0));
+            for (int64_t oh = 0; oh < g.outHeight; ++oh) {
+                for (int64_t ow = 0; ow < g.outWidth; ++ow) {
+                    const int64_t offset = ((n * g.outHeight + oh) * g.outWidth + ow) * c;
+                    for (int64_t ch = c0; ch < c1; ++ch) {
+                        const int64_t index = indices[offset + ch];
+                        const int64_t pixel = Local ? (oh * g.sh - g.ph + index / g.kw * g.dh) * g.width + ow * g.sw - g.pw + index % g.kw * g.dw : index;
+                        image[pixel * c + ch] += gradOut[offset + ch];
+                    }
+                }
+            }
+        }
+    });
+}
+
+// the divisor of ATen's avg_pool2d for one window; 0 for a window wholly in the padding, whose output is 0
+inline int64_t avgPoolDivisor(const PoolGeometry& g, int64_t oh, int64_t ow, bool countIncludePad, int64_t divisorOverride, int64_t* h0, int64_t* h1,
+                              int64_t* w0, int64_t* w1) {
+    const int64_t hs = oh * g.sh - g.ph;
+    const int64_t ws = ow * g.sw - g.pw;
+    const int64_t he = std::min(hs + g.kh, g.height + g.ph);
+    const int64_t we = std::min(ws + g.kw, g.width + g.pw);
+    const int64_t poolSize = (he - hs) * (we - ws);
+    *h0 = std::max<int64_t>(hs, 0);
+    *w0 = std::max<int64_t>(ws, 0);
+    *h1 = std::min(he, g.height);
+    *w1 = std::min(we, g.width);
+    if (*h0 >= *h1 || *w0 >= *w1) return 0;
+    if (divisorOverride != 0) return divisorOverride;
+    return countIncludePad ? poolSize : (*h1 - *h0) * (*w1 - *w0);
+}
+
+template <typename scalar_t>
+void avgPoolNhwc(const scalar_t* input, const PoolGeometry& g, bool countIncludePad, int64_t divisorOverride, scalar_t* out) {
+    const int64_t c = g.channels;
+    at::parallel_for(0, g.batch * g.outHeight, 1, [&](int64_t begin, int64_t end) {
+        std::vector<scalar_t> sum(c);
+        for (int64_t row = begin; row < end; ++row) {
+            const int64_t n = row / g.outHeight;
+            const int64_t oh = row % g.outHeight;
+            for (int64_t ow = 0; ow < g.outWidth; ++ow) {
+                int64_t h0, h1, w0, w1;
+                const int64_t divisor = avgPoolDivisor(g, oh, ow, countIncludePad, divisorOverride, &h0, &h1, &w0, &w1);
+                scalar_t* o = out + ((n * g.outHeight + oh) * g.outWidth + ow) * c;
+                if (divisor == 0) {
+                    std::fill(o, o + c, scalar_t(0));
+                    continue;
+                }
+                std::fill(sum.begin(), sum.end(), scalar_t(0));
+                for (int64_t h = h0; h < h1; ++h) {
+                    for (int64_t w = w0; w < w1; ++w) {
+                        const scalar_t* __restrict x = input + ((n * g.height + h) * g.width + w) * c;
+                        scalar_t* __restrict s = sum.data();
+                        for (int64_t ch = 0; ch < c; ++ch) s[ch] += x[ch];
+                    }
+                }
+                const scalar_t scale = scalar_t(1) / static_cast<scalar_t>(divisor);
+                for (int64_t ch = 0; ch < c; ++ch) o[ch] = sum[ch] * scale;
+            }
+        }
+    });
+}
+
+template <typename scalar_t>
+void avgPoolBackwardNhwc(const scalar_t* gradOut, const PoolGeometry& g, bool countIncludePad, int64_t divisorOverride, scalar_t* gradIn) {
+    const int64_t c = g.channels;
+    const int64_t blocks = (c + kPoolChannelBlock - 1) / kPoolChannelBlock;
+    at::parallel_for(0, g.batch * blocks, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / blocks;
+            const int64_t c0 = task % blocks * kPoolChannelBlock;
+            const int64_t width = std::min(c0 + kPoolChannelBlock, c) - c0;
+            scalar_t* image = gradIn + n * g.height * g.width * c + c0;
+            for (int64_t p = 0; p < g.height * g.width; ++p) std::fill(image + p * c, image + p * c + width, scalar_t(0));
+            for (int64_t oh = 0; oh < g.outHeight; ++oh) {
+                for (int64_t ow = 0; ow < g.outWidth; ++ow) {
+                    int64_t h0, h1, w0, w1;
+                    const int64_t divisor = avgPoolDivisor(g, oh, ow, countIncludePad, divisorOverride, &h0, &h1, &w0, &w1);
+                    if (divisor == 0) continue;
+                    const scalar_t scale = scalar_t(1) / static_cast<scalar_t>(divisor);
+                    const scalar_t* go = gradOut + ((n * g.outHeight + oh) * g.outWidth + ow) * c + c0;
+                    for (int64_t h = h0; h < h1; ++h) {
+                        for (int64_t w = w0; w < w1; ++w) {
+                            scalar_t* __restrict x = image + (h * g.width + w) * c;
+                            for (int64_t ch = 0; ch < width; ++ch) x[ch] += go[ch] * scale;
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * Windows of one axis of a separable average pool: output q sums the input over [begin[q], end[q]), clipped to the
+ * input, and contributes factor[q] to the divisor, which is the product of the factors of all axes.
+ */
+struct PoolAxis {
+    std::vector<int64_t> begin;
+    std::vector<int64_t> end;
+    std::vector<int64_t> factor;
+
+    int64_t size() const { return static_cast<int64_t>(begin.size()); }
+};
+
+// avg_pool windows: the divisor counts the padding a window covers when countIncludePad, only the input otherwise
+PoolAxis avgPoolAxis(int64_t in, int64_t kernel, int64_t stride, int64_t pad, bool ceilMode, bool countIncludePad) {
+    PoolAxis axis;
+    const int64_t out = poolOutputSize(in, kernel, pad, stride, 1, ceilMode);
+    for (int64_t q = 0; q < out; ++q) {
+        const int64_t start = q * stride - pad;
+        const int64_t stop = std::min(start + kernel, in + pad);
+        axis.begin.push_back(std::max<int64_t>(start, 0));
+        axis.end.push_back(std::min(stop, in));
+        axis.factor.push_back(countIncludePad ? stop - start : axis.end.back() - axis.begin.back());
+    }
+    return axis;
+}
+
+// adaptive windows [floor(q * in / out), ceil((q + 1) * in / out))
+PoolAxis adaptivePoolAxis(int64_t in, int64_t out) {
+    TORCH_CHECK(in > 0, "adaptive pooling expects non-empty spatial dimensions, but got input size ", in);
+    TORCH_CHECK(out >= 0, "adaptive pooling expects a non-negative output size, but got ", out);
+    PoolAxis axis;
+    for (int64_t q = 0; q < out; ++q) {
+        axis.begin.push_back(q * in / out);
+        axis.end.push_back(((q + 1) * in + out - 1) / out);
+        axis.factor.push_back(axis.end.back() - axis.begin.back());
+    }
+    return axis;
+}
+
+/**
+ * Window sums along the middle axis of src (outer, len, inner) into dst (outer, axis.size(), inner) as differences of
+ * a running sum, whatever the window length. The sums are kept in double, which the differences of long running sums
+ * of fp32 data need.
+ */
+template <typename T>
+void windowSums(const T* src, int64_t outer, int64_t len, int64_t inner, const PoolAxis& axis, double* dst, std::vector<double>& running) {
+    running.assign((len + 1) * inner, 0.0);
+    for (int64_t o = 0; o < outer; ++o) {
+        const T* s = src + o * len * inner;
+        for (int64_t l = 0; l < len; ++l) {
+            const double* __restrict prev = running.data() + l * inner;
+            double* __restrict next = running.data() + (l + 1) * inner;
+            for (int64_t i = 0; i < inner; ++i) next[i] = prev[i] + static_cast<double>(s[l * inner + i]);
+        }
+        double* d = dst + o * axis.size() * inner;
+        for (int64_t q = 0; q < axis.size(); ++q) {
+            const double* hi = running.data() + axis.end[q] * inner;
+            const double* lo = running.data() + axis.begin[q] * inner;
+            for (int64_t i = 0; i < inner; ++i) d[q * inner + i] = axis.begin[q] < axis.end[q] ? hi[i] - lo[i] : 0.0;
+        }
+    }
+}
+
+/**
+ * The transpose of windowSums, for the backward: src (outer, axis.size(), inner) is spread over the windows of dst
+ * (outer, len, inner) by adding at begin and subtracting at end of a difference array and summing it up once.
+ */
+void windowSpread(const double* src, int64_t outer, int64_t len, int64_t inner, const PoolAxis& axis, double* dst, std::vector<double>& difference) {
+    for (int64_t o = 0; o < outer; ++o) {
+        difference.assign((len + 1) * inner, 0.0);
+        const double* s = src + o * axis.size() * inner;
+        for (int64_t q = 0; q < axis.size(); ++q) {
+            if (axis.begin[q] >= axis.end[q]) continue;
+            double* lo = difference.data() + axis.begin[q] * inner;
+            double* hi = difference.data() + axis.end[q] * inner;
+            for (int64_t i = 0; i < inner; ++i) {
+                lo[i] += s[q * inner + i];
+                hi[i] -= s[q * inner + i];
+            }
+        }
+        double* d = dst + o * len * inner;
+        for (int64_t i = 0; i < inner; ++i) d[i] = difference[i];
+        for (int64_t l = 1; l < len; ++l) {
+            for (int64_t i = 0; i < inner; ++i) d[l * inner + i] = d[(l - 1) * inner + i] + difference[l * inner + i];
+        }
+    }
+}
+
+// 1 / divisor of every output of a plane, 0 where a window lies wholly in the padding
+std::vector<double> inverseDivisors(const std::vector<PoolAxis>& axes, int64_t divisorOverride) {
+    std::vector<double> inverse(1, 1.0);
+    std::vector<bool> empty(1, false);
+    for (const auto& axis : axes) {
+        std::vector<double> next;
+        std::vector<bool> nextEmpty;
+        for (size_t p = 0; p < inverse.size(); ++p) {
+            for (int64_t q = 0; q < axis.size(); ++q) {
+                next.push_back(inverse[p] / static_cast<double>(axis.factor[q]));
+                nextEmpty.push_back(empty[p] || axis.begin[q] >= axis.end[q]);
+            }
+        }
+        inverse.swap(next);
+        empty.swap(nextEmpty);
+    }
+    for (size_t p = 0; p < inverse.size(); ++p) {
+        if (empty[p]) {
+            inverse[p] = 0.0;
+        } else if (divisorOverride != 0) {
+            inverse[p] = 1.0 / static_cast<double>(divisorOverride);
+        }
+    }
+    return inverse;
+}
+
+// elements of the largest plane between two passes; adaptive pools may have more outputs than inputs along an axis
+int64_t largestIntermediate(const std::vector<int64_t>& sizes, const std::vector<PoolAxis>& axes) {
+    int64_t largest = 1;
+    for (size_t d = 0; d <= sizes.size(); ++d) {
+        int64_t extent = 1;
+        for (size_t e = 0; e < sizes.size(); ++e) extent *= e < d ? sizes[e] : axes[e].size();
+        largest = std::max(largest, extent);
+    }
+    return largest;
+}
+
+/**
+ * Separable average pool of planes (planes, sizes...), one running-sum pass per axis, last axis first, so the cost per
+ * plane is linear in its size and does not depend on the window. Tasks own whole planes.
+ */
+template <typename scalar_t>
+void separableAvgPool(const scalar_t* input, int64_t planes, const std::vector<int64_t>& sizes, const std::vector<PoolAxis>& axes, int64_t divisorOverride,
+                      scalar_t* out) {
+    const int64_t dims = static_cast<int64_t>(sizes.size());
+    int64_t inPlane = 1, outPlane = 1;
+    for (int64_t d = 0; d < dims; ++d) {
+        inPlane *= sizes[d];
+        outPlane *= axes[d].size();
+    }
+    const int64_t largest = largestIntermediate(sizes, axes);
+    const std::vector<double> inverse = inverseDivisors(axes, divisorOverride);
+    at::parallel_for(0, planes, 1, [&](int64_t begin, int64_t end) {
+        std::vector<double> a(largest), b(largest), running;
+        for (int64_t plane = begin; plane < end; ++plane) {
+            // shape holds the current extents, input sizes before the axis being reduced and output sizes after it
+            std::vector<int64_t> shape(sizes);
+            for (int64_t d = dims - 1; d >= 0; --d) {
+                int64_t outer = 1, inner = 1;
+                for (int64_t e = 0; e < d; ++e) outer *= shape[e];
+                for (int64_t e = d + 1; e < dims; ++e) inner *= shape[e];
+                if (d == dims - 1) {
+                    windowSums(input + plane * inPlane, outer, shape[d], inner, axes[d], a.data(), running);
+                } else {
+                    windowSums(a.data(), outer, shape[d], inner, axes[d], b.data(), running);
+                    a.swap(b);
+                }
+                shape[d] = axes[d].size();
+            }
+            scalar_t* o = out + plane * outPlane;
+            for (int64_t i = 0; i < outPlane; ++i) o[i] = static_cast<scalar_t>(a[i] * inverse[i]);
+        }
+    });
+}
+
+template <typename scalar_t>
+void separableAvgPoolBackward(const scalar_t* gradOut, int64_t planes, const std::vector<int64_t>& sizes, const std::vector<PoolAxis>& axes,
+                              int64_t divisorOverride, scalar_t* gradIn) {
+    const int64_t dims = static_cast<int64_t>(sizes.size());
+    int64_t inPlane = 1, outPlane = 1;
+    for (int64_t d = 0; d < dims; ++d) {
+        inPlane *= sizes[d];
+        outPlane *= axes[d].size();
+    }
+    const int64_t largest = largestIntermediate(sizes, axes);
+    const std::vector<double> inverse = inverseDivisors(axes, divisorOverride);
+    at::parallel_for(0, planes, 1, [&](int64_t begin, int64_t end) {
+        std::vector<double> a(largest), b(largest), difference;
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const scalar_t* g = gradOut + plane * outPlane;
+            for (int64_t i = 0; i < outPlane; ++i) a[i] = static_cast<double>(g[i]) * inverse[i];
+            // shape holds input sizes before the axis being spread and output sizes from it on
+            std::vector<int64_t> shape(dims);
+            for (int64_t d = 0; d < dims; ++d) shape[d] = axes[d].size();
+            for (int64_t d = 0; d < dims; ++d) {
+                int64_t outer = 1, inner = 1;
+                for (int64_t e = 0; e < d; ++e) outer *= shape[e];
+                for (int64_t e = d + 1; e < dims; ++e) inner *= shape[e];
+                windowSpread(a.data(), outer, sizes[d], inner, axes[d], b.data(), difference);
+                a.swap(b);
+                shape[d] = sizes[d];
+            }
+            scalar_t* gi = gradIn + plane * inPlane;
+            for (int64_t i = 0; i < inPlane; ++i) gi[i] = static_cast<scalar_t>(a[i]);
+        }
+    });
+}
+
+// leading (batch and channel) extents and spatial extents of an N-d pool input
+int64_t poolPlanes(const at::Tensor& input, int64_t spatialDims, std::vector<int64_t>* sizes) {
+    const int64_t lead = input.dim() - spatialDims;
+    *sizes = std::vector<int64_t>(input.sizes().begin() + lead, input.sizes().end());
+    int64_t planes = 1;
+    for (int64_t d = 0; d < lead; ++d) planes *= input.size(d);
+    return planes;
+}
+
+std::vector<PoolAxis> avgPoolAxes(const std::vector<int64_t>& sizes, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding, bool ceilMode,
+                                  bool countIncludePad) {
+    std::vector<PoolAxis> axes;
+    for (size_t d = 0; d < sizes.size(); ++d) {
+        const int64_t k = pick(kernel, d, 1);
+        axes.push_back(avgPoolAxis(sizes[d], k, pick(stride, d, k), pick(padding, d, 0), ceilMode, countIncludePad));
+    }
+    return axes;
+}
+
+std::vector<PoolAxis> adaptivePoolAxes(const std::vector<int64_t>& sizes, at::IntArrayRef outputSize) {
+    std::vector<PoolAxis> axes;
+    for (size_t d = 0; d < sizes.size(); ++d) axes.push_back(adaptivePoolAxis(sizes[d], pick(outputSize, d, 1)));
+    return axes;
+}
+
+at::Tensor separableForward(const at::Tensor& input, int64_t spatialDims, const std::vector<PoolAxis>& axes, int64_t divisorOverride) {
+    auto x = input.contiguous();
+    std::vector<int64_t> sizes;
+    const int64_t planes = poolPlanes(x, spatialDims, &sizes);
+    std::vector<int64_t> outSizes(x.sizes().begin(), x.sizes().end() - spatialDims);
+    for (const auto& axis : axes) outSizes.push_back(axis.size());
+    auto out = at::empty(outSizes, x.options());
+    AT_DISPATCH_FLOATING_TYPES(x.scalar_type(), "separableAvgPool", [&] {
+        separableAvgPool<scalar_t>(x.data_ptr<scalar_t>(), planes, sizes, axes, divisorOverride, out.data_ptr<scalar_t>());
+    });
+    return out;
+}
+
+at::Tensor separableBackward(const at::Tensor& gradOutput, const at::Tensor& input, int64_t spatialDims, const std::vector<PoolAxis>& axes,
+                             int64_t divisorOverride) {
+    auto g = gradOutput.contiguous();
+    std::vector<int64_t> sizes;
+    const int64_t planes = poolPlanes(input, spatialDims, &sizes);
+    auto gradInput = at::empty(input.sizes(), g.options());
+    AT_DISPATCH_FLOATING_TYPES(g.scalar_type(), "separableAvgPoolBackward", [&] {
+        separableAvgPoolBackward<scalar_t>(g.data_ptr<scalar_t>(), planes, sizes, axes, divisorOverride, gradInput.data_ptr<scalar_t>());
+    });
+    return gradInput;
+}
+
+at::Tensor emptyNhwc(const at::Tensor& like, const PoolGeometry& g, at::ScalarType dtype) {
+    return at::empty({g.batch, g.channels, g.outHeight, g.outWidth}, like.options().dtype(dtype).memory_format(at::MemoryFormat::ChannelsLast));
+}
+
+}  // namespace
+
+bool hostPoolSupported(const at::Tensor& input) {
+    return input.is_cpu() && input.dim() == 4 && (input.scalar_type() == at::kFloat || input.scalar_type() == at::kDouble);
+}
+
+int64_t poolWindowTaps(at::IntArrayRef kernel) {
+    return kernel.size() == 1 ? kernel[0] * kernel[0] : kernel[0] * kernel[1];
+}
+
+std::tuple<at::Tensor, at::Tensor> maxPool2dNhwc(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding,
+        at::IntArrayRef dilation, bool ceilMode, bool withIndices, at::ScalarType indexType) {
+    auto x = input.contiguous(at::MemoryFormat::ChannelsLast);
+    const PoolGeometry g = poolGeometry(x, kernel, stride, padding, dilation, ceilMode);
+    auto out = emptyNhwc(x, g, x.scalar_type());
+    auto indices = withIndices ? emptyNhwc(x, g, indexType) : at::Tensor();
+    AT_DISPATCH_FLOATING_TYPES(x.scalar_type(), "maxPool2dNhwc", [&] {
+        if (!withIndices) {
+            maxPoolNhwc<scalar_t, int64_t, false>(x.data_ptr<scalar_t>(), g, out.data_ptr<scalar_t>(), nullptr);
+        } else if (indexType == at::kChar) {
+            maxPoolNhwc<scalar_t, int8_t, true>(x.data_ptr<scalar_t>(), g, out.data_ptr<scalar_t>(), indices.data_ptr<int8_t>());
+        } else {
+            maxPoolNhwc<scalar_t, int64_t, false>(x.data_ptr<scalar_t>(), g, out.data_ptr<scalar_t>(), indices.data_ptr<int64_t>());
+        }
+    });
+    return std::make_tuple(out, indices);
+}
+
+at::Tensor maxPool2dBackwardNhwc(const at::Tensor& gradOutput, const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride,
+        at::IntArrayRef padding, at::IntArrayRef dilation, bool ceilMode, const at::Tensor& indices) {
+    const PoolGeometry g = poolGeometry(input, kernel, stride, padding, dilation, ceilMode);
+    auto go = gradOutput.contiguous(at::MemoryFormat::ChannelsLast);
+    auto idx = indices.contiguous(at::MemoryFormat::ChannelsLast);
+    auto gradInput = at::empty(input.sizes(), go.options().memory_format(at::MemoryFormat::ChannelsLast));
+    AT_DISPATCH_FLOATING_TYPES(go.scalar_type(), "maxPool2dBackwardNhwc", [&] {
+        if (idx.scalar_type() == at::kChar) {
+            maxPoolBackwardNhwc<scalar_t, int8_t, true>(go.data_ptr<scalar_t>(), idx.data_ptr<int8_t>(), g, gradInput.data_ptr<scalar_t>());
+        } else {
+            maxPoolBackwardNhwc<scalar_t, int64_t, false>(go.data_ptr<scalar_t>(), idx.data_ptr<int64_t>(), g, gradInput.data_ptr<scalar_t>());
+        }
+    });
+    return gradInput;
+}
+
+at::Tensor avgPool2dNhwc(const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding, bool ceilMode,
+        bool countIncludePad, c10::optional<int64_t> divisorOverride) {
+    auto x = input.contiguous(at::MemoryFormat::ChannelsLast);
+    const PoolGeometry g = poolGeometry(x, kernel, stride, padding, at::IntArrayRef(), ceilMode);
+    auto out = emptyNhwc(x, g, x.scalar_type());
+    AT_DISPATCH_FLOATING_TYPES(x.scalar_type(), "avgPool2dNhwc", [&] {
+        avgPoolNhwc<scalar_t>(x.data_ptr<scalar_t>(), g, countIncludePad, divisorOverride.value_or(0), out.data_ptr<scalar_t>());
+    });
+    return out;
+}
+
+at::Tensor avgPool2dBackwardNhwc(const at::Tensor& gradOutput, const at::Tensor& input, at::IntArrayRef kernel, at::IntArrayRef stride,
+        at::IntArrayRef padding, bool ceilMode, bool countIncludePad, c10::optional<int64_t> divisorOverride) {
+    const PoolGeometry g = poolGeometry(input, kernel, stride, padding, at::IntArrayRef(), ceilMode);
+    auto go = gradOutput.contiguous(at::MemoryFormat::ChannelsLast);
+    auto gradInput = at::empty(input.sizes(), go.options().memory_format(at::MemoryFormat::ChannelsLast));
+    AT_DISPATCH_FLOATING_TYPES(go.scalar_type(), "avgPool2dBackwardNhwc", [&] {
+        avgPoolBackwardNhwc<scalar_t>(go.data_ptr<scalar_t>(), g, countIncludePad, divisorOverride.value_or(0), gradInput.data_ptr<scalar_t>());
+    });
+    return gradInput;
+}
+
+bool separableAvgPoolSupported(const at::Tensor& input, int64_t spatialDims, at::IntArrayRef kernel) {
+    if (!separableAvgPoolEnabled() || !input.is_cpu() || (input.scalar_type() != at::kFloat && input.scalar_type() != at::kDouble)) return false;
+    if (input.dim() != spatialDims + 1 && input.dim() != spatialDims + 2) return false;
+    if (kernel.empty()) return true;
+    int64_t taps = 1;
+    for (int64_t d = 0; d < spatialDims; ++d) taps *= pick(kernel, d, 1);
+    return taps >= kSeparablePoolTaps;
+}
+
+at::Tensor avgPoolSeparable(const at::Tensor& input, int64_t spatialDims, at::IntArrayRef kernel, at::IntArrayRef stride, at::IntArrayRef padding,
+        bool ceilMode, bool countIncludePad, c10::optional<int64_t> divisorOverride) {
+    std::vector<int64_t> sizes;
+    poolPlanes(input, spatialDims, &sizes);
+    return separableForward(input, spatialDims, avgPoolAxes(sizes, kernel, stride, padding, ceilMode, countIncludePad), divisorOverride.value_or(0));
+}
+
+at::Tensor avgPoolSeparableBackward(const at::Tensor& gradOutput, const at::Tensor& input, int64_t spatialDims, at::IntArrayRef kernel,
+        at::IntArrayRef stride, at::IntArrayRef padding, bool ceilMode, bool countIncludePad, c10::optional<int64_t> divisorOverride) {
+    std::vector<int64_t> sizes;
+    poolPlanes(input, spatialDims, &sizes);
+    return separableBackward(
+        gradOutput, input, spatialDims, avgPoolAxes(sizes, kernel, stride, padding, ceilMode, countIncludePad), divisorOverride.value_or(0));
+}
+
+at::Tensor adaptiveAvgPoolSeparable(const at::Tensor& input, int64_t spatialDims, at::IntArrayRef outputSize) {
+    std::vector<int64_t> sizes;
+    poolPlanes(input, spatialDims, &sizes);
+    return separableForward(input, spatialDims, adaptivePoolAxes(sizes, outputSize), 0);
+}
+
+at::Tensor adaptiveAvgPoolSeparableBackward(const at::Tensor& gradOutput, const at::Tensor& input, int64_t spatialDims) {
+    std::vector<int64_t> sizes;
+    poolPlanes(input, spatialDims, &sizes);
+    auto outputSize = gradOutput.sizes().slice(gradOutput.dim() - spatialDims);
+    return separableBackward(gradOutput, input, spatialDims, adaptivePoolAxes(sizes, outputSize), 0);
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
@@ -0,0 +1,326 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// axis tables a process keeps; a network upsamples a handful of shapes, so the limit is only a guard
+constexpr size_t kMaxUpsampleAxes = 256;
+// elements a parallel task should at least touch
+constexpr int64_t kUpsampleGrain = 32768;
+
+/**
+ * One axis of an upsample. Output j reads index0[j] and index1[j] weighted by lambda0[j] and lambda1[j]; nearest only
+ * uses index0 with weight 1. The backward reads the same map transposed: input i sums the outputs sources[k] weighted
+ * by weights[k] for k in [offsets[i], offsets[i + 1]), in increasing output order, so its result never depends on
+ * scheduling.
+ */
+struct UpsampleAxis {
+    int64_t in;
+    int64_t out;
+    bool linear;
+    // output j is input j with weight 1, so the pass is skipped
+    bool identity;
+    std::vector<int64_t> index0;
+    std::vector<int64_t> index1;
+    std::vector<double> lambda0;
+    std::vector<double> lambda1;
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> sources;
+    std::vector<double> weights;
+};
+
+// at::native nearest_idx: the source of output j is floor(j * in / out) with the scale rounded to float
+int64_t nearestIndex(int64_t j, int64_t in, int64_t out) {
+    if (out == in) return j;
+    if (out == 2 * in) return j >> 1;
+    const float scale = static_cast<float>(in) / static_cast<float>(out);
+    return std::min(static_cast<int64_t>(std::floor(static_cast<float>(j) * scale)), in - 1);
+}
+
+// at::native area_pixel_compute_source_index and guard_index_and_lambda, in the accumulation type ATen uses for the dtype
+template <typename opmath_t>
+void linearIndex(int64_t j, int64_t in, int64_t out, bool alignCorners, int64_t* index, double* lambda) {
+    opmath_t real;
+    if (alignCorners) {
+        const opmath_t scale = out > 1 ? static_cast<opmath_t>(in - 1) / static_cast<opmath_t>(out - 1) : opmath_t(0);
+        real = scale * static_cast<opmath_t>(j);
+    } else {
+        const opmath_t scale = static_cast<opmath_t>(in) / static_cast<opmath_t>(out);
+        real = std::max(scale * (static_cast<opmath_t>(j) + opmath_t(0.5)) - opmath_t(0.5), opmath_t(0));
+    }
+    *index = std::min(static_cast<int64_t>(std::floor(real)), in - 1);
+    *lambda = static_cast<double>(std::min(std::max(real - static_cast<opmath_t>(*index), opmath_t(0)), opmath_t(1)));
+}
+
+std::shared_ptr<const UpsampleAxis> buildAxis(int64_t in, int64_t out, bool linear, bool alignCorners, at::ScalarType dtype) {
+    auto axis = std::make_shared<UpsampleAxis>();
+    axis->in = in;
+    axis->out = out;
+    axis->linear = linear;
+    axis->identity = in == out;
+    for (int64_t j = 0; j < out; ++j) {
+        int64_t i0 = 0;
+        double l1 = 0.0;
+        if (!linear) {
+            i0 = nearestIndex(j, in, out);
+        } else if (dtype == at::kDouble) {
+            linearIndex<double>(j, in, out, alignCorners, &i0, &l1);
+        } else {
+            linearIndex<float>(j, in, out, alignCorners, &i0, &l1);
+        }
+        axis->index0.push_back(i0);
+        axis->index1.push_back(i0 + (i0 < in - 1 ? 1 : 0));
+        axis->lambda0.push_back(1.0 - l1);
+        axis->lambda1.push_back(l1);
+        axis->identity = axis->identity && i0 == j && l1 == 0.0;
+    }
+    // counting sort of the (output, weight) pairs by input keeps every bucket in output order
+    std::vector<int64_t> counts(in + 1, 0);
+    for (int64_t j = 0; j < out; ++j) {
+        ++counts[axis->index0[j] + 1];
+        if (linear) ++counts[axis->index1[j] + 1];
+    }
+    for (int64_t i = 0; i < in; ++i) counts[i + 1] += counts[i];
+    axis->offsets = counts;
+    axis->sources.resize(counts[in]);
+    axis->weights.resize(counts[in]);
+    for (int64_t j = 0; j < out; ++j) {
+        const int64_t k0 = counts[axis->index0[j]]++;
+        axis->sources[k0] = j;
+        axis->weights[k0] = axis->lambda0[j];
+        if (!linear) continue;
+        const int64_t k1 = counts[axis->index1[j]]++;
+        axis->sources[k1] = j;
+        axis->weights[k1] = axis->lambda1[j];
+    }
+    return axis;
+}
+
+/**
+ * Axis tables by (in, out, align_corners, mode, dtype). The tables only depend on the key, so an entry is never stale;
+ * when the limit is reached the cache starts over.
+ */
+class UpsampleAxisCache {
+public:
+    static UpsampleAxisCache& instance() {
+        static UpsampleAxisCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const UpsampleAxis> get(int64_t in, int64_t out, UpsampleMode mode, bool alignCorners, at::ScalarType dtype) {
+        const bool linear = mode == UpsampleMode::Linear;
+        // nearest does not look at align_corners, nor at the dtype
+        const Key key(in, out, linear && alignCorners, linear, linear ? dtype : at::kFloat);
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) return it->second;
+        if (entries_.size() == kMaxUpsampleAxes) entries_.clear();
+        auto axis = buildAxis(in, out, linear, alignCorners, dtype);
+        entries_.emplace(key, axis);
+        return axis;
+    }
+
+private:
+    using Key = std::tuple<int64_t, int64_t, bool, bool, at::ScalarType>;
+
+    std::mutex mutex_;
+    std::map<Key, std::shared_ptr<const UpsampleAxis>> entries_;
+};
+
+// src (outer, axis.in, inner) into dst (outer, axis.out, inner); with inner 1 this is a gather along the rows
+template <typename scalar_t>
+void interpolateAxis(const scalar_t* src, int64_t outer, int64_t inner, const UpsampleAxis& axis, scalar_t* dst) {
+    for (int64_t o = 0; o < outer; ++o) {
+        const scalar_t* s = src + o * axis.in * inner;
+        scalar_t* d = dst + o * axis.out * inner;
+        for (int64_t j = 0; j < axis.out; ++j) {
+            const scalar_t* __restrict a = s + axis.index0[j] * inner;
+            scalar_t* __restrict r = d + j * inner;
+            if (!axis.linear) {
+                if (inner == 1) {
+                    *r = *a;
+                } else {
+                    std::memcpy(r, a, inner * sizeof(scalar_t));
+                }
+                continue;
+            }
+            const scalar_t* __restrict b = s + axis.index1[j] * inner;
+            const scalar_t l0 = static_cast<scalar_t>(axis.lambda0[j]);
+            const scalar_t l1 = static_cast<scalar_t>(axis.lambda1[j]);
+            for (int64_t i = 0; i < inner; ++i) r[i] = l0 * a[i] + l1 * b[i];
+        }
+    }
+}
+
+// the transpose of interpolateAxis: src (outer, axis.out, inner) gathered into dst (outer, axis.in, inner)
+template <typename scalar_t>
+void accumulateAxis(const scalar_t* src, int64_t outer, int64_t inner, const UpsampleAxis& axis, scalar_t* dst) {
+    for (int64_t o = 0; o < outer; ++o) {
+        const scalar_t* s = src + o * axis.out * inner;
+        scalar_t* d = dst + o * axis.in * inner;
+        for (int64_t i = 0; i < axis.in; ++i) {
+            scalar_t* __restrict r = d + i * inner;
+            std::fill(r, r + inner, scalar_t(0));
+            for (int64_t k = axis.offsets[i]; k < axis.offsets[i + 1]; ++k) {
+                const scalar_t* __restrict a = s + axis.sources[k] * inner;
+                const scalar_t w = static_cast<scalar_t>(axis.weights[k]);
+                for (int64_t e = 0; e < inner; ++e) r[e] += w * a[e];
+            }
+        }
+    }
+}
+
+std::vector<std::shared_ptr<const UpsampleAxis>> upsampleAxes(at::IntArrayRef inSizes, at::IntArrayRef outSizes, UpsampleMode mode, bool alignCorners,
+                                                              at::ScalarType dtype) {
+    std::vector<std::shared_ptr<const UpsampleAxis>> axes;
+    for (size_t d = 0; d < inSizes.size(); ++d) {
+        axes.push_back(UpsampleAxisCache::instance().get(inSizes[d], outSizes[d], mode, alignCorners, dtype));
+    }
+    return axes;
+}
+
+// elements of the largest plane between two passes
+int64_t largestPlane(const std::vector<std::shared_ptr<const UpsampleAxis>>& axes) {
+    int64_t largest = 1;
+    for (size_t d = 0; d <= axes.size(); ++d) {
+        int64_t extent = 1;
+        for (size_t e = 0; e < axes.size(); ++e) extent *= e < d ? axes[e]->in : axes[e]->out;
+        largest = std::max(largest, extent);
+    }
+    return largest;
+}
+
+/**
+ * Separable upsample of planes, one pass per axis, last axis first: the last pass is a gather along rows and the others
+ * blend whole rows, which vectorizes. Every pass but the last goes to a buffer of the task, the last to the output.
+ */
+template <typename scalar_t>
+void upsamplePlanes(const scalar_t* input, int64_t planes, const std::vector<std::shared_ptr<const UpsampleAxis>>& axes, scalar_t* out) {
+    const int64_t dims = static_cast<int64_t>(axes.size());
+    std::vector<int64_t> passes;
+    int64_t inPlane = 1, outPlane = 1;
+    for (int64_t d = dims - 1; d >= 0; --d) {
+        if (!axes[d]->identity) passes.push_back(d);
+        inPlane *= axes[d]->in;
+        outPlane *= axes[d]->out;
+    }
+    const int64_t largest = largestPlane(axes);
+    const int64_t grain = std::max<int64_t>(1, kUpsampleGrain / std::max<int64_t>(1, largest));
+    at::parallel_for(0, planes, grain, [&](int64_t begin, int64_t end) {
+        std::vector<scalar_t> a(passes.size() > 1 ? largest : 0), b(passes.size() > 2 ? largest : 0);
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const scalar_t* src = input + plane * inPlane;
+            scalar_t* dst = out + plane * outPlane;
+            if (passes.empty()) {
+                std::memcpy(dst, src, outPlane * sizeof(scalar_t));
+                continue;
+            }
+            // extents: output sizes after the axes already done, input sizes up to and including the current one
+            std::vector<int64_t> shape(dims);
+            for (int64_t d = 0; d < dims; ++d) shape[d] = axes[d]->in;
+            for (size_t p = 0; p < passes.size(); ++p) {
+                const int64_t d = passes[p];
+                int64_t outer = 1, inner = 1;
+                for (int64_t e = 0; e < d; ++e) outer *= shape[e];
+                for (int64_t e = d + 1; e < dims; ++e) inner *= shape[e];
+                scalar_t* next = p + 1 == passes.size() ? dst : (p % 2 == 0 ? a.data() : b.data());
+                interpolateAxis(src, outer, inner, *axes[d], next);
+                shape[d] = axes[d]->out;
+                src = next;
+            }
+        }
+    });
+}
+
+// the backward runs the transposed passes in the opposite order, first axis first
+template <typename scalar_t>
+void upsamplePlanesBackward(const scalar_t* gradOut, int64_t planes, const std::vector<std::shared_ptr<const UpsampleAxis>>& axes, scalar_t* gradIn) {
+    const int64_t dims = static_cast<int64_t>(axes.size());
+    std::vector<int64_t> passes;
+    int64_t inPlane = 1, outPlane = 1;
+    for (int64_t d = 0; d < dims; ++d) {
+        if (!axes[d]->identity) passes.push_back(d);
+        inPlane *= axes[d]->in;
+        outPlane *= axes[d]->out;
+    }
+    const int64_t largest = largestPlane(axes);
+    const int64_t grain = std::max<int64_t>(1, kUpsampleGrain / std::max<int64_t>(1, largest));
+    at::parallel_for(0, planes, grain, [&](int64_t begin, int64_t end) {
+        std::vector<scalar_t> a(passes.size() > 1 ? largest : 0), b(passes.size() > 2 ? largest : 0);
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const scalar_t* src = gradOut + plane * outPlane;
+            scalar_t* dst = gradIn + plane * inPlane;
+            if (passes.empty()) {
+                std::memcpy(dst, src, inPlane * sizeof(scalar_t));
+                continue;
+            }
+            // extents: input sizes before the current axis, output sizes from it on
+            std::vector<int64_t> shape(dims);
+            for (int64_t d = 0; d < dims; ++d) shape[d] = axes[d]->out;
+            for (size_t p = 0; p < passes.size(); ++p) {
+                const int64_t d = passes[p];
+                int64_t outer = 1, inner = 1;
+                for (int64_t e = 0; e < d; ++e) outer *= shape[e];
+                for (int64_t e = d + 1; e < dims; ++e) inner *= shape[e];
+                scalar_t* next = p + 1 == passes.size() ? dst : (p % 2 == 0 ? a.data() : b.data());
+                accumulateAxis(src, outer, inner, *axes[d], next);
+                shape[d] = axes[d]->in;
+                src = next;
+            }
+        }
+    });
+}
+
+}  // namespace
+
+bool upsampleSupported(const at::Tensor& input) {
+    return input.is_cpu() && (input.scalar_type() == at::kFloat || input.scalar_type() == at::kDouble) && input.dim() >= 3 && input.dim() <= 5 &&
+           input.is_contiguous();
+}
+
+at::Tensor upsample(const at::Tensor& input, at::IntArrayRef outputSize, UpsampleMode mode, bool alignCorners) {
+    const int64_t spatialDims = input.dim() - 2;
+    auto inSizes = input.sizes().slice(2);
+    std::vector<int64_t> outSizes = {input.size(0), input.size(1)};
+    for (int64_t d = 0; d < spatialDims; ++d) outSizes.push_back(outputSize[d]);
+    auto out = at::empty(outSizes, input.options());
+    auto axes = upsampleAxes(inSizes, at::IntArrayRef(outSizes).slice(2), mode, alignCorners, input.scalar_type());
+    AT_DISPATCH_FLOATING_TYPES(input.scalar_type(), "upsample", [&] {
+        upsamplePlanes<scalar_t>(input.data_ptr<scalar_t>(), input.size(0) * input.size(1), axes, out.data_ptr<scalar_t>());
+    });
+    return out;
+}
+
+at::Tensor upsampleBackward(const at::Tensor& gradOutput, at::IntArrayRef inputSize, UpsampleMode mode, bool alignCorners) {
+    auto axes = upsampleAxes(inputSize.slice(2), gradOutput.sizes().slice(2), mode, alignCorners, gradOutput.scalar_type());
+    auto gradInput = at::empty(inputSize, gradOutput.options());
+    AT_DISPATCH_FLOATING_TYPES(gradOutput.scalar_type(), "upsampleBackward", [&] {
+        upsamplePlanesBackward<scalar_t>(gradOutput.data_ptr<scalar_t>(), gradOutput.size(0) * gradOutput.size(1), axes, gradInput.data_ptr<scalar_t>());
+    });
+    return gradInput;
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl
@@ -0,0 +1,303 @@
+/**
+ * @file
+ * @author DeepLink
+ * @copyright  (c) 2023, DeepLink.
+ */
+
+#include <ATen/Parallel.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "host_kernel.h"
+
+namespace impl {
+namespace aten {
+namespace host {
+
+namespace {
+
+// tiles transformed together; the GEMM rows are this long, so the accumulators of a row block stay in registers
+constexpr int64_t kWinogradTiles = 16;
+
+/**
+ * Transform matrices of Lavin & Gray. Y = At [(G g Gt) * (Bt d B)] A for a 3x3 filter g, an Alpha x Alpha input tile d
+ * and a Tile x Tile output tile Y.
+ */
+template <int64_t Tile>
+struct Winograd;
+
+template <>
+struct Winograd<2> {
+    static constexpr int64_t kTile = 2;
+    static constexpr int64_t kAlpha = 4;
+    static float bt(int64_t i, int64_t j) {
+        static constexpr float m[4][4] = {{1, 0, -1, 0}, {0, 1, 1, 0}, {0, -1, 1, 0}, {0, 1, 0, -1}};
+        return m[i][j];
+    }
+    static float g(int64_t i, int64_t j) {
+        static constexpr float m[4][3] = {{1, 0, 0}, {0.5f, 0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0, 0, 1}};
+        return m[i][j];
+    }
+    static float at(int64_t i, int64_t j) {
+        static constexpr float m[2][4] = {{1, 1, 1, 0}, {0, 1, -1, -1}};
+        return m[i][j];
+    }
+};
+
+template <>
+struct Winograd<4> {
+    static constexpr int64_t kTile = 4;
+    static constexpr int64_t kAlpha = 6;
+    static float bt(int64_t i, int64_t j) {
+        static constexpr float m[6][6] = {{4, 0, -5, 0, 1, 0},
+                                          {0, -4, -4, 1, 1, 0},
+                                          {0, 4, -4, -1, 1, 0},
+                                          {0, -2, -1, 2, 1, 0},
+                                          {0, 2, -1, -2, 1, 0},
+                                          {0, 4, 0, -5, 0, 1}};
+        return m[i][j];
+    }
+    static float g(int64_t i, int64_t j) {
+        static constexpr float m[6][3] = {{1.f / 4, 0, 0},
+                                          {-1.f / 6, -1.f / 6, -1.f / 6},
+                                          {-1.f / 6, 1.f / 6, -1.f / 6},
+                                          {1.f / 24, 1.f / 12, 1.f / 6},
+                                          {1.f / 24, -1.f / 12, 1.f / 6},
+                                          {0, 0, 1}};
+        return m[i][j];
+    }
+    static float at(int64_t i, int64_t j) {
+        static constexpr float m[4][6] = {{1, 1, 1, 1, 1, 0}, {0, 1, -1, 2, -2, 0}, {0, 1, 1, 4, 4, 0}, {0, 1, -1, 8, -8, 1}};
+        return m[i][j];
+    }
+};
+
+struct WinogradShape {
+    int64_t channels;     // per group
+    int64_t outChannels;  // per group
+    int64_t groups;
+    int64_t height;
+    int64_t width;
+    int64_t outHeight;
+    int64_t outWidth;
+    int64_t padH;
+    int64_t padW;
+    int64_t tilesH;
+    int64_t tilesW;
+};
+
+template <typename W>
+void transformFilterImpl(const float* weight, int64_t outChannels, int64_t channels, float* transformed) {
+    constexpr int64_t a = W::kAlpha;
+    at::parallel_for(0, outChannels, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; ++k) {
+            for (int64_t c = 0; c < channels; ++c) {
+                const float* g = weight + (k * channels + c) * 9;
+                float t[a][3];
+                for (int64_t i = 0; i < a; ++i) {
+                    for (int64_t j = 0; j < 3; ++j) {
+                        t[i][j] = W::g(i, 0) * g[j] + W::g(i, 1) * g[3 + j] + W::g(i, 2) * g[6 + j];
+                    }
+                }
+                for (int64_t i = 0; i < a; ++i) {
+                    for (int64_t j = 0; j < a; ++j) {
+                        transformed[((i * a + j) * outChannels + k) * channels + c] = t[i][0] * W::g(j, 0) + t[i][1] * W::g(j, 1) + t[i][2] * W::g(j, 2);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// Bt d B for tiles [first, first + count) of one channel plane; v is (Alpha^2, channels, kWinogradTiles)
+template <typename W>
+void transformInput(const float* plane, const WinogradShape& s, int64_t first, int64_t count, int64_t channel, float* v) {
+    constexpr int64_t a = W::kAlpha;
+    // both passes run across the tiles of the block, one lane per tile; the zeros of Bt are skipped
+    float d[a][a][kWinogradTiles];
+    for (int64_t p = 0; p < kWinogradTiles; ++p) {
+        const int64_t y0 = (first + p) / s.tilesW * W::kTile - s.padH;
+        const int64_t x0 = (first + p) % s.tilesW * W::kTile - s.padW;
+        const bool inside = p < count && y0 >= 0 && y0 + a <= s.height && x0 >= 0 && x0 + a <= s.width;
+        for (int64_t i = 0; i < a; ++i) {
+            const bool rowInside = p < count && y0 + i >= 0 && y0 + i < s.height;
+            for (int64_t j = 0; j < a; ++j) {
+                d[i][j][p] = inside || (rowInside && x0 + j >= 0 && x0 + j < s.width) ? plane[(y0 + i) * s.width + x0 + j] : 0.f;
+            }
+        }
+    }
+    float t[a][a][kWinogradTiles];
+    for (int64_t i = 0; i < a; ++i) {
+        for (int64_t j = 0; j < a; ++j) {
+            float acc[kWinogradTiles] = {};
+            for (int64_t k = 0; k < a; ++k) {
+                const float b = W::bt(i, k);
+                if (b == 0.f) continue;
+                for (int64_t p = 0; p < kWinogradTiles; ++p) acc[p] += b * d[k][j][p];
+            }
+            std::copy(acc, acc + kWinogradTiles, t[i][j]);
+        }
+    }
+    for (int64_t i = 0; i < a; ++i) {
+        for (int64_t j = 0; j < a; ++j) {
+            float* __restrict out = v + ((i * a + j) * s.channels + channel) * kWinogradTiles;
+            float acc[kWinogradTiles] = {};
+            for (int64_t k = 0; k < a; ++k) {
+                const float b = W::bt(j, k);
+                if (b == 0.f) continue;
+                for (int64_t p = 0; p < kWinogradTiles; ++p) acc[p] += b * t[i][k][p];
+            }
+            std::copy(acc, acc + kWinogradTiles, out);
+        }
+    }
+}
+
+// m[k][p] = sum over c of u[k][c] * v[c][p], one (outChannels x channels) by (channels x kWinogradTiles) product
+void winogradGemm(const float* __restrict u, const float* __restrict v, float* __restrict m, int64_t outChannels, int64_t channels) {
+    int64_t k = 0;
+    // four rows per pass over v, spelled out: as a loop over rows -O3 reorders it and spills the accumulators
+    for (; k + 4 <= outChannels; k += 4) {
+        const float* u0 = u + k * channels;
+        const float* u1 = u0 + channels;
+        const float* u2 = u1 + channels;
+        const float* u3 = u2 + channels;
+        float a0[kWinogradTiles] = {}, a1[kWinogradTiles] = {}, a2[kWinogradTiles] = {}, a3[kWinogradTiles] = {};
+        for (int64_t c = 0; c < channels; ++c) {
+            const float* row = v + c * kWinogradTiles;
+            const float x0 = u0[c], x1 = u1[c], x2 = u2[c], x3 = u3[c];
+            for (int64_t p = 0; p < kWinogradTiles; ++p) {
+                a0[p] += x0 * row[p];
+                a1[p] += x1 * row[p];
+                a2[p] += x2 * row[p];
+                a3[p] += x3 * row[p];
+            }
+        }
+        float* out = m + k * kWinogradTiles;
+        std::copy(a0, a0 + kWinogradTiles, out);
+        std::copy(a1, a1 + kWinogradTiles, out + kWinogradTiles);
+        std::copy(a2, a2 + kWinogradTiles, out + 2 * kWinogradTiles);
+        std::copy(a3, a3 + kWinogradTiles, out + 3 * kWinogradTiles);
+    }
+    for (; k < outChannels; ++k) {
+        float acc[kWinogradTiles] = {};
+        for (int64_t c = 0; c < channels; ++c) {
+            const float uc = u[k * channels + c];
+            for (int64_t p = 0; p < kWinogradTiles; ++p) acc[p] += uc * v[c * kWinogradTiles + p];
+        }
+        std::copy(acc, acc + kWinogradTiles, m + k * kWinogradTiles);
+    }
+}
+
+// At m A plus bias for tiles [first, first + count) of one output plane; m is (Alpha^2, outChannels, kWinogradTiles)
+template <typename W>
+void transformOutput(const float* m, const WinogradShape& s, int64_t first, int64_t count, int64_t channel, float bias, float* plane) {
+    constexpr int64_t a = W::kAlpha;
+    constexpr int64_t tile = W::kTile;
+    float t[tile][a][kWinogradTiles];
+    for (int64_t i = 0; i < tile; ++i) {
+        for (int64_t j = 0; j < a; ++j) {
+            float acc[kWinogradTiles] = {};
+            for (int64_t k = 0; k < a; ++k) {
+                const float c = W::at(i, k);
+                if (c == 0.f) continue;
+                const float* __restrict row = m + ((k * a + j) * s.outChannels + channel) * kWinogradTiles;
+                for (int64_t p = 0; p < kWinogradTiles; ++p) acc[p] += c * row[p];
+            }
+            std::copy(acc, acc + kWinogradTiles, t[i][j]);
+        }
+    }
+    float y[tile][tile][kWinogradTiles];
+    for (int64_t i = 0; i < tile; ++i) {
+        for (int64_t j = 0; j < tile; ++j) {
+            float acc[kWinogradTiles];
+            std::fill(acc, acc + kWinogradTiles, bias);
+            for (int64_t k = 0; k < a; ++k) {
+                const float c = W::at(j, k);
+                if (c == 0.f) continue;
+                for (int64_t p = 0; p < kWinogradTiles; ++p) acc[p] += c * t[i][k][p];
+            }
+            std::copy(acc, acc + kWinogradTiles, y[i][j]);
+        }
+    }
+    for (int64_t p = 0; p < count; ++p) {
+        const int64_t y0 = (first + p) / s.tilesW * tile;
+        const int64_t x0 = (first + p) % s.tilesW * tile;
+        for (int64_t i = 0; i < tile && y0 + i < s.outHeight; ++i) {
+            for (int64_t j = 0; j < tile && x0 + j < s.outWidth; ++j) {
+                plane[(y0 + i) * s.outWidth + x0 + j] = y[i][j][p];
+            }
+        }
+    }
+}
+
+template <typename W>
+void winogradImpl(const float* input, const float* transformed, const float* bias, float* output, int64_t batch, const WinogradShape& s) {
+    constexpr int64_t a2 = W::kAlpha * W::kAlpha;
+    const int64_t tiles = s.tilesH * s.tilesW;
+    const int64_t blocks = (tiles + kWinogradTiles - 1) / kWinogradTiles;
+    const int64_t allOutChannels = s.outChannels * s.groups;
+    at::parallel_for(0, batch * s.groups * blocks, 1, [&](int64_t begin, int64_t end) {
+        std::vector<float> v(a2 * s.channels * kWinogradTiles);
+        std::vector<float> m(a2 * s.outChannels * kWinogradTiles);
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / (s.groups * blocks);
+            const int64_t g = task / blocks % s.groups;
+            const int64_t first = task % blocks * kWinogradTiles;
+            const int64_t count = std::min(kWinogradTiles, tiles - first);
+            const float* image = input + (n * s.groups + g) * s.channels * s.height * s.width;
+            for (int64_t c = 0; c < s.channels; ++c) {
+                transformInput<W>(image + c * s.height * s.width, s, first, count, c, v.data());
+            }
+            for (int64_t xi = 0; xi < a2; ++xi) {
+                winogradGemm(transformed + (xi * allOutChannels + g * s.outChannels) * s.channels,
+                             v.data() + xi * s.channels * kWinogradTiles,
+                             m.data() + xi * s.outChannels * kWinogradTiles,
+                             s.outChannels,
+                             s.channels);
+            }
+            float* out = output + (n * s.groups + g) * s.outChannels * s.outHeight * s.outWidth;
+            for (int64_t k = 0; k < s.outChannels; ++k) {
+                const float b = bias == nullptr ? 0.f : bias[g * s.outChannels + k];
+                transformOutput<W>(m.data(), s, first, count, k, b, out + k * s.outHeight * s.outWidth);
+            }
+        }
+    });
+}
+
+}  // namespace
+
+int64_t winogradFilterNumel(int64_t tile, int64_t outChannels, int64_t channels) { return (tile + 2) * (tile + 2) * outChannels * channels; }
+
+void winogradTransformFilter(int64_t tile, const float* weight, int64_t outChannels, int64_t channels, float* transformed) {
+    if (tile == 4) {
+        transformFilterImpl<Winograd<4>>(weight, outChannels, channels, transformed);
+    } else {
+        transformFilterImpl<Winograd<2>>(weight, outChannels, channels, transformed);
+    }
+}
+
+void winogradConvolution(int64_t tile, const float* input, const float* transformed, const float* bias, float* output, int64_t batch, int64_t channels,
+        int64_t height, int64_t width, int64_t outChannels, int64_t groups, int64_t padH, int64_t padW) {
+    WinogradShape s;
+    s.channels = channels / groups;
+    s.outChannels = outChannels / groups;
+    s.groups = groups;
+    s.height = height;
+    s.width = width;
+    s.outHeight = height + 2 * padH - 2;
+    s.outWidth = width + 2 * padW - 2;
+    s.padH = padH;
+    s.padW = padW;
+    s.tilesH = (s.outHeight + tile - 1) / tile;
+    s.tilesW = (s.outWidth + tile - 1) / tile;
+    if (tile == 4) {
+        winogradImpl<Winograd<4>>(input, transformed, bias, output, batch, s);
+    } else {
+        winogradImpl<Winograd<2>>(input, transformed, bias, output, batch, s);
+    }
+}
+
+}  // namespace host
+}  // namespace aten
+}  // namespace impl